@@ -5,6 +5,8 @@
  * https://en.cppreference.com/w/cpp/container/map
  * 
  * std::map is a sorted associative container that contains key-value pairs with unique keys.
+ * If the keys don't need to be sorted, std::unordered_map with a good hash function (see performance/hash.h) is usually
+ * faster, since a lookup is one hash and about one comparison instead of log(n) comparisons.
  */
 
 // Generate a set of examples for std::map
@@ -14,6 +14,8 @@ void std_pair_examples() {
 
   // Create a pair of a string and a double
   std::pair<std::string, double> p2 {"pi", 3.14};
+  // The members of pairs and tuples keep their declaration order, with padding between members of different
+  // alignments; packed_tuple in performance/packed_tuple.h stores them by decreasing alignment instead
 
   // Access the elements
   int first = p1.first;
@@ -31,6 +33,8 @@ void std_pair_examples() {
 
   // Create a pair of a pair and a tuple
   std::pair<int, std::tuple<int, int, int>> p3 {1, {2, 3, 4}};
+  // std::hash has no specialization for pairs and tuples, so they can't be keys of an unordered container as is,
+  // see hashing::hash in performance/hash.h
 
   // Access the elements
   int outer = p3.first;
@@ -48,6 +52,8 @@ void std_pair_examples() {
   auto& [x, y] = p1;
   auto& [s, f] = p2;
   auto& [o, t] = p3;
+  // A std::vector of tuples stores the elements of each tuple together; to scan one element of many tuples, storing
+  // each element in its own array is faster, see soa_vector in performance/soa_vector.h
 }
 // std::pair is standard-layout if both T1 and T2 are standard-layout types. For what is a standard-layout type, see:
 // - https://en.cppreference.com/w/cpp/named_req/StandardLayoutType
@@ -63,4 +63,6 @@ void std_vector_examples() {
   for (int& x : v4) {
     x *= 2;
   }
+
+  // All three loops run on one thread, see parallel_for in performance/parallel.h to split them over a thread pool
 }
\ No newline at end of file
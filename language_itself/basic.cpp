@@ -34,6 +34,7 @@ class Point {
     int y_;
 };
 constexpr Point p {1, 2};
+// Whole lookup tables can be computed the same way, see make_table in performance/lookup_table.h
 
 // =================================================================
 // 2. thread_local
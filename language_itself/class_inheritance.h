@@ -195,6 +195,9 @@ void test3() {
   b->implementation();  // Derived implementation
   b->implementation2();  // Base implementation2
 }
+// Every call through `b` loads the vtable and does an indirect call. If all the derived classes are known up front,
+// see performance/closed_hierarchy.h for a variant-based replacement, and performance/dispatch_benchmark.cc for
+// what virtual calls, CRTP, std::variant and function-pointer tables cost in a tight loop.
 
 // =================================================================
 // 7. Virtual functions - override specifier and final specifier
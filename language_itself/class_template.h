@@ -1,3 +1,12 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cmath>
+
+#include "../performance/expression.h"
+#include "../performance/simd_pack.h"
+
 /**
  * 1. Class template in basic
  * 2. Non-type template parameters
@@ -34,6 +43,18 @@ class Array {
     // This will be defined outside the class
     T& operator[](size_t index);
 
+    size_t size() const { return length; }
+    T* data() { return ptr; }
+    const T* data() const { return ptr; }
+
+    // Arrays are expression operands (see performance/expression.h): `r = a * b + c * d` builds a lazy expression,
+    // and this assignment evaluates it in a single loop, without temporary arrays.
+    template <expr::Node E>
+    Array& operator=(const E& e) {
+      expr::assign(ptr, length, e);
+      return *this;
+    }
+
   private:
     T* ptr;
     size_t length;
@@ -60,24 +81,27 @@ T& Array<T>::operator[](size_t index) {
 // - A pointer or reference to a class member function
 // - std::nullptr_t
 // - A floating point type (since C++20)
-template <typename T, size_t size>
+template <typename T, size_t length>
 class StaticArray {
   public:
     T& operator[](size_t index) {
-      assert(index >= 0 && index < size);
+      assert(index >= 0 && index < length);
       return m_array[index];
     }
+
+    constexpr size_t size() const { return length; }
+    T* data() { return m_array; }
+    const T* data() const { return m_array; }
+
+    template <expr::Node E>
+    StaticArray& operator=(const E& e) {
+      expr::assign(m_array, length, e);
+      return *this;
+    }
   private:
-    T m_array[size] {};
+    T m_array[length] {};
 };
 
-// Example of using non-type template parameters
-void test_static_array() {
-  // The non-type template parameter must be a constant expression
-  StaticArray<int, 12> intArray;
-  StaticArray<double, 4> doubleArray;
-}
-
 // =================================================================
 // 3. Class template specialization (and partial specialization)
 // =================================================================
@@ -103,17 +127,157 @@ class StaticArray<bool, 10> {
     bool m_array[10] {};
 };
 // Partial specialization of a class
+// The specialization for double also carries numeric kernels. Since the length is a template parameter,
+// every loop below has a compile-time trip count and is unrolled by simd::unrolled_for, using AVX2 or AVX-512
+// registers when they are enabled at compile time (see performance/simd_pack.h).
 template <size_t length>
 class StaticArray<double, length> {
+  using pack = simd::double_pack;
+
   public:
     double& operator[](size_t index) {
       assert(index >= 0 && index < length);
       return m_array[index];
     }
+    const double& operator[](size_t index) const {
+      assert(index < length);
+      return m_array[index];
+    }
+
+    constexpr size_t size() const { return length; }
+    double* data() { return m_array; }
+    const double* data() const { return m_array; }
+
+    double dot(const StaticArray& other) const {
+      pack acc[4] {pack::zero(), pack::zero(), pack::zero(), pack::zero()};
+      simd::unrolled_for<length, pack::width>([&](size_t i, size_t lane) {
+        acc[lane] = pack::fma(pack::load(m_array + i), pack::load(other.m_array + i), acc[lane]);
+      });
+      double result = ((acc[0] + acc[1]) + (acc[2] + acc[3])).hsum();
+      simd::unrolled_tail<length, pack::width>([&](size_t i) {
+        result += m_array[i] * other.m_array[i];
+      });
+      return result;
+    }
+
+    // this = alpha * x + this
+    void axpy(double alpha, const StaticArray& x) {
+      pack a = pack::set1(alpha);
+      simd::unrolled_for<length, pack::width>([&](size_t i, size_t) {
+        pack::fma(a, pack::load(x.m_array + i), pack::load(m_array + i)).store(m_array + i);
+      });
+      simd::unrolled_tail<length, pack::width>([&](size_t i) {
+        m_array[i] += alpha * x.m_array[i];
+      });
+    }
+
+    double sum() const {
+      pack acc[4] {pack::zero(), pack::zero(), pack::zero(), pack::zero()};
+      simd::unrolled_for<length, pack::width>([&](size_t i, size_t lane) {
+        acc[lane] = acc[lane] + pack::load(m_array + i);
+      });
+      double result = ((acc[0] + acc[1]) + (acc[2] + acc[3])).hsum();
+      simd::unrolled_tail<length, pack::width>([&](size_t i) {
+        result += m_array[i];
+      });
+      return result;
+    }
+
+    // Like std::min, the result is unspecified if the array contains NaN
+    double min() const {
+      pack acc = pack::set1(m_array[0]);
+      simd::unrolled_for<length, pack::width>([&](size_t i, size_t) {
+        acc = pack::min(acc, pack::load(m_array + i));
+      });
+      double result = acc.hmin();
+      simd::unrolled_tail<length, pack::width>([&](size_t i) {
+        result = m_array[i] < result ? m_array[i] : result;
+      });
+      return result;
+    }
+
+    double max() const {
+      pack acc = pack::set1(m_array[0]);
+      simd::unrolled_for<length, pack::width>([&](size_t i, size_t) {
+        acc = pack::max(acc, pack::load(m_array + i));
+      });
+      double result = acc.hmax();
+      simd::unrolled_tail<length, pack::width>([&](size_t i) {
+        result = m_array[i] > result ? m_array[i] : result;
+      });
+      return result;
+    }
+
+    // Euclidean norm
+    double norm() const {
+      return std::sqrt(dot(*this));
+    }
+
+    template <expr::Node E>
+    StaticArray& operator=(const E& e) {
+      expr::assign(m_array, length, e);
+      return *this;
+    }
+
+    // Element-wise operations
+    StaticArray& operator+=(const StaticArray& other) {
+      return apply(other, [](pack a, pack b) { return a + b; }, [](double a, double b) { return a + b; });
+    }
+    StaticArray& operator-=(const StaticArray& other) {
+      return apply(other, [](pack a, pack b) { return a - b; }, [](double a, double b) { return a - b; });
+    }
+    StaticArray& operator*=(const StaticArray& other) {
+      return apply(other, [](pack a, pack b) { return a * b; }, [](double a, double b) { return a * b; });
+    }
+    StaticArray& operator/=(const StaticArray& other) {
+      return apply(other, [](pack a, pack b) { return a / b; }, [](double a, double b) { return a / b; });
+    }
+    StaticArray& operator*=(double scale) {
+      pack s = pack::set1(scale);
+      simd::unrolled_for<length, pack::width>([&](size_t i, size_t) {
+        (pack::load(m_array + i) * s).store(m_array + i);
+      });
+      simd::unrolled_tail<length, pack::width>([&](size_t i) {
+        m_array[i] *= scale;
+      });
+      return *this;
+    }
+
   private:
+    // The same operation is passed twice, once for full packs and once for the scalar tail
+    template <typename PackOp, typename ScalarOp>
+    StaticArray& apply(const StaticArray& other, PackOp pack_op, ScalarOp scalar_op) {
+      simd::unrolled_for<length, pack::width>([&](size_t i, size_t) {
+        pack_op(pack::load(m_array + i), pack::load(other.m_array + i)).store(m_array + i);
+      });
+      simd::unrolled_tail<length, pack::width>([&](size_t i) {
+        m_array[i] = scalar_op(m_array[i], other.m_array[i]);
+      });
+      return *this;
+    }
+
     double m_array[length] {};
 };
 
+// Matrix in performance/matrix.h stores its elements in an Array or a StaticArray, and multiplies them with a blocked GEMM
+
+// Array and StaticArray opt in to the lazy element-wise operators of performance/expression.h
+namespace expr {
+template <typename T>
+inline constexpr bool enable_terminal<Array<T>> = true;
+template <typename T, size_t length>
+inline constexpr bool enable_terminal<StaticArray<T, length>> = true;
+}
+
+// Example of using non-type template parameters
+// It is placed after the specializations on purpose: a partial specialization must be declared before the first use
+// that would instantiate it, otherwise StaticArray<double, 4> below would be instantiated from the primary template.
+void test_static_array() {
+  // The non-type template parameter must be a constant expression
+  StaticArray<int, 12> intArray;
+  StaticArray<double, 4> doubleArray;
+}
+
 // =================================================================
 // 4. Member function specialization (and partial specialization)
 // =================================================================
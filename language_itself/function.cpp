@@ -61,6 +61,8 @@ double fn7(const double (&a)[5]); // const reference to a sized array
 double fn8(int a[][3][5], size_t count);
 double fn9(const int a[][3][5], size_t count);  // const version
 double fn10(int (&a)[4][3][5], size_t count); // The same rule as for the single-dimensional array applies here
+// Such arrays are stored row by row, so walking them along any other axis strides through memory; tiled loops, a
+// cache-oblivious transpose and permute_axes are in performance/tiled.h
 
 // =================================================================
 // 5. Default arguments
@@ -145,6 +147,8 @@ std::string fn19(std::string str1, std::string str2) {
   return result;
 }
 // Which behavior is call copy elision, refer to the chapter "Constructor - copy constructor" in language_itself/class.cpp for more details.
+// Copy elision only removes the copy of the result. Called in a loop, s = fn19(s, piece) still copies all of s every
+// time, which is O(n^2); see concat, string_builder and rope in performance/string_builder.h.
 
 // =================================================================
 // 11. Return by reference and return by pointer
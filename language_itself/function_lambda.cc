@@ -101,6 +101,8 @@ void test_functor2() {
   Encryptor encryptor {"key"};
   std::string encrypted_str = encryptor("String to encrypt");
 }
+// A functor that takes a chunk and its offset in the stream can instead transform a large buffer in place, in parallel,
+// see XorKeystream and parallel_transform in performance/stream_transform.h
 
 // Note that the Lambda is actually modeled behind the scene as a functor or function object
 
@@ -152,4 +154,6 @@ void test_std_function() {
   functions[1] = adder;
   // store a lambda
   functions[2] = [](int a, int b) { return a + b; };
-}
\ No newline at end of file
+}
+// std::function may allocate to store the callable, and every call goes through a type-erased invoker.
+// See performance/function_ref.h for a non-owning function_ref (for parameters) and an inplace_function that never allocates.
\ No newline at end of file
@@ -28,6 +28,8 @@ T multiply(T a, T b) {
 // multiply("Hello, ", "World!"); // Error, the operator '*' is not defined for the type 'const char *'
 // We can also call the function template with a type that is explicitly specified
 // multiply<double>(1, 2); // OK, returns 2.0
+// Applied to whole arrays, a function like multiply() computes its result right away, so `a * b + c * d` needs three
+// temporary arrays. See performance/expression.h for operators that build a lazy expression and evaluate it in one loop.
 
 // =================================================================
 // 2. Multiple type parameters
@@ -58,6 +60,8 @@ template <typename T>
 T* max(T* a, T* b) {
   return *a < *b ? a : b;
 }
+// For the largest element of a whole array, reduce::max and reduce::argmax in performance/minmax.h compare a SIMD
+// register of elements at a time instead of one pair per call
 
 // =================================================================
 // 4. Non-template parameters
@@ -104,6 +108,8 @@ template<>
 char* add(char* a, const char* b) {
   return std::strcat(a, b);
 }
+// strcat scans `a` for its end on every call, so appending many pieces this way is O(n^2), string_builder in
+// performance/string_builder.h appends in amortized O(1)
 
 // =================================================================
 // 8. decltype and trailing return type
@@ -147,6 +153,8 @@ template<int N, typename T>
 T add4(T a) {
   return a + N;
 }
+// N is known at compile time, like the size of the tables that make_table<N> in performance/lookup_table.h
+// computes into .rodata
 // In C++17 and below, the non-type template parameters can only be integral types,
 // but in C++20, all basic types are allowed, including floating-point types and pointers and references, etc.
 // Since C++20, a class type that only has public members can also be a non-type template parameter
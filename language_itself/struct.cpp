@@ -65,6 +65,8 @@ struct MyStruct5 {
   double b{}; // value-initialized, initialized to 0.0
   int c{10}; // default member initialization, initialized to 10 if not provided
 };
+// sizeof(MyStruct5) is 24 for 16 bytes of members: padding after a and after c. Declared as {b, a, c} it would be 16,
+// see layout::print_layout and layout::padding in performance/struct_layout.h
 MyStruct5 myStruct5; // .a = uninitialized, .b = 0.0, .c = 10
 MyStruct5 myStruct5_2{1, 2.3, 4}; // .a = 1, .b = 2.3, .c = 4, explicit initialization value takes precedence over default member initialization
 
@@ -81,6 +83,8 @@ struct Company {
   Employee CEO{}; // nested struct
 };
 Company myCompany{10, {50, 100000.0}}; // .employee_count = 10, .CEO.age = 50, .CEO.salary = 100000.0
+// A std::vector<Employee> stores the fields of each employee next to each other (and 4 bytes of padding after age).
+// Queries that read one field of many employees are faster with one array per field, see performance/column_store.h
 
 // Second, we can define a struct inside another struct
 struct Company2 {
@@ -127,6 +131,8 @@ struct MyStruct7 {
     std::cout << a << ", " << b << ", " << x << std::endl;
   }
 };
+// Printing members one by one is also how aggregates are often serialized, which parses every number on the way
+// back; performance/wire.h encodes any aggregate in a binary format whose members are read in place
 
 // =================================================================
 // 8. const struct object
@@ -20,6 +20,8 @@
 // =================================================================
 // Type aliases are a way to create a new name for an existing type.
 using byte = unsigned char;
+// Raw memory is better typed as std::byte (C++17), which only allows bitwise operations; performance/byte_buffer.h
+// passes std::byte buffers between layers as reference-counted slices instead of copying them
 // The old way to create a type alias is to use typedef
 typedef unsigned char byte2;  // Not recommended
 
@@ -145,6 +147,8 @@ concept Addable3 = requires (T a) {
   a++;
   requires sizeof(T) <= 4; // This will check the value of sizeof(T) <= 4
 };
+// performance/numeric_kernels.h builds a hierarchy of concepts the same way (SimdArithmetic refines
+// TriviallyRelocatable) and lets them pick vectorized sum, transform and inclusive_scan implementations.
 
 // =================================================================
 // 12. Alias template
@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "byte_buffer.h"
+
+/**
+ * 1. Slices, appends, chains and a round trip through a pipe
+ * 2. A framing and parsing pipeline: three copies per message against one
+ * 3. Sending frames: one write per message against writev
+ */
+
+// =================================================================
+// 1. Slices, appends, chains and a round trip through a pipe
+// =================================================================
+void test_byte_buffer() {
+  // Slices share the block
+  ByteBuffer hello {std::string_view {"hello, world"}};
+  ByteBuffer world = hello.slice(7);
+  assert(world.chars() == "world" && hello.slice(0, 5).chars() == "hello" && hello.slice(12).empty());
+  assert(world.shares_storage_with(hello) && hello.use_count() == 2 && world.data() == hello.data() + 7);
+  world.remove_suffix(1);
+  world.remove_prefix(1);
+  assert(world.chars() == "orl" && hello.chars() == "hello, world");
+  std::span<const std::byte> bytes = world;
+  assert(bytes.size() == 3 && bytes[0] == std::byte {'o'});
+
+  // hello ends at the watermark and grows in place, the slice doesn't see the new bytes
+  ByteBuffer greeting = hello.slice(0, 5);
+  hello.reserve(100);
+  const std::byte* before = hello.data();
+  hello.append(std::string_view {"!!"});
+  assert(hello.data() == before && hello.chars() == "hello, world!!" && greeting.chars() == "hello");
+  // greeting ends before the watermark, so appending to it copies it into a new block
+  greeting.append(std::string_view {" there"});
+  assert(greeting.chars() == "hello there" && !greeting.shares_storage_with(hello));
+  assert(hello.chars() == "hello, world!!" && hello.use_count() == 2); // hello and world
+  // Appending a buffer to itself
+  greeting.append(greeting.span());
+  assert(greeting.chars() == "hello therehello there");
+
+  // Amortized growth: 100k one-byte appends move the bytes a handful of times
+  ByteBuffer grown;
+  size_t moves {0};
+  for (int i = 0; i < 100'000; i++) {
+    const std::byte* old = grown.data();
+    grown.append(std::span<const std::byte>(&hello[i % hello.size()], 1));
+    moves += grown.data() != old;
+  }
+  assert(grown.size() == 100'000 && moves < 20 && grown[14] == std::byte {'h'});
+
+  // prepare and commit: the unused part goes back to the block
+  ByteBuffer partial = ByteBuffer::with_capacity(64);
+  std::span<std::byte> room = partial.prepare(64);
+  assert(room.size() == 64 && partial.tailroom() == 0);
+  std::memcpy(room.data(), "abc", 3);
+  partial.commit(3);
+  assert(partial.chars() == "abc" && partial.tailroom() == 61);
+
+  // A chain: raw bytes fill the last block, buffers are linked without copying
+  BufferChain chain;
+  chain.append(std::as_bytes(std::span(std::string_view {"GET "})));
+  chain.append(hello.slice(0, 5));
+  chain.append(std::as_bytes(std::span(std::string_view {" HTTP/1.1"})));
+  assert(chain.size() == 18 && chain.buffers().size() == 3 && chain.buffers()[1].shares_storage_with(hello));
+  assert(chain.coalesce().chars() == "GET hello HTTP/1.1");
+  char header[6] {};
+  assert(chain.copy_front(std::as_writable_bytes(std::span(header))) == 6 && std::string_view(header, 6) == "GET he");
+  // Within the first buffer, take_front slices; across buffers it copies
+  assert(chain.take_front(2).chars() == "GE" && chain.buffers().size() == 3);
+  ByteBuffer across = chain.take_front(4);
+  assert(across.chars() == "T he" && !across.shares_storage_with(hello) && chain.size() == 12);
+  BufferChain head = chain.split(5);
+  assert(head.coalesce().chars() == "llo H" && head.buffers()[0].shares_storage_with(hello));
+  assert(chain.coalesce().chars() == "TTP/1.1");
+  chain.drop_front(4);
+  assert(chain.coalesce().chars() == "1.1" && chain.buffers().size() == 1);
+
+  // writev and readv through a pipe (less than the capacity of a pipe, so a single thread doesn't block)
+  int fds[2];
+  [[maybe_unused]] int status = ::pipe(fds);
+  assert(status == 0);
+  BufferChain out;
+  std::string expected;
+  for (int i = 0; i < 200; i++) {
+    std::string part = std::to_string(i) + ":" + std::string(size_t(i % 50), char('a' + i % 26)) + ";";
+    expected += part;
+    if (i % 3 == 0) {
+      out.append(ByteBuffer {std::string_view {part}});
+    } else {
+      out.append(std::as_bytes(std::span(part)));
+    }
+  }
+  assert(out.size() == expected.size() && out.buffers().size() > 60);
+  assert(out.write_to(fds[1]) == expected.size() && out.empty());
+  ::close(fds[1]);
+  BufferChain in;
+  while (in.read_from(fds[0], 1000) > 0) {
+  }
+  ::close(fds[0]);
+  assert(in.size() == expected.size() && in.coalesce().chars() == expected);
+
+  // Short reads go into the room left in the last block, without adding blocks
+  status = ::pipe(fds);
+  assert(status == 0);
+  BufferChain small;
+  std::string sent;
+  for (int i = 0; i < 100; i++) {
+    const std::string line = "line " + std::to_string(i) + "\n";
+    sent += line;
+    [[maybe_unused]] ssize_t written = ::write(fds[1], line.data(), line.size());
+    assert(small.read_from(fds[0], 4096) == line.size());
+  }
+  ::close(fds[1]);
+  assert(small.read_from(fds[0]) == 0);
+  ::close(fds[0]);
+  assert(small.buffers().size() == 1 && small.coalesce().chars() == sent);
+
+  // Slices released on other threads
+  ByteBuffer shared {std::string_view {"shared between threads"}};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([slice = shared.slice(size_t(t))] {
+      for (int i = 0; i < 10'000; i++) {
+        ByteBuffer copy = slice.slice(1);
+        assert(copy.size() + 1 == slice.size());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  assert(shared.use_count() == 1);
+
+  try {
+    BufferChain closed;
+    closed.read_from(-1);
+    assert(false);
+  } catch (const std::system_error& e) {
+    assert(e.code().value() == EBADF);
+  }
+}
+
+// =================================================================
+// 2. A framing and parsing pipeline: three copies per message against one
+// =================================================================
+// Frames are a 4-byte length followed by the payload. The "socket" is a buffer in memory, read 64 KiB at a time, so
+// that only the pipelines are measured. Both copy every byte once when reading it, like read() does.
+// With std::string, the frame is cut out of the receive buffer (copy 2) and the payload out of the frame (copy 3),
+// then the receive buffer is compacted. With ByteBuffer both are slices, and a frame is only copied when it is split
+// between two reads.
+uint32_t read_length(const std::byte* p) {
+  uint32_t length;
+  std::memcpy(&length, p, sizeof(length));
+  return length;
+}
+
+// The handler reads the whole payload
+uint64_t checksum(std::string_view payload) {
+  uint64_t sum {payload.size()};
+  size_t i {0};
+  for (; i + 8 <= payload.size(); i += 8) {
+    uint64_t word;
+    std::memcpy(&word, payload.data() + i, sizeof(word));
+    sum += word;
+  }
+  for (; i < payload.size(); i++) {
+    sum += uint8_t(payload[i]);
+  }
+  return sum;
+}
+
+std::string parse_payload(std::string frame) {
+  return frame.substr(4);
+}
+
+uint64_t pipeline_strings(std::span<const std::byte> wire, size_t chunk) {
+  uint64_t total {0};
+  std::string inbox;
+  for (size_t offset = 0; offset < wire.size(); offset += chunk) {
+    std::span<const std::byte> received = wire.subspan(offset, std::min(chunk, wire.size() - offset));
+    inbox.append(reinterpret_cast<const char*>(received.data()), received.size());
+    size_t pos {0};
+    while (inbox.size() - pos >= 4) {
+      const size_t length = read_length(reinterpret_cast<const std::byte*>(inbox.data() + pos));
+      if (inbox.size() - pos < 4 + length) {
+        break;
+      }
+      std::string frame = inbox.substr(pos, 4 + length);
+      pos += 4 + length;
+      total += checksum(parse_payload(std::move(frame)));
+    }
+    inbox.erase(0, pos);
+  }
+  return total;
+}
+
+uint64_t pipeline_buffers(std::span<const std::byte> wire, size_t chunk) {
+  uint64_t total {0};
+  BufferChain inbox;
+  for (size_t offset = 0; offset < wire.size(); offset += chunk) {
+    inbox.append(wire.subspan(offset, std::min(chunk, wire.size() - offset)));
+    std::byte header[4];
+    while (inbox.copy_front(header) == 4) {
+      const size_t length = read_length(header);
+      if (inbox.size() < 4 + length) {
+        break;
+      }
+      ByteBuffer frame = inbox.take_front(4 + length);
+      total += checksum(frame.slice(4).chars());
+    }
+  }
+  return total;
+}
+
+// =================================================================
+// 3. Sending frames: one write per message against writev
+// =================================================================
+// The usual way builds every frame as header + payload in a new std::string and writes it. A BufferChain links a
+// 4-byte header buffer and the payload (a slice, no copy) and sends up to 64 of them per writev. /dev/null takes the
+// bytes without copying them, so the difference is the copies and the system calls.
+void benchmark_byte_buffer(size_t messages = 500'000) {
+  std::mt19937_64 random {1};
+  std::vector<ByteBuffer> payloads;
+  std::vector<std::byte> wire;
+  for (size_t i = 0; i < messages; i++) {
+    const uint32_t length = uint32_t(64 + random() % 1024);
+    std::string payload(length, char('a' + i % 26));
+    const std::byte* p = reinterpret_cast<const std::byte*>(&length);
+    wire.insert(wire.end(), p, p + 4);
+    wire.insert(wire.end(), reinterpret_cast<const std::byte*>(payload.data()),
+                reinterpret_cast<const std::byte*>(payload.data()) + length);
+    payloads.emplace_back(std::string_view {payload});
+  }
+  const double megabytes = double(wire.size()) / 1e6;
+  volatile uint64_t sink {0};
+
+  const size_t chunk = 64 * 1024;
+  const uint64_t expected = pipeline_strings(wire, chunk);
+  assert(pipeline_buffers(wire, chunk) == expected);
+  const double strings = best_seconds([&] { sink = pipeline_strings(wire, chunk); });
+  const double buffers = best_seconds([&] { sink = pipeline_buffers(wire, chunk); });
+  std::cout << "parse " << messages << " frames (" << megabytes << " MB): std::string " << strings * 1e3 << " ms ("
+            << megabytes / strings << " MB/s), ByteBuffer " << buffers * 1e3 << " ms (" << megabytes / buffers
+            << " MB/s), " << strings / buffers << "x faster" << std::endl;
+
+  const int null = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (null < 0) {
+    throw std::system_error(errno, std::generic_category(), "open /dev/null");
+  }
+  const double writes = best_seconds([&] {
+    for (const ByteBuffer& payload : payloads) {
+      const uint32_t length = uint32_t(payload.size());
+      std::string frame(reinterpret_cast<const char*>(&length), 4);
+      frame += payload.chars();
+      [[maybe_unused]] ssize_t written = ::write(null, frame.data(), frame.size());
+    }
+  });
+  const double gathered = best_seconds([&] {
+    BufferChain out;
+    for (const ByteBuffer& payload : payloads) {
+      const uint32_t length = uint32_t(payload.size());
+      out.append(std::as_bytes(std::span(&length, 1)));
+      out.append(payload);
+      if (out.buffers().size() >= 64) {
+        out.write_to(null);
+      }
+    }
+    out.write_to(null);
+  });
+  ::close(null);
+  std::cout << "send " << messages << " frames: std::string + write " << writes * 1e3 << " ms, BufferChain + writev "
+            << gathered * 1e3 << " ms, " << writes / gathered << "x faster" << std::endl;
+}
@@ -0,0 +1,474 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * 1. Shared, immutable bytes
+ * 2. The storage block and its reference count
+ * 3. ByteBuffer: O(1) copies and slices
+ * 4. Appending: the watermark and amortized growth
+ * 5. BufferChain: a message as a list of buffers
+ * 6. Scatter/gather I/O with writev and readv
+ */
+
+// =================================================================
+// 1. Shared, immutable bytes
+// =================================================================
+// types.cpp introduces `using byte = unsigned char`, and messages are usually passed around as std::string: reading
+// from a socket appends to a string, the framing layer cuts a frame out of it with substr, the parser cuts the payload
+// out of the frame with another substr, and every step copies the bytes again.
+// A ByteBuffer is a view of a reference-counted block of bytes. Copying it or slicing it copies a pointer and a length
+// and increments the count, so every layer can keep its own part of the same bytes. The bytes of a buffer never change
+// once they are written, which is what makes sharing them safe: a buffer can only be extended past its end, into
+// bytes that no other buffer can see.
+// The reference count is atomic, so buffers and slices of the same block can be passed to and used by other threads
+// (copying, slicing, reading and destroying them).
+
+// =================================================================
+// 2. The storage block and its reference count
+// =================================================================
+// One allocation holds the header and the bytes. `used` is the watermark: the bytes before it belong to some buffer,
+// the bytes after it are free and go to the first buffer that claims them.
+namespace buffer_detail {
+
+struct Block {
+  std::atomic<size_t> refs {1};
+  std::atomic<size_t> used {0};
+  const size_t capacity;
+
+  explicit Block(size_t capacity) : capacity(capacity) {}
+
+  std::byte* bytes() { return reinterpret_cast<std::byte*>(this + 1); }
+
+  static Block* create(size_t capacity) {
+    return new (::operator new(sizeof(Block) + capacity)) Block(capacity);
+  }
+
+  // As for std::shared_ptr: a new reference is made from an existing one, so incrementing needs no ordering, and the
+  // last release has to see every write made through the other references before the block is freed
+  void acquire() { refs.fetch_add(1, std::memory_order_relaxed); }
+  void release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      this->~Block();
+      ::operator delete(this);
+    }
+  }
+};
+
+} // namespace buffer_detail
+
+// =================================================================
+// 3. ByteBuffer: O(1) copies and slices
+// =================================================================
+class ByteBuffer {
+  public:
+    // The smallest block allocated when a buffer grows
+    static constexpr size_t kMinCapacity {256};
+
+    ByteBuffer() = default;
+    // Copies the bytes, once, into a new block
+    explicit ByteBuffer(std::span<const std::byte> bytes) { append(bytes); }
+    explicit ByteBuffer(std::string_view text) : ByteBuffer(std::as_bytes(std::span(text))) {}
+
+    // An empty buffer that can be appended to without allocating, up to `capacity` bytes
+    static ByteBuffer with_capacity(size_t capacity) {
+      ByteBuffer buffer;
+      buffer.block_ = buffer_detail::Block::create(capacity);
+      buffer.data_ = buffer.block_->bytes();
+      return buffer;
+    }
+
+    ByteBuffer(const ByteBuffer& other) : block_(other.block_), data_(other.data_), size_(other.size_) {
+      assert(other.prepared_ == 0);
+      if (block_ != nullptr) {
+        block_->acquire();
+      }
+    }
+    ByteBuffer(ByteBuffer&& other) noexcept
+        : block_(std::exchange(other.block_, nullptr)), data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)), prepared_(std::exchange(other.prepared_, 0)) {}
+    ByteBuffer& operator=(ByteBuffer other) noexcept {
+      swap(other);
+      return *this;
+    }
+    ~ByteBuffer() {
+      if (block_ != nullptr) {
+        commit(0);
+        block_->release();
+      }
+    }
+
+    void swap(ByteBuffer& other) noexcept {
+      std::swap(block_, other.block_);
+      std::swap(data_, other.data_);
+      std::swap(size_, other.size_);
+      std::swap(prepared_, other.prepared_);
+    }
+
+    const std::byte* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const std::byte& operator[](size_t i) const {
+      assert(i < size_);
+      return data_[i];
+    }
+
+    // Interoperability: wherever a std::span<const std::byte> is expected, and as characters for text protocols
+    std::span<const std::byte> span() const { return {data_, size_}; }
+    operator std::span<const std::byte>() const { return span(); }
+    std::string_view chars() const { return {reinterpret_cast<const char*>(data_), size_}; }
+
+    friend bool operator==(const ByteBuffer& a, const ByteBuffer& b) {
+      return std::ranges::equal(a.span(), b.span());
+    }
+
+    // The bytes [offset, offset + length), sharing the block. The length is cut at the end of the buffer, like
+    // std::string::substr.
+    ByteBuffer slice(size_t offset, size_t length = SIZE_MAX) const {
+      assert(offset <= size_);
+      ByteBuffer part {*this};
+      part.data_ += offset;
+      part.size_ = std::min(length, size_ - offset);
+      return part;
+    }
+
+    void remove_prefix(size_t n) {
+      assert(n <= size_);
+      data_ += n;
+      size_ -= n;
+    }
+    void remove_suffix(size_t n) {
+      assert(n <= size_);
+      size_ -= n;
+    }
+
+    // The number of buffers that share the block (this one included), and whether two buffers share one
+    long use_count() const { return block_ != nullptr ? long(block_->refs.load(std::memory_order_relaxed)) : 0; }
+    bool shares_storage_with(const ByteBuffer& other) const {
+      return block_ != nullptr && block_ == other.block_;
+    }
+
+    // =================================================================
+    // 4. Appending: the watermark and amortized growth
+    // =================================================================
+    // A buffer that ends at the watermark of its block can grow in place, by moving the watermark with a
+    // compare-and-swap: the bytes between the old and the new watermark then belong to this buffer alone, even if
+    // other threads hold slices of the same block. Any other buffer (a slice that ends before the watermark, or a
+    // buffer whose block is full) is copied into a new block of at least twice its size, so appending n bytes one
+    // at a time copies O(n) bytes in total, like std::vector::push_back. Slices taken before keep the old block.
+    // The compare-and-swap can be relaxed: it hands out ranges of bytes and publishes nothing. The bytes written are
+    // published by whatever hands the buffer to another thread, as for any other object.
+
+    // Bytes that can be appended without allocating
+    size_t tailroom() const {
+      if (block_ == nullptr) {
+        return 0;
+      }
+      const size_t end = end_offset();
+      return block_->used.load(std::memory_order_relaxed) == end ? block_->capacity - end : 0;
+    }
+
+    // Ensures that at least n bytes can be appended without allocating
+    void reserve(size_t n) {
+      if (tailroom() < n) {
+        grow(n, {});
+      }
+    }
+
+    // Appends as many bytes as fit in place (possibly none) and returns how many, never allocates
+    size_t try_append(std::span<const std::byte> bytes) {
+      std::span<std::byte> room = claim(bytes.size());
+      if (!room.empty()) {
+        std::memcpy(room.data(), bytes.data(), room.size());
+        size_ += room.size();
+      }
+      return room.size();
+    }
+
+    // The bytes may be part of this buffer: they are copied before the old block is released
+    void append(std::span<const std::byte> bytes) {
+      const size_t done = try_append(bytes);
+      if (done < bytes.size()) {
+        grow(bytes.size() - done, bytes.subspan(done));
+      }
+    }
+    void append(std::string_view text) { append(std::as_bytes(std::span(text))); }
+
+    // For writing in place, e.g. with read(): prepare(n) claims up to n bytes after the end of the buffer (as many as
+    // fit in the block, possibly none) and returns them, commit(written) adds the first `written` of them to the
+    // buffer and gives the rest back to the block. Call reserve(n) first to get all n.
+    std::span<std::byte> prepare(size_t n) {
+      std::span<std::byte> room = claim(n);
+      prepared_ = room.size();
+      return room;
+    }
+    void commit(size_t written) {
+      assert(written <= prepared_);
+      if (prepared_ > 0) {
+        // No other buffer ends at the claimed end, so nothing else can move the watermark in between
+        block_->used.store(end_offset() + written, std::memory_order_relaxed);
+        size_ += written;
+        prepared_ = 0;
+      }
+    }
+
+  private:
+    size_t end_offset() const { return size_t(data_ + size_ - block_->bytes()); }
+
+    std::span<std::byte> claim(size_t n) {
+      assert(prepared_ == 0);
+      if (block_ == nullptr || n == 0) {
+        return {};
+      }
+      size_t end = end_offset();
+      n = std::min(n, block_->capacity - end);
+      if (n == 0 || !block_->used.compare_exchange_strong(end, end + n, std::memory_order_relaxed)) {
+        return {};
+      }
+      return {data_ + size_, n};
+    }
+
+    // Moves the bytes to a new block with room for `extra` more, and appends `tail` (which may point into the old
+    // block)
+    void grow(size_t extra, std::span<const std::byte> tail) {
+      assert(prepared_ == 0 && tail.size() <= extra);
+      buffer_detail::Block* grown = buffer_detail::Block::create(std::max({size_ + extra, 2 * size_, kMinCapacity}));
+      if (size_ > 0) {
+        std::memcpy(grown->bytes(), data_, size_);
+      }
+      if (!tail.empty()) {
+        std::memcpy(grown->bytes() + size_, tail.data(), tail.size());
+      }
+      grown->used.store(size_ + tail.size(), std::memory_order_relaxed);
+      if (block_ != nullptr) {
+        block_->release();
+      }
+      block_ = grown;
+      data_ = grown->bytes();
+      size_ += tail.size();
+    }
+
+    buffer_detail::Block* block_ {nullptr};
+    std::byte* data_ {nullptr};
+    size_t size_ {0};
+    size_t prepared_ {0};
+};
+
+// =================================================================
+// 5. BufferChain: a message as a list of buffers
+// =================================================================
+// A stream of bytes that is never made contiguous unless asked to: appending a ByteBuffer adds it to the list without
+// copying, and taking bytes off the front slices the buffers. Appending raw bytes fills the room left in the last
+// block, then new blocks that double in size up to kMaxBlock, so a chain of n bytes has O(log n + n / kMaxBlock)
+// buffers and appending never copies bytes that are already in the chain.
+class BufferChain {
+  public:
+    static constexpr size_t kMaxBlock {64 * 1024};
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const std::deque<ByteBuffer>& buffers() const { return buffers_; }
+
+    void append(ByteBuffer buffer) {
+      if (!buffer.empty()) {
+        size_ += buffer.size();
+        buffers_.push_back(std::move(buffer));
+      }
+    }
+    void append(BufferChain&& other) {
+      for (ByteBuffer& buffer : other.buffers_) {
+        append(std::move(buffer));
+      }
+      other.clear();
+    }
+    void append(std::span<const std::byte> bytes) {
+      size_ += bytes.size();
+      if (!buffers_.empty()) {
+        bytes = bytes.subspan(buffers_.back().try_append(bytes));
+      }
+      if (!bytes.empty()) {
+        ByteBuffer tail = ByteBuffer::with_capacity(std::max(bytes.size(), next_block_size()));
+        tail.append(bytes);
+        buffers_.push_back(std::move(tail));
+      }
+    }
+
+    void clear() {
+      buffers_.clear();
+      size_ = 0;
+    }
+
+    void drop_front(size_t n) {
+      assert(n <= size_);
+      size_ -= n;
+      while (n > 0) {
+        ByteBuffer& front = buffers_.front();
+        if (front.size() <= n) {
+          n -= front.size();
+          buffers_.pop_front();
+        } else {
+          front.remove_prefix(n);
+          n = 0;
+        }
+      }
+    }
+
+    // The first n bytes as one buffer: a slice if they are all in the first buffer, otherwise they are copied into
+    // a new one (e.g. a frame that arrived in two reads)
+    ByteBuffer take_front(size_t n) {
+      assert(n <= size_);
+      if (n == 0) {
+        return {};
+      }
+      ByteBuffer head;
+      if (buffers_.front().size() >= n) {
+        head = buffers_.front().slice(0, n);
+      } else {
+        head = ByteBuffer::with_capacity(n);
+        copy_front(head.prepare(n));
+        head.commit(n);
+      }
+      drop_front(n);
+      return head;
+    }
+
+    // The first n bytes as a chain, without copying any byte
+    BufferChain split(size_t n) {
+      assert(n <= size_);
+      BufferChain head;
+      while (n > 0) {
+        ByteBuffer& front = buffers_.front();
+        const size_t take = std::min(n, front.size());
+        head.append(front.slice(0, take));
+        drop_front(take);
+        n -= take;
+      }
+      return head;
+    }
+
+    // Copies the first bytes to `out` without removing them, e.g. to read a header that may span two buffers, and
+    // returns how many were copied
+    size_t copy_front(std::span<std::byte> out) const {
+      size_t copied {0};
+      for (const ByteBuffer& buffer : buffers_) {
+        if (copied == out.size()) {
+          break;
+        }
+        const size_t n = std::min(buffer.size(), out.size() - copied);
+        std::memcpy(out.data() + copied, buffer.data(), n);
+        copied += n;
+      }
+      return copied;
+    }
+
+    // All the bytes in one buffer, copied unless the chain is a single buffer
+    ByteBuffer coalesce() const {
+      if (buffers_.size() == 1) {
+        return buffers_.front();
+      }
+      ByteBuffer all = ByteBuffer::with_capacity(size_);
+      copy_front(all.prepare(size_));
+      all.commit(size_);
+      return all;
+    }
+
+    // =================================================================
+    // 6. Scatter/gather I/O with writev and readv
+    // =================================================================
+    // writev sends the buffers of the chain in one system call, without first copying them into one contiguous
+    // buffer; readv reads into the room left in the last buffer and into a new block in one system call.
+    // Both are for blocking file descriptors, and throw std::system_error on errors, like MappedArray.
+
+    // Writes the whole chain, empties it, and returns the number of bytes written
+    size_t write_to(int fd) {
+      size_t total {0};
+      while (!empty()) {
+        iovec iov[kMaxIovecs];
+        int count {0};
+        for (const ByteBuffer& buffer : buffers_) {
+          if (count == kMaxIovecs) {
+            break;
+          }
+          // iovec is shared by readv and writev, so its pointer isn't const; writev doesn't write to it
+          iov[count++] = {const_cast<std::byte*>(buffer.data()), buffer.size()};
+        }
+        const ssize_t written = ::writev(fd, iov, count);
+        if (written < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw std::system_error(errno, std::generic_category(), "writev");
+        }
+        drop_front(size_t(written));
+        total += size_t(written);
+      }
+      return total;
+    }
+
+    // Reads at most max_bytes with one readv, appends them, and returns how many were read: 0 at end of file.
+    // While at least a quarter of max_bytes is left in the last block, only that room is read into. Below that, what
+    // doesn't fit goes to a spare block, which is kept for the next call if the read was short and fit into the room,
+    // instead of being allocated and freed every time; it only joins the chain once bytes are read into it.
+    size_t read_from(int fd, size_t max_bytes = kMaxBlock) {
+      iovec iov[2];
+      int count {0};
+      std::span<std::byte> room = buffers_.empty() ? std::span<std::byte> {} : buffers_.back().prepare(max_bytes);
+      if (!room.empty()) {
+        iov[count++] = {room.data(), room.size()};
+      }
+      if (room.size() < max_bytes && room.size() < std::max<size_t>(1, max_bytes / 4)) {
+        const size_t needed = max_bytes - room.size();
+        if (spare_.tailroom() < needed) {
+          spare_ = ByteBuffer::with_capacity(std::max(needed, next_block_size()));
+        }
+        std::span<std::byte> more = spare_.prepare(needed);
+        iov[count++] = {more.data(), more.size()};
+      }
+      ssize_t got;
+      do {
+        got = ::readv(fd, iov, count);
+      } while (got < 0 && errno == EINTR);
+      const int error = errno;
+      const size_t read = got < 0 ? 0 : size_t(got);
+      const size_t in_room = std::min(read, room.size());
+      if (!room.empty()) {
+        buffers_.back().commit(in_room);
+      }
+      spare_.commit(read - in_room);
+      if (got < 0) {
+        throw std::system_error(error, std::generic_category(), "readv");
+      }
+      size_ += in_room;
+      if (!spare_.empty()) {
+        append(std::exchange(spare_, ByteBuffer {}));
+      }
+      return read;
+    }
+
+  private:
+    static constexpr int kMaxIovecs {64};
+
+    size_t next_block_size() const {
+      const size_t last = buffers_.empty() ? 0 : buffers_.back().size();
+      return std::clamp(2 * last, ByteBuffer::kMinCapacity, kMaxBlock);
+    }
+
+    std::deque<ByteBuffer> buffers_;
+    size_t size_ {0};
+    ByteBuffer spare_; // the block read_from() reads into after the last one, empty until it is used
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+/**
+ * 1. Closed hierarchies
+ * 2. closed_hierarchy<Base, Derived...>: a variant that still looks like a Base*
+ * 3. Devirtualized calls through visit()
+ */
+
+// =================================================================
+// 1. Closed hierarchies
+// =================================================================
+// Virtual functions (see class_inheritance.h) allow anybody to add a new derived class later, which is why every call
+// has to load the vtable and jump through it. Most hierarchies in an application are closed though: we know every
+// derived class up front. For a closed hierarchy, a std::variant of the derived classes is enough to remember the
+// dynamic type, the objects are stored by value (no heap allocation per object), and the call can be dispatched with a
+// switch on the variant index, which the compiler can inline, unlike an indirect call through a vtable.
+
+// =================================================================
+// 2. closed_hierarchy<Base, Derived...>: a variant that still looks like a Base*
+// =================================================================
+// closed_hierarchy replaces a `Base*` or `std::unique_ptr<Base>` in existing code: operator-> still returns a Base*,
+// so call sites like `obj->implementation()` compile unchanged, and they can be moved to visit() one by one where it
+// matters. operator-> and operator* are only for that migration: they std::visit the variant to find the Base
+// subobject and then make the usual virtual call, so they cost a little more than a call through a plain Base*.
+// Calls that should be fast belong in visit() (section 3).
+template <typename Base, typename... Derived>
+requires (std::is_base_of_v<Base, Derived> && ...)
+class closed_hierarchy {
+  public:
+    template <typename D>
+    requires (std::is_same_v<std::remove_cvref_t<D>, Derived> || ...)
+    closed_hierarchy(D&& derived) : value_(std::forward<D>(derived)) {}
+
+    template <typename D, typename... Args>
+    explicit closed_hierarchy(std::in_place_type_t<D> type, Args&&... args) : value_(type, std::forward<Args>(args)...) {}
+
+    Base* operator->() { return base(); }
+    const Base* operator->() const { return base(); }
+    Base& operator*() { return *base(); }
+    const Base& operator*() const { return *base(); }
+
+    // The position of the dynamic type in the Derived... list
+    size_t index() const { return value_.index(); }
+
+    // =================================================================
+    // 3. Devirtualized calls through visit()
+    // =================================================================
+    // visit() calls fn with the concrete type stored in the variant. A plain `derived.implementation()` in fn is only
+    // devirtualized if the derived classes are `final`: otherwise a `Derived&` could refer to a class further down the
+    // hierarchy as far as the compiler knows, and the call still goes through the vtable. A qualified call names the
+    // function to call, so it is a direct (and usually inlined) call whether the classes are `final` or not:
+    //
+    //   obj.visit([](auto& derived) {
+    //     using D = std::remove_cvref_t<decltype(derived)>;
+    //     return derived.D::implementation();
+    //   });
+    //
+    // There is no invoke(&Base::implementation): a call through a pointer to a virtual member function is always a
+    // virtual call, and a member function pointer can't be turned into a qualified call.
+    template <typename Fn>
+    decltype(auto) visit(Fn&& fn) {
+      return std::visit(std::forward<Fn>(fn), value_);
+    }
+    template <typename Fn>
+    decltype(auto) visit(Fn&& fn) const {
+      return std::visit(std::forward<Fn>(fn), value_);
+    }
+
+  private:
+    Base* base() {
+      return std::visit([](auto& derived) -> Base* { return &derived; }, value_);
+    }
+    const Base* base() const {
+      return std::visit([](const auto& derived) -> const Base* { return &derived; }, value_);
+    }
+
+    std::variant<Derived...> value_;
+};
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "column_store.h"
+#include "common.h"
+
+/**
+ * 1. Columns give the same answers as rows, on every target
+ * 2. Scans over 100M employees: array of structs against columns
+ */
+
+// =================================================================
+// 1. Columns give the same answers as rows, on every target
+// =================================================================
+// Deterministic data from the row index: ages 18..67, salaries 20000..119999
+columnar::Employee make_employee(uint64_t i) {
+  const uint64_t h = (i + 1) * 0x9E3779B97F4A7C15ull;
+  return {int(18 + (h >> 33) % 50), double(20'000 + (h >> 13) % 100'000)};
+}
+
+void test_column_store() {
+  using columnar::Employee;
+  columnar::employee_store store;
+  assert(store.size() == 0 && columnar::sum(store.salaries()) == 0.0);
+
+  // Odd sizes, so that the tails after the blocks of 4 and 8 rows are hit
+  std::vector<Employee> rows;
+  for (uint64_t i = 0; i < 1'003; i++) {
+    rows.push_back(make_employee(i));
+  }
+  store.push_back(rows[0]);
+  store.append(std::span<const Employee>(rows).subspan(1));
+  assert(store.size() == rows.size());
+
+  // Row proxies: read, write, convert
+  Employee first = store[0];
+  assert(first.age == rows[0].age && first.salary == rows[0].salary);
+  store[1].age = 99;
+  assert(store.ages()[1] == 99);
+  store[1] = rows[1];
+  const columnar::employee_store& view = store;
+  assert(view[1].age == rows[1].age && view[1].salary == rows[1].salary);
+  // Row to row, from a mutable and from a const store
+  store[2] = store[3];
+  assert(store.ages()[2] == rows[3].age && store.salaries()[2] == rows[3].salary);
+  store[2] = view[1];
+  assert(store.ages()[2] == rows[1].age && store.salaries()[2] == rows[1].salary);
+  store[2] = rows[2];
+
+  for (cpu_dispatch::isa target : {cpu_dispatch::isa::scalar, cpu_dispatch::supported_isa()}) {
+    cpu_dispatch::force_isa(target);
+    for (auto [lo, hi] : {std::pair {30, 39}, std::pair {0, 17}, std::pair {0, 100}, std::pair {40, 40}}) {
+      for (size_t n : {size_t {0}, size_t {1}, size_t {7}, size_t {8}, size_t {9}, store.size()}) {
+        std::span<const int> ages = store.ages().first(n);
+        std::span<const double> salaries = store.salaries().first(n);
+        size_t expected_count {0};
+        double expected_sum {0.0};
+        for (size_t i = 0; i < n; i++) {
+          if (rows[i].age >= lo && rows[i].age <= hi) {
+            expected_count++;
+            expected_sum += rows[i].salary;
+          }
+        }
+
+        columnar::selection selected;
+        columnar::filter_between(ages, lo, hi, selected);
+        assert(columnar::count(selected) == expected_count);
+        assert(std::is_sorted(selected.begin(), selected.end()));
+        for (uint32_t row : selected) {
+          assert(ages[row] >= lo && ages[row] <= hi);
+        }
+        // Salaries are whole numbers well below 2^53, so every order of the additions gives the exact same sum
+        assert(columnar::sum(salaries, selected) == expected_sum);
+        auto in_range = [lo, hi](int age) { return age >= lo && age <= hi; };
+        assert(columnar::sum_where(salaries, ages, in_range) == expected_sum);
+
+        columnar::selection generic;
+        columnar::filter(ages, in_range, generic);
+        assert(std::equal(generic.begin(), generic.end(), selected.begin(), selected.end()));
+      }
+    }
+  }
+  cpu_dispatch::force_isa(cpu_dispatch::supported_isa());
+
+  // WHERE age BETWEEN 30 AND 39 AND salary > 100000, and a selection reused for a smaller result
+  columnar::selection selected;
+  columnar::filter_between(store.ages(), 30, 39, selected);
+  columnar::refine(store.salaries(), [](double salary) { return salary > 100'000; }, selected);
+  size_t expected {0};
+  for (const Employee& e : rows) {
+    expected += e.age >= 30 && e.age <= 39 && e.salary > 100'000;
+  }
+  assert(selected.size() == expected && expected > 0);
+  columnar::filter_between(store.ages(), 1000, 2000, selected);
+  assert(selected.empty());
+
+  double total {0.0};
+  for (const Employee& e : rows) {
+    total += e.salary;
+  }
+  assert(columnar::sum(store.salaries()) == total);
+}
+
+// =================================================================
+// 2. Scans over 100M employees: array of structs against columns
+// =================================================================
+// 100M rows are 1.6 GB as an array of structs and 1.2 GB as columns (plus up to 400 MB of selection vector). The two
+// layouts are never in memory at the same time: the rows are measured first and freed.
+void benchmark_column_store(size_t n = 100'000'000) {
+  const int lo {30};
+  const int hi {39};
+  auto in_range = [](int age) { return age >= lo && age <= hi; };
+  volatile double sink {0.0};
+  auto report = [&](const char* layout, const char* query, double seconds) {
+    std::cout << layout << ", " << query << ": " << seconds * 1e3 << " ms, " << double(n) / seconds * 1e-6
+              << " M rows/s" << std::endl;
+  };
+
+  std::vector<double> rows_seconds;
+  {
+    std::vector<columnar::Employee> rows(n);
+    for (size_t i = 0; i < n; i++) {
+      rows[i] = make_employee(i);
+    }
+    rows_seconds.push_back(best_seconds([&] {
+      double total {0.0};
+      for (const columnar::Employee& e : rows) {
+        total += e.salary;
+      }
+      sink = total;
+    }));
+    rows_seconds.push_back(best_seconds([&] {
+      sink = double(std::count_if(rows.begin(), rows.end(), [&](const auto& e) { return in_range(e.age); }));
+    }));
+    rows_seconds.push_back(best_seconds([&] {
+      double total {0.0};
+      for (const columnar::Employee& e : rows) {
+        if (in_range(e.age)) {
+          total += e.salary;
+        }
+      }
+      sink = total;
+    }));
+    report("rows", "sum(salary)", rows_seconds[0]);
+    report("rows", "count(age 30..39)", rows_seconds[1]);
+    report("rows", "sum(salary) where age 30..39", rows_seconds[2]);
+  }
+
+  columnar::employee_store store;
+  store.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    store.push_back(make_employee(i));
+  }
+  columnar::selection selected;
+  auto compare = [&](const char* query, double seconds, double baseline) {
+    report("columns", query, seconds);
+    std::cout << "  " << baseline / seconds << "x the rows" << std::endl;
+  };
+  compare("sum(salary)", best_seconds([&] { sink = columnar::sum(store.salaries()); }), rows_seconds[0]);
+  compare("count(age 30..39)", best_seconds([&] {
+    columnar::filter_between(store.ages(), lo, hi, selected);
+    sink = double(columnar::count(selected));
+  }), rows_seconds[1]);
+  compare("sum(salary) where age 30..39, selection vector", best_seconds([&] {
+    columnar::filter_between(store.ages(), lo, hi, selected);
+    sink = columnar::sum(store.salaries(), selected);
+  }), rows_seconds[2]);
+  compare("sum(salary) where age 30..39, fused", best_seconds([&] {
+    sink = columnar::sum_where(store.salaries(), store.ages(), in_range);
+  }), rows_seconds[2]);
+  cpu_dispatch::force_isa(cpu_dispatch::isa::scalar);
+  compare("count(age 30..39), scalar filter", best_seconds([&] {
+    columnar::filter_between(store.ages(), lo, hi, selected);
+    sink = double(columnar::count(selected));
+  }), rows_seconds[1]);
+  cpu_dispatch::force_isa(cpu_dispatch::supported_isa());
+}
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "common.h"
+#include "cpu_dispatch.h"
+#include "lookup_table.h"
+
+/**
+ * 1. Rows or columns
+ * 2. employee_store: one array per field, with row proxies
+ * 3. Selection vectors
+ * 4. Filters: predicate -> selection vector
+ * 5. Aggregates over a column or a selection
+ */
+
+// =================================================================
+// 1. Rows or columns
+// =================================================================
+// A std::vector<Employee> of the Employee of struct.cpp stores {age, 4 bytes of padding, salary} for every employee,
+// 16 bytes per row. A query that only looks at the age, like "how many employees are in their thirties", still pulls
+// all 16 bytes of every row through the caches, 4 of which it uses. Stored as columns, ages are one contiguous array of
+// ints and salaries another one of doubles: the query reads 4 bytes per row, and 8 ints fill one AVX2 register.
+// A query runs in two steps, like in column-oriented databases: a filter turns a predicate on one column into a
+// selection vector (the indices of the matching rows), and an aggregate reads another column at those indices only.
+// The wider the record and the fewer the fields a query needs, the bigger the difference.
+
+namespace columnar {
+
+// The record of struct.cpp (see common.h)
+using Employee = struct_cpp::Employee;
+
+// =================================================================
+// 2. employee_store: one array per field, with row proxies
+// =================================================================
+// Code written for a std::vector<Employee> keeps working through the row proxies: store[i].age and store[i].salary
+// are references into the two columns, and a proxy converts to and from an Employee. Analytic code uses the columns
+// directly.
+class employee_store {
+  public:
+    struct const_row {
+      const int& age;
+      const double& salary;
+
+      operator Employee() const { return {age, salary}; }
+    };
+    struct row {
+      int& age;
+      double& salary;
+
+      operator Employee() const { return {age, salary}; }
+      row& operator=(const Employee& e) {
+        age = e.age;
+        salary = e.salary;
+        return *this;
+      }
+      // store[i] = store[j] copies the values of row j into row i, like for a std::vector<Employee>. The reference
+      // members delete the implicit copy assignment, which would otherwise be picked over the conversion to Employee.
+      row& operator=(const row& other) { return *this = Employee(other); }
+      row& operator=(const const_row& other) { return *this = Employee(other); }
+    };
+
+    size_t size() const { return ages_.size(); }
+    void reserve(size_t rows) {
+      ages_.reserve(rows);
+      salaries_.reserve(rows);
+    }
+
+    void push_back(const Employee& e) {
+      ages_.push_back(e.age);
+      salaries_.push_back(e.salary);
+    }
+
+    // Appends many rows at once, converting from the array-of-structs layout
+    void append(std::span<const Employee> employees) {
+      reserve(size() + employees.size());
+      for (const Employee& e : employees) {
+        push_back(e);
+      }
+    }
+
+    row operator[](size_t i) {
+      assert(i < size());
+      return {ages_[i], salaries_[i]};
+    }
+    const_row operator[](size_t i) const {
+      assert(i < size());
+      return {ages_[i], salaries_[i]};
+    }
+
+    std::span<const int> ages() const { return ages_; }
+    std::span<const double> salaries() const { return salaries_; }
+    std::span<int> ages() { return ages_; }
+    std::span<double> salaries() { return salaries_; }
+
+  private:
+    std::vector<int> ages_;
+    std::vector<double> salaries_;
+};
+
+// =================================================================
+// 3. Selection vectors
+// =================================================================
+// The indices of the selected rows, in increasing order. 32-bit indices are half the memory traffic of size_t, so a
+// store holds at most 4G rows. The buffer is reused by the next filter into the same selection, and unlike a
+// std::vector it isn't zero-filled when it grows.
+class selection {
+  public:
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const uint32_t* data() const { return rows_.get(); }
+    const uint32_t* begin() const { return rows_.get(); }
+    const uint32_t* end() const { return rows_.get() + size_; }
+    uint32_t operator[](size_t i) const {
+      assert(i < size_);
+      return rows_[i];
+    }
+
+    // For the filters: room for `capacity` indices, then the number that were written
+    uint32_t* prepare(size_t capacity) {
+      if (capacity > capacity_) {
+        rows_.reset(new uint32_t[capacity]);
+        capacity_ = capacity;
+      }
+      return rows_.get();
+    }
+    void finish(size_t count) {
+      assert(count <= capacity_);
+      size_ = count;
+    }
+
+  private:
+    std::unique_ptr<uint32_t[]> rows_;
+    size_t size_ {0};
+    size_t capacity_ {0};
+};
+
+// =================================================================
+// 4. Filters: predicate -> selection vector
+// =================================================================
+// Branch-free: the index is always written, and the output position only advances if the predicate holds. With random
+// data, a branch on the predicate would be mispredicted for half of the rows, at ~15 cycles each.
+template <typename T, typename Predicate>
+void filter(std::span<T> column, Predicate predicate, selection& out) {
+  assert(column.size() <= UINT32_MAX);
+  uint32_t* rows = out.prepare(column.size());
+  size_t count {0};
+  for (size_t i = 0; i < column.size(); i++) {
+    rows[count] = uint32_t(i);
+    count += predicate(column[i]) ? 1 : 0;
+  }
+  out.finish(count);
+}
+
+// Narrows an existing selection with a predicate on another column (a conjunction, `WHERE a AND b`), in place
+template <typename T, typename Predicate>
+void refine(std::span<T> column, Predicate predicate, selection& rows) {
+  uint32_t* out = rows.prepare(rows.size());
+  size_t count {0};
+  for (size_t i = 0; i < rows.size(); i++) {
+    const uint32_t row = rows[i];
+    out[count] = row;
+    count += predicate(column[row]) ? 1 : 0;
+  }
+  rows.finish(count);
+}
+
+// lo <= x <= hi on an int column, the most common filter, with an AVX2 kernel: 8 comparisons at once give an 8-bit
+// mask, and a table indexed by the mask (computed at compile time, see lookup_table.h) holds the permutation that
+// packs the indices of the matching lanes to the front of a register.
+namespace detail {
+
+inline constexpr auto kCompressTable = tables::make_table<256>([](size_t mask) {
+  std::array<uint32_t, 8> lanes {};
+  size_t count {0};
+  for (uint32_t lane = 0; lane < 8; lane++) {
+    if (mask & (1u << lane)) {
+      lanes[count++] = lane;
+    }
+  }
+  return lanes;
+});
+
+inline size_t filter_between_scalar(const int* x, size_t n, int lo, int hi, uint32_t* out) {
+  size_t count {0};
+  for (size_t i = 0; i < n; i++) {
+    out[count] = uint32_t(i);
+    count += (x[i] >= lo) & (x[i] <= hi);
+  }
+  return count;
+}
+
+#if defined(CPU_DISPATCH_X86)
+// Every store writes 8 indices, of which the first popcount(mask) are kept; the output never gets ahead of the input,
+// so the 8 writes at out + count stay inside the n slots of the buffer.
+__attribute__((target("avx2,popcnt")))
+inline size_t filter_between_avx2(const int* x, size_t n, int lo, int hi, uint32_t* out) {
+  const __m256i vlo = _mm256_set1_epi32(lo);
+  const __m256i vhi = _mm256_set1_epi32(hi);
+  const __m256i eight = _mm256_set1_epi32(8);
+  __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  size_t count {0};
+  size_t i {0};
+  for (; i + 8 <= n; i += 8) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+    const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(vlo, v), _mm256_cmpgt_epi32(v, vhi));
+    const unsigned mask = ~unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 0xFF;
+    const __m256i permutation = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kCompressTable[mask].data()));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), _mm256_permutevar8x32_epi32(index, permutation));
+    count += size_t(std::popcount(mask));
+    index = _mm256_add_epi32(index, eight);
+  }
+  for (; i < n; i++) {
+    out[count] = uint32_t(i);
+    count += (x[i] >= lo) & (x[i] <= hi);
+  }
+  return count;
+}
+#else
+constexpr size_t (*filter_between_avx2)(const int*, size_t, int, int, uint32_t*) = nullptr;
+#endif
+
+inline cpu_dispatch::kernel<size_t(const int*, size_t, int, int, uint32_t*)> filter_between_kernel {
+  filter_between_scalar, filter_between_avx2, nullptr
+};
+
+} // namespace detail
+
+inline void filter_between(std::span<const int> column, int lo, int hi, selection& out) {
+  assert(column.size() <= UINT32_MAX);
+  uint32_t* rows = out.prepare(column.size());
+  out.finish(detail::filter_between_kernel(column.data(), column.size(), lo, hi, rows));
+}
+
+// =================================================================
+// 5. Aggregates over a column or a selection
+// =================================================================
+// Four independent accumulators, so the additions of consecutive rows don't wait for each other. Floating-point
+// addition isn't associative, so the compiler doesn't do this on its own without -ffast-math.
+// The spans may be of const or mutable elements, the store hands out both.
+template <typename T>
+std::remove_const_t<T> sum(std::span<T> column) {
+  std::remove_const_t<T> acc[4] {};
+  size_t i {0};
+  for (; i + 4 <= column.size(); i += 4) {
+    acc[0] += column[i];
+    acc[1] += column[i + 1];
+    acc[2] += column[i + 2];
+    acc[3] += column[i + 3];
+  }
+  for (; i < column.size(); i++) {
+    acc[0] += column[i];
+  }
+  return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+template <typename T>
+std::remove_const_t<T> sum(std::span<T> column, const selection& rows) {
+  std::remove_const_t<T> acc[4] {};
+  size_t i {0};
+  for (; i + 4 <= rows.size(); i += 4) {
+    acc[0] += column[rows[i]];
+    acc[1] += column[rows[i + 1]];
+    acc[2] += column[rows[i + 2]];
+    acc[3] += column[rows[i + 3]];
+  }
+  for (; i < rows.size(); i++) {
+    acc[0] += column[rows[i]];
+  }
+  return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+inline size_t count(const selection& rows) {
+  return rows.size();
+}
+
+// Filter and aggregate fused into one pass, without a selection vector: every row is read, but there is no
+// intermediate buffer, which is faster when the predicate selects many rows
+template <typename T, typename K, typename Predicate>
+std::remove_const_t<T> sum_where(std::span<T> values, std::span<K> keys, Predicate predicate) {
+  using V = std::remove_const_t<T>;
+  assert(values.size() == keys.size());
+  V acc[4] {};
+  size_t i {0};
+  for (; i + 4 <= values.size(); i += 4) {
+    for (size_t lane = 0; lane < 4; lane++) {
+      acc[lane] += predicate(keys[i + lane]) ? values[i + lane] : V {};
+    }
+  }
+  for (; i < values.size(); i++) {
+    acc[0] += predicate(keys[i]) ? values[i] : V {};
+  }
+  return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+} // namespace columnar
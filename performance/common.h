@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+/**
+ * 1. The structs of struct.cpp
+ * 2. Timing a benchmark
+ */
+
+// =================================================================
+// 1. The structs of struct.cpp
+// =================================================================
+// struct.cpp is a tutorial and not a header, so the structs the performance code works on are repeated here, once,
+// with the same members
+namespace struct_cpp {
+
+struct MyStruct2 { int a; double b; };
+struct MyStruct5 { int a; double b {}; int c {10}; };
+struct Employee { int age {}; double salary {}; };
+struct Company { int employee_count {}; Employee CEO {}; };
+template <typename T, typename U = double>
+struct MyStruct6 { T a; U b; int c; };
+// Member functions don't change the layout
+struct MyStruct7 {
+  int a;
+  double b;
+  void print() {}
+};
+struct MyStruct8 {
+  int a;
+  void print() const {}
+};
+
+} // namespace struct_cpp
+
+// =================================================================
+// 2. Timing a benchmark
+// =================================================================
+// The best of a few runs, in seconds: the first run also pays for page faults and cold caches, and the fastest run is
+// the one the rest of the machine disturbed the least
+template <typename Fn>
+double best_seconds(Fn&& fn, int rounds = 3) {
+  double best {1e18};
+  for (int round = 0; round < rounds; round++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
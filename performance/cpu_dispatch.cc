@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "cpu_dispatch.h"
+
+/**
+ * 1. Every target produces the same result as the scalar kernel
+ * 2. Dispatch overhead benchmark
+ */
+
+// =================================================================
+// 1. Every target produces the same result as the scalar kernel
+// =================================================================
+void test_cpu_dispatch() {
+  using cpu_dispatch::isa;
+  std::cout << "supported: " << cpu_dispatch::isa_name(cpu_dispatch::supported_isa()) << std::endl;
+
+  for (isa target : {isa::scalar, isa::avx2, isa::avx512}) {
+    cpu_dispatch::force_isa(target);
+    // A target that isn't supported is clamped, the binding never exceeds what the CPU can run.
+    assert(cpu_dispatch::dot.bound_isa() <= cpu_dispatch::supported_isa());
+    if (target <= cpu_dispatch::supported_isa()) {
+      assert(cpu_dispatch::dot.bound_isa() == target);
+      assert(cpu_dispatch::axpy.bound_isa() == target);
+    }
+
+    // Lengths around the vector widths and unroll factors, to cover every remainder path
+    for (size_t n : {0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 100, 1001}) {
+      std::vector<double> a(n);
+      std::vector<double> b(n);
+      for (size_t i = 0; i < n; i++) {
+        a[i] = std::sin(double(i));
+        b[i] = std::cos(double(i));
+      }
+      double expected = cpu_dispatch::kernels::dot_scalar(a.data(), b.data(), n);
+      assert(std::abs(cpu_dispatch::dot(a.data(), b.data(), n) - expected) <= 1e-9);
+
+      std::vector<double> y {b};
+      cpu_dispatch::axpy(2.0, a.data(), y.data(), n);
+      for (size_t i = 0; i < n; i++) {
+        assert(std::abs(y[i] - (b[i] + 2.0 * a[i])) <= 1e-12);
+      }
+    }
+  }
+  cpu_dispatch::force_isa(cpu_dispatch::supported_isa());
+}
+
+// =================================================================
+// 2. Dispatch overhead benchmark
+// =================================================================
+// We call the bound kernel through the dispatcher and the very same implementation directly, on a tiny input,
+// so the difference between the two is the cost of dispatching. The direct call goes through a volatile function
+// pointer as well, otherwise the compiler would inline it and we would be comparing against no call at all;
+// the number we care about is what the dispatcher adds on top of a normal out-of-line call.
+void benchmark_cpu_dispatch() {
+  constexpr size_t kCalls {20'000'000};
+  double a[4] {1.0, 2.0, 3.0, 4.0};
+  double b[4] {4.0, 3.0, 2.0, 1.0};
+
+  using dot_fn = double (*)(const double*, const double*, size_t);
+  dot_fn bound_impl = cpu_dispatch::kernels::dot_scalar;
+  switch (cpu_dispatch::dot.bound_isa()) {
+#if defined(CPU_DISPATCH_X86)
+    case cpu_dispatch::isa::avx512: bound_impl = cpu_dispatch::kernels::dot_avx512; break;
+    case cpu_dispatch::isa::avx2: bound_impl = cpu_dispatch::kernels::dot_avx2; break;
+#endif
+    default: break;
+  }
+  dot_fn volatile direct = bound_impl;
+
+  // The best of several rounds is reported, which filters out interrupts and frequency changes.
+  // The result is only passed to an empty asm statement, so consecutive calls don't form a dependency chain.
+  auto time_calls = [&](auto&& call) {
+    double best {1e9};
+    for (int round = 0; round < 5; round++) {
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < kCalls; i++) {
+        double result = call();
+        asm volatile("" : : "x"(result));
+      }
+      auto end = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / kCalls);
+    }
+    return best;
+  };
+  double direct_ns = time_calls([&] { return direct(a, b, 4); });
+  double dispatched_ns = time_calls([&] { return cpu_dispatch::dot(a, b, 4); });
+  // The goal of binding once at startup: the call through the pointer costs less than 1 ns more than a direct call.
+  // It isn't an assert, a loaded machine can miss it for reasons that have nothing to do with the dispatch.
+  constexpr double kTargetNs {1.0};
+  const double overhead_ns = dispatched_ns - direct_ns;
+  std::cout << "bound to " << cpu_dispatch::isa_name(cpu_dispatch::dot.bound_isa())
+            << ": direct " << direct_ns << " ns/call, dispatched " << dispatched_ns << " ns/call"
+            << ", overhead " << overhead_ns << " ns (target < " << kTargetNs << " ns: "
+            << (overhead_ns < kTargetNs ? "met" : "MISSED") << ")" << std::endl;
+}
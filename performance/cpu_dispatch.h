@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_DISPATCH_X86 1
+#endif
+
+/**
+ * 1. Detecting CPU features once at startup
+ * 2. A kernel bound to the best implementation through a function pointer
+ * 3. Forcing a specific target for testing
+ * 4. Kernels compiled for several targets in a single translation unit
+ *
+ * A template specialization like StaticArray<int, 100>::operator[] (see class_template.h) is chosen at compile time,
+ * and so is simd::double_pack (see simd_pack.h), which means one binary can only use the instructions it was compiled for.
+ * Here every kernel is compiled once per target with __attribute__((target(...))), and the best one the CPU supports
+ * is picked when the program starts. A call then costs one indirect call and nothing else, there is no branch on the ISA.
+ */
+
+namespace cpu_dispatch {
+
+// =================================================================
+// 1. Detecting CPU features once at startup
+// =================================================================
+// The targets are ordered, a CPU that supports a target also supports all the targets before it.
+enum class isa {
+  scalar,
+  avx2,   // AVX2 + FMA
+  avx512, // AVX-512F
+};
+
+inline const char* isa_name(isa target) {
+  switch (target) {
+    case isa::scalar: return "scalar";
+    case isa::avx2: return "avx2";
+    case isa::avx512: return "avx512";
+  }
+  return "unknown";
+}
+
+// __builtin_cpu_supports reads the cpuid results that the runtime has already cached, and it also checks that the OS
+// saves the wide registers on context switches (the OSXSAVE/XCR0 bits), which a raw cpuid check easily forgets.
+inline isa detect_isa() {
+#if defined(CPU_DISPATCH_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return isa::avx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return isa::avx2;
+  }
+#endif
+  return isa::scalar;
+}
+
+// Detection runs once, the first time it is needed ("magic static"), and is cached afterwards.
+inline isa supported_isa() {
+  static const isa supported {detect_isa()};
+  return supported;
+}
+
+// =================================================================
+// 2. A kernel bound to the best implementation through a function pointer
+// =================================================================
+class kernel_base {
+  public:
+    virtual void bind(isa target) = 0;
+  protected:
+    ~kernel_base() = default;
+};
+
+// Every kernel registers itself so that force_isa() can rebind all of them at once.
+inline std::vector<kernel_base*>& kernel_registry() {
+  static std::vector<kernel_base*> registry;
+  return registry;
+}
+
+// The target that kernels are bound to, which is the best supported one unless it is overridden (see section 3).
+// The CPU_DISPATCH_ISA environment variable (scalar, avx2 or avx512) lowers it without recompiling.
+inline isa& requested_isa() {
+  static isa requested = [] {
+    const char* env = std::getenv("CPU_DISPATCH_ISA");
+    if (env != nullptr) {
+      for (isa target : {isa::scalar, isa::avx2, isa::avx512}) {
+        if (std::strcmp(env, isa_name(target)) == 0 && target <= supported_isa()) {
+          return target;
+        }
+      }
+    }
+    return supported_isa();
+  }();
+  return requested;
+}
+
+template <typename Sig>
+class kernel;
+
+// A kernel holds one implementation per target (nullptr if a target has no dedicated implementation),
+// and a function pointer bound to the best implementation that is both supported and requested.
+template <typename R, typename... Args>
+class kernel<R(Args...)> final : public kernel_base {
+  public:
+    using fn_ptr = R (*)(Args...);
+
+    kernel(fn_ptr scalar, fn_ptr avx2, fn_ptr avx512) : impls_{scalar, avx2, avx512} {
+      bind(requested_isa());
+      kernel_registry().push_back(this);
+    }
+    kernel(const kernel&) = delete;
+    kernel& operator=(const kernel&) = delete;
+
+    // The hot path: one load of the pointer and one indirect call, the ISA is never checked here.
+    R operator()(Args... args) const {
+      return fn_(args...);
+    }
+
+    // Falls back to the next lower target when a target has no implementation or isn't supported by the CPU.
+    void bind(isa target) override {
+      if (target > supported_isa()) {
+        target = supported_isa();
+      }
+      int index = static_cast<int>(target);
+      while (impls_[index] == nullptr) {
+        index--;
+      }
+      fn_ = impls_[index];
+      bound_ = static_cast<isa>(index);
+    }
+
+    isa bound_isa() const { return bound_; }
+
+  private:
+    fn_ptr impls_[3];
+    fn_ptr fn_ {nullptr};
+    isa bound_ {isa::scalar};
+};
+
+// =================================================================
+// 3. Forcing a specific target for testing
+// =================================================================
+// Rebinds every registered kernel, e.g. to run the scalar and AVX2 paths on an AVX-512 machine in the same test.
+// This is not thread-safe with respect to concurrent kernel calls, call it before the kernels are used.
+// A target the CPU doesn't support is clamped to the best supported target.
+inline void force_isa(isa target) {
+  requested_isa() = target;
+  for (kernel_base* k : kernel_registry()) {
+    k->bind(target);
+  }
+}
+
+// =================================================================
+// 4. Kernels compiled for several targets in a single translation unit
+// =================================================================
+// The target attribute lets the compiler emit AVX2/AVX-512 instructions for one function only, while the rest of
+// the program is still compiled for the baseline, so the binary keeps running on machines without those extensions.
+// GCC also offers ifunc resolvers and target_clones, which do the same binding in the dynamic loader, but they are
+// ELF-only and can't be rebound for tests, so we use a plain function pointer.
+namespace kernels {
+
+inline double dot_scalar(const double* a, const double* b, size_t n) {
+  double result {0.0};
+  for (size_t i = 0; i < n; i++) {
+    result += a[i] * b[i];
+  }
+  return result;
+}
+
+inline void axpy_scalar(double alpha, const double* x, double* y, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    y[i] += alpha * x[i];
+  }
+}
+
+#if defined(CPU_DISPATCH_X86)
+__attribute__((target("avx2,fma")))
+inline double dot_avx2(const double* a, const double* b, size_t n) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+    acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+  }
+  __m256d acc = _mm256_add_pd(acc0, acc1);
+  __m128d x = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+  double result = _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x)));
+  for (; i < n; i++) {
+    result += a[i] * b[i];
+  }
+  return result;
+}
+
+__attribute__((target("avx2,fma")))
+inline void axpy_avx2(double alpha, const double* x, double* y, size_t n) {
+  __m256d a = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+  }
+  for (; i < n; i++) {
+    y[i] += alpha * x[i];
+  }
+}
+
+__attribute__((target("avx512f")))
+inline double dot_avx512(const double* a, const double* b, size_t n) {
+  __m512d acc0 = _mm512_setzero_pd();
+  __m512d acc1 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+    acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), acc1);
+  }
+  // The remainder is handled with a masked load instead of a scalar loop
+  for (; i < n; i += 8) {
+    __mmask8 mask = n - i >= 8 ? __mmask8(0xFF) : __mmask8((1u << (n - i)) - 1);
+    acc0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i), acc0);
+  }
+  // Summed through memory rather than with _mm512_reduce_add_pd, which makes GCC 12 warn (-Wuninitialized) in every
+  // file that includes this header
+  alignas(64) double lanes[8];
+  _mm512_store_pd(lanes, _mm512_add_pd(acc0, acc1));
+  return ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+}
+
+__attribute__((target("avx512f")))
+inline void axpy_avx512(double alpha, const double* x, double* y, size_t n) {
+  __m512d a = _mm512_set1_pd(alpha);
+  for (size_t i = 0; i < n; i += 8) {
+    __mmask8 mask = n - i >= 8 ? __mmask8(0xFF) : __mmask8((1u << (n - i)) - 1);
+    __m512d result = _mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i));
+    _mm512_mask_storeu_pd(y + i, mask, result);
+  }
+}
+#else
+constexpr double (*dot_avx2)(const double*, const double*, size_t) = nullptr;
+constexpr void (*axpy_avx2)(double, const double*, double*, size_t) = nullptr;
+constexpr double (*dot_avx512)(const double*, const double*, size_t) = nullptr;
+constexpr void (*axpy_avx512)(double, const double*, double*, size_t) = nullptr;
+#endif
+
+} // namespace kernels
+
+// The dispatched entry points, bound during static initialization.
+inline kernel<double(const double*, const double*, size_t)> dot {
+  kernels::dot_scalar, kernels::dot_avx2, kernels::dot_avx512
+};
+inline kernel<void(double, const double*, double*, size_t)> axpy {
+  kernels::axpy_scalar, kernels::axpy_avx2, kernels::axpy_avx512
+};
+
+} // namespace cpu_dispatch
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "closed_hierarchy.h"
+
+/**
+ * 1. A small hierarchy in the shape of BaseCls/DerivedCls, with and without `final`
+ * 2. The CRTP counterpart
+ * 3. The function-pointer table counterpart
+ * 4. closed_hierarchy behaves like the Base* it replaces
+ * 5. Per-call dispatch cost over a heterogeneous collection
+ *
+ * The BaseCls hierarchy in class_inheritance.h prints from every method, so we mirror it with methods that do a tiny
+ * amount of arithmetic: the work per call must be small, otherwise we'd be measuring the work and not the dispatch.
+ */
+
+// =================================================================
+// 1. A small hierarchy in the shape of BaseCls/DerivedCls, with and without `final`
+// =================================================================
+class Shape {
+  public:
+    virtual ~Shape() = default;
+    virtual double area() const = 0;
+};
+
+class Circle : public Shape {
+  public:
+    explicit Circle(double r) : r_(r) {}
+    double area() const override { return 3.14159265358979 * r_ * r_; }
+  private:
+    double r_;
+};
+
+class Square : public Shape {
+  public:
+    explicit Square(double s) : s_(s) {}
+    double area() const override { return s_ * s_; }
+  private:
+    double s_;
+};
+
+class Triangle : public Shape {
+  public:
+    explicit Triangle(double b) : b_(b) {}
+    double area() const override { return 0.5 * b_ * b_; }
+  private:
+    double b_;
+};
+
+// The same classes marked final, nothing else changes
+class CircleFinal final : public Circle { using Circle::Circle; };
+class SquareFinal final : public Square { using Square::Square; };
+class TriangleFinal final : public Triangle { using Triangle::Triangle; };
+
+// =================================================================
+// 2. The CRTP counterpart
+// =================================================================
+// CRTP (see class_inheritance.h) has no common base type, so it can't hold a mixed collection at all.
+// The best it can do is one array per type, which is what we measure, and which is the lower bound for every other approach.
+template <typename T>
+class ShapeCrtp {
+  public:
+    double area() const { return static_cast<const T*>(this)->area_impl(); }
+};
+class CircleCrtp : public ShapeCrtp<CircleCrtp> {
+  public:
+    explicit CircleCrtp(double r) : r_(r) {}
+    double area_impl() const { return 3.14159265358979 * r_ * r_; }
+  private:
+    double r_;
+};
+class SquareCrtp : public ShapeCrtp<SquareCrtp> {
+  public:
+    explicit SquareCrtp(double s) : s_(s) {}
+    double area_impl() const { return s_ * s_; }
+  private:
+    double s_;
+};
+class TriangleCrtp : public ShapeCrtp<TriangleCrtp> {
+  public:
+    explicit TriangleCrtp(double b) : b_(b) {}
+    double area_impl() const { return 0.5 * b_ * b_; }
+  private:
+    double b_;
+};
+
+// =================================================================
+// 3. The function-pointer table counterpart
+// =================================================================
+// The C way: a plain record with a type tag, and a table of functions indexed by the tag.
+struct ShapeRecord {
+  uint8_t kind;
+  double size;
+};
+using area_fn = double (*)(const ShapeRecord&);
+double circle_area(const ShapeRecord& r) { return 3.14159265358979 * r.size * r.size; }
+double square_area(const ShapeRecord& r) { return r.size * r.size; }
+double triangle_area(const ShapeRecord& r) { return 0.5 * r.size * r.size; }
+constexpr area_fn area_table[] {circle_area, square_area, triangle_area};
+
+// =================================================================
+// 4. closed_hierarchy behaves like the Base* it replaces
+// =================================================================
+// A qualified call to the area() of the concrete type: a direct call, with or without `final`
+auto qualified_area = [](const auto& shape) {
+  using S = std::remove_cvref_t<decltype(shape)>;
+  return shape.S::area();
+};
+
+void test_closed_hierarchy() {
+  using Shapes = closed_hierarchy<Shape, Circle, Square, Triangle>;
+  static_assert(!std::is_constructible_v<Shapes, CircleFinal> && !std::is_constructible_v<Shapes, Shape*>);
+
+  std::vector<Shapes> shapes {Square(2.0), Triangle(4.0), Shapes(std::in_place_type<Circle>, 1.0)};
+  assert(shapes[0].index() == 1 && shapes[1].index() == 2 && shapes[2].index() == 0);
+  // operator-> and operator* go through the vtable, visit() reaches the concrete type
+  assert(shapes[0]->area() == 4.0 && (*shapes[1]).area() == 8.0 && shapes[2]->area() == 3.14159265358979);
+  for (const Shapes& shape : shapes) {
+    assert(shape.visit(qualified_area) == shape->area());
+    assert(shape.visit([](const auto& s) { return s.area(); }) == shape->area());
+  }
+  assert(shapes[0].visit([](auto& s) { return std::is_same_v<decltype(s), Square&>; }));
+  const Shapes& first = shapes[0];
+  assert(first.visit([](auto& s) { return std::is_same_v<decltype(s), const Square&>; }));
+  // The Base* points into the variant, no object lives on the heap
+  const Shape* base = &*shapes[1];
+  assert(reinterpret_cast<const std::byte*>(base) >= reinterpret_cast<const std::byte*>(&shapes[1]) &&
+         reinterpret_cast<const std::byte*>(base) < reinterpret_cast<const std::byte*>(&shapes[1] + 1));
+
+  // Assigning another derived type changes the dynamic type in place
+  shapes[0] = Circle(2.0);
+  assert(shapes[0].index() == 0 && shapes[0]->area() == 4 * 3.14159265358979);
+
+  closed_hierarchy<Shape, CircleFinal, SquareFinal> finals {SquareFinal(3.0)};
+  assert(finals.visit(qualified_area) == 9.0 && finals.visit([](const auto& s) { return s.area(); }) == 9.0);
+}
+
+// =================================================================
+// 5. Per-call dispatch cost over a heterogeneous collection
+// =================================================================
+// Every approach sums the areas of the same random sequence of shapes, so the results must match exactly.
+// A random mix defeats the indirect branch predictor, a sorted collection shows the best case.
+template <typename Fn>
+double time_per_element(size_t count, const char* name, Fn&& fn) {
+  double best {1e9};
+  double result {0.0};
+  for (int round = 0; round < 3; round++) {
+    auto start = std::chrono::steady_clock::now();
+    result = fn();
+    best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+  }
+  std::cout << name << ": " << best / double(count) << " ns/element" << std::endl;
+  return result;
+}
+
+void benchmark_dispatch(size_t count = 10'000'000, bool sorted = false) {
+  std::mt19937 rng {42};
+  std::vector<ShapeRecord> records(count);
+  for (ShapeRecord& record : records) {
+    record = {uint8_t(rng() % 3), double(rng() % 100) / 10.0};
+  }
+  if (sorted) {
+    std::stable_sort(records.begin(), records.end(), [](auto& a, auto& b) { return a.kind < b.kind; });
+  }
+
+  std::vector<std::unique_ptr<Shape>> virtual_shapes;
+  std::vector<std::unique_ptr<Shape>> virtual_final_shapes;
+  std::vector<std::variant<Circle, Square, Triangle>> variant_shapes;
+  std::vector<std::variant<CircleFinal, SquareFinal, TriangleFinal>> variant_final_shapes;
+  std::vector<closed_hierarchy<Shape, Circle, Square, Triangle>> closed_shapes;
+  std::vector<closed_hierarchy<Shape, CircleFinal, SquareFinal, TriangleFinal>> closed_final_shapes;
+  std::vector<CircleCrtp> crtp_circles;
+  std::vector<SquareCrtp> crtp_squares;
+  std::vector<TriangleCrtp> crtp_triangles;
+  for (const ShapeRecord& r : records) {
+    switch (r.kind) {
+      case 0:
+        virtual_shapes.push_back(std::make_unique<Circle>(r.size));
+        virtual_final_shapes.push_back(std::make_unique<CircleFinal>(r.size));
+        variant_shapes.emplace_back(Circle(r.size));
+        variant_final_shapes.emplace_back(CircleFinal(r.size));
+        closed_shapes.emplace_back(Circle(r.size));
+        closed_final_shapes.emplace_back(CircleFinal(r.size));
+        crtp_circles.emplace_back(r.size);
+        break;
+      case 1:
+        virtual_shapes.push_back(std::make_unique<Square>(r.size));
+        virtual_final_shapes.push_back(std::make_unique<SquareFinal>(r.size));
+        variant_shapes.emplace_back(Square(r.size));
+        variant_final_shapes.emplace_back(SquareFinal(r.size));
+        closed_shapes.emplace_back(Square(r.size));
+        closed_final_shapes.emplace_back(SquareFinal(r.size));
+        crtp_squares.emplace_back(r.size);
+        break;
+      default:
+        virtual_shapes.push_back(std::make_unique<Triangle>(r.size));
+        virtual_final_shapes.push_back(std::make_unique<TriangleFinal>(r.size));
+        variant_shapes.emplace_back(Triangle(r.size));
+        variant_final_shapes.emplace_back(TriangleFinal(r.size));
+        closed_shapes.emplace_back(Triangle(r.size));
+        closed_final_shapes.emplace_back(TriangleFinal(r.size));
+        crtp_triangles.emplace_back(r.size);
+        break;
+    }
+  }
+
+  std::cout << count << (sorted ? " sorted" : " shuffled") << " shapes" << std::endl;
+  // `final` doesn't help calls through a Shape*, the static type is still the base class
+  double virtual_sum = time_per_element(count, "virtual", [&] {
+    double sum {0.0};
+    for (const auto& shape : virtual_shapes) sum += shape->area();
+    return sum;
+  });
+  double virtual_final_sum = time_per_element(count, "virtual, final", [&] {
+    double sum {0.0};
+    for (const auto& shape : virtual_final_shapes) sum += shape->area();
+    return sum;
+  });
+  double variant_sum = time_per_element(count, "variant + visit", [&] {
+    double sum {0.0};
+    for (const auto& shape : variant_shapes) sum += std::visit([](const auto& s) { return s.area(); }, shape);
+    return sum;
+  });
+  double variant_final_sum = time_per_element(count, "variant + visit, final", [&] {
+    double sum {0.0};
+    for (const auto& shape : variant_final_shapes) sum += std::visit([](const auto& s) { return s.area(); }, shape);
+    return sum;
+  });
+  double closed_arrow_sum = time_per_element(count, "closed_hierarchy operator->", [&] {
+    double sum {0.0};
+    for (const auto& shape : closed_shapes) sum += shape->area();
+    return sum;
+  });
+  // Without `final` the unqualified call in visit() is still virtual, the qualified one is direct
+  double closed_sum = time_per_element(count, "closed_hierarchy visit", [&] {
+    double sum {0.0};
+    for (const auto& shape : closed_shapes) sum += shape.visit([](const auto& s) { return s.area(); });
+    return sum;
+  });
+  double closed_qualified_sum = time_per_element(count, "closed_hierarchy visit, qualified call", [&] {
+    double sum {0.0};
+    for (const auto& shape : closed_shapes) sum += shape.visit(qualified_area);
+    return sum;
+  });
+  double closed_final_sum = time_per_element(count, "closed_hierarchy visit, final", [&] {
+    double sum {0.0};
+    for (const auto& shape : closed_final_shapes) sum += shape.visit([](const auto& s) { return s.area(); });
+    return sum;
+  });
+  double table_sum = time_per_element(count, "function-pointer table", [&] {
+    double sum {0.0};
+    for (const ShapeRecord& record : records) sum += area_table[record.kind](record);
+    return sum;
+  });
+  // The per-type arrays are summed in a different order, so this one is only compared approximately
+  double crtp_sum = time_per_element(count, "CRTP, one array per type", [&] {
+    double sum {0.0};
+    for (const auto& shape : crtp_circles) sum += shape.area();
+    for (const auto& shape : crtp_squares) sum += shape.area();
+    for (const auto& shape : crtp_triangles) sum += shape.area();
+    return sum;
+  });
+
+  assert(virtual_final_sum == virtual_sum);
+  assert(variant_sum == virtual_sum && variant_final_sum == virtual_sum);
+  assert(closed_arrow_sum == virtual_sum && closed_sum == virtual_sum && closed_final_sum == virtual_sum);
+  assert(closed_qualified_sum == virtual_sum);
+  assert(table_sum == virtual_sum);
+  assert(crtp_sum > 0.999 * virtual_sum && crtp_sum < 1.001 * virtual_sum);
+}
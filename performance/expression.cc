@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "../language_itself/class_template.h"
+#include "common.h"
+#include "expression.h"
+
+/**
+ * 1. Lazy expressions compute the same values as eager loops
+ * 2. Fused evaluation against eager temporaries for chains of 2-8 operations
+ */
+
+// =================================================================
+// 1. Lazy expressions compute the same values as eager loops
+// =================================================================
+void test_expression() {
+  // Every size from 0 to 40 covers the unrolled pack loop, the single pack loop and the scalar tail
+  for (size_t n = 0; n <= 40; n++) {
+    Array<double> a(n), b(n), c(n), d(n), r(n);
+    for (size_t i = 0; i < n; i++) {
+      a[i] = double(i) + 1.0;
+      b[i] = 0.5 * double(i);
+      c[i] = 3.0 - double(i);
+      d[i] = double(i % 3);
+    }
+    r = a * b + c * d;
+    for (size_t i = 0; i < n; i++) {
+      assert(r[i] == a[i] * b[i] + c[i] * d[i]);
+    }
+    r = 2.0 * a - b / 4 + 1;
+    for (size_t i = 0; i < n; i++) {
+      assert(r[i] == 2.0 * a[i] - b[i] / 4 + 1);
+    }
+    r = expr::min(a, c) * -b;
+    for (size_t i = 0; i < n; i++) {
+      assert(r[i] == std::min(a[i], c[i]) * -b[i]);
+    }
+    // The destination may appear in the expression
+    a = a * b + a;
+    for (size_t i = 0; i < n; i++) {
+      assert(a[i] == (double(i) + 1.0) * b[i] + (double(i) + 1.0));
+    }
+    double dot {0.0};
+    for (size_t i = 0; i < n; i++) {
+      dot += b[i] * c[i];
+    }
+    assert(std::abs(expr::sum(b * c) - dot) <= 1e-9 * (1.0 + std::abs(dot)));
+  }
+
+  // Integers take the scalar loop, the expression has the type of `int * int + int`
+  Array<int> x(10), y(10);
+  for (size_t i = 0; i < 10; i++) {
+    x[i] = int(i);
+  }
+  y = x * x + 3;
+  assert(y[9] == 84 && expr::sum(y) == 285 + 30);
+
+  // StaticArray, including the double specialization with its SIMD kernels
+  StaticArray<double, 7> p;
+  StaticArray<double, 7> q;
+  StaticArray<int, 5> s;
+  for (size_t i = 0; i < 7; i++) {
+    p[i] = double(i);
+  }
+  q = p * p - p;
+  assert(q[6] == 30.0 && expr::sum(q) == q.sum());
+  s = s + 1;
+  assert(s[4] == 1);
+
+  // Negation keeps the sign of zero, and min/max return the second operand if either one is NaN, like the pack version
+  Array<double> z(9), nan(9), out(9);
+  for (size_t i = 0; i < 9; i++) {
+    z[i] = 0.0;
+    nan[i] = i % 2 == 0 ? std::numeric_limits<double>::quiet_NaN() : double(i);
+  }
+  out = -z;
+  assert(std::signbit(out[0]) && std::signbit(out[8]));
+  out = expr::min(nan, z);
+  for (size_t i = 0; i < 9; i++) {
+    assert(out[i] == 0.0);
+  }
+}
+
+// =================================================================
+// 2. Fused evaluation against eager temporaries for chains of 2-8 operations
+// =================================================================
+// The eager version is what multiply() and add() from function_template.cc do when they are applied to whole arrays:
+// every operation returns a new array.
+std::vector<double> eager_multiply(const std::vector<double>& a, const std::vector<double>& b) {
+  std::vector<double> result(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    result[i] = a[i] * b[i];
+  }
+  return result;
+}
+std::vector<double> eager_add(const std::vector<double>& a, const std::vector<double>& b) {
+  std::vector<double> result(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    result[i] = a[i] + b[i];
+  }
+  return result;
+}
+
+// in[0] * in[1] + in[2] * in[3] + ..., as a single expression type
+template <size_t K>
+auto lazy_chain(const std::vector<Array<double>*>& in) {
+  if constexpr (K == 0) {
+    return expr::as_node(*in[0]);
+  } else if constexpr (K % 2 == 1) {
+    return lazy_chain<K - 1>(in) * *in[K];
+  } else {
+    return lazy_chain<K - 1>(in) + *in[K];
+  }
+}
+
+std::vector<double> eager_chain(const std::vector<std::vector<double>>& in, size_t operations) {
+  std::vector<double> result = eager_multiply(in[0], in[1]);
+  for (size_t k = 2; k <= operations; k++) {
+    result = k % 2 == 1 ? eager_multiply(result, in[k]) : eager_add(result, in[k]);
+  }
+  return result;
+}
+
+void benchmark_expression(size_t n = size_t{1} << 22) {
+  constexpr size_t kMaxOperations {8};
+  std::vector<std::vector<double>> eager_inputs(kMaxOperations + 1, std::vector<double>(n));
+  std::vector<Array<double>*> lazy_inputs;
+  for (size_t k = 0; k <= kMaxOperations; k++) {
+    lazy_inputs.push_back(new Array<double>(n));
+    for (size_t i = 0; i < n; i++) {
+      eager_inputs[k][i] = (*lazy_inputs[k])[i] = 1.0 + double((i + k) % 7) * 1e-3;
+    }
+  }
+  Array<double> result(n);
+
+  auto run = [&]<size_t K>(std::integral_constant<size_t, K>) {
+    volatile double sink {0.0};
+    double lazy = best_seconds([&] {
+      result = lazy_chain<K>(lazy_inputs);
+      sink = result[n / 2];
+    });
+    double eager = best_seconds([&] {
+      std::vector<double> r = eager_chain(eager_inputs, K);
+      sink = r[n / 2];
+    });
+    // Memory traffic: the fused loop reads K + 1 arrays and writes one, every eager operation reads two and writes one
+    double bytes = double(n * sizeof(double)) * 1e-9;
+    std::cout << K << " operations: fused " << lazy * 1e3 << " ms (0 temporaries, " << double(K + 2) * bytes
+              << " GB moved), eager " << eager * 1e3 << " ms (" << K << " temporaries, " << double(3 * K) * bytes
+              << " GB moved), " << eager / lazy << "x" << std::endl;
+  };
+  [&]<size_t... K>(std::index_sequence<K...>) {
+    (run(std::integral_constant<size_t, K + 2> {}), ...);
+  }(std::make_index_sequence<kMaxOperations - 1> {});
+
+  for (Array<double>* input : lazy_inputs) {
+    delete input;
+  }
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "simd_pack.h"
+
+/**
+ * 1. Why eager element-wise operations are slow
+ * 2. Expression nodes
+ * 3. Evaluating an expression in one fused loop
+ * 4. Operators that build expressions instead of computing them
+ */
+
+// =================================================================
+// 1. Why eager element-wise operations are slow
+// =================================================================
+// With eager operators (like multiply() and add() in function_template.cc applied to whole arrays), `a * b + c * d`
+// computes a * b into a temporary array, c * d into a second one and their sum into a third one: three allocations,
+// and every element makes four round trips through memory instead of one. For arrays that don't fit into the cache,
+// memory bandwidth is the limit, so the eager version is several times slower than a hand-written loop.
+// An expression template makes `a * b + c * d` return a small object that only *describes* the computation, its type
+// is binary<plus, binary<multiplies, ...>, binary<multiplies, ...>>. The loop runs once, when the description is
+// assigned to an array, and computes r[i] = a[i] * b[i] + c[i] * d[i] directly, which the compiler inlines completely.
+
+namespace expr {
+
+// Containers opt in by specializing enable_terminal (see Array and StaticArray in class_template.h), so the operators
+// below never change the meaning of `+` for types that don't expect it.
+template <typename T>
+inline constexpr bool enable_terminal = false;
+
+// Every expression node derives from node_tag
+struct node_tag {};
+
+template <typename T>
+concept Node = std::is_base_of_v<node_tag, std::remove_cvref_t<T>>;
+
+template <typename T>
+concept Terminal = enable_terminal<std::remove_cvref_t<T>> && requires(const T& t) {
+  { t.data() };
+  { t.size() } -> std::convertible_to<size_t>;
+};
+
+template <typename T>
+concept Scalar = std::is_arithmetic_v<std::remove_cvref_t<T>>;
+
+template <typename T>
+concept Operand = Node<T> || Terminal<T>;
+
+// =================================================================
+// 2. Expression nodes
+// =================================================================
+// Every node has value_type, size(), operator[](i), and, when the whole subtree computes doubles, load(i), which
+// computes simd::double_pack::width elements at once (see simd_pack.h). Nodes hold their children by value, and the
+// leaves only hold a pointer to the data, so an expression must not outlive the arrays it refers to.
+using pack = simd::double_pack;
+
+// A scalar is broadcast to the size of the other operand
+constexpr size_t kBroadcast {SIZE_MAX};
+
+template <typename T>
+struct terminal : node_tag {
+  using value_type = T;
+  static constexpr bool packable = std::is_same_v<T, double>;
+
+  const T* data;
+  size_t length;
+
+  size_t size() const { return length; }
+  T operator[](size_t i) const { return data[i]; }
+  pack load(size_t i) const { return pack::load(data + i); }
+};
+
+template <typename T>
+struct scalar : node_tag {
+  using value_type = T;
+  static constexpr bool packable = true;
+
+  T value;
+
+  size_t size() const { return kBroadcast; }
+  T operator[](size_t) const { return value; }
+  pack load(size_t) const { return pack::set1(double(value)); }
+};
+
+template <typename Op, typename L, typename R>
+struct binary : node_tag {
+  using value_type = decltype(Op{}(std::declval<typename L::value_type>(), std::declval<typename R::value_type>()));
+  static constexpr bool packable = L::packable && R::packable && std::is_same_v<value_type, double>;
+
+  L left;
+  R right;
+
+  binary(L l, R r) : left(l), right(r) {
+    assert(left.size() == right.size() || left.size() == kBroadcast || right.size() == kBroadcast);
+  }
+
+  size_t size() const { return left.size() != kBroadcast ? left.size() : right.size(); }
+  value_type operator[](size_t i) const { return Op{}(left[i], right[i]); }
+  pack load(size_t i) const { return Op{}(left.load(i), right.load(i)); }
+};
+
+template <typename Op, typename E>
+struct unary : node_tag {
+  using value_type = decltype(Op{}(std::declval<typename E::value_type>()));
+  static constexpr bool packable = E::packable && std::is_same_v<value_type, double>;
+
+  E operand;
+
+  size_t size() const { return operand.size(); }
+  value_type operator[](size_t i) const { return Op{}(operand[i]); }
+  pack load(size_t i) const { return Op{}(operand.load(i)); }
+};
+
+// The operations, each one written once for scalars and once for packs
+struct plus {
+  template <typename A, typename B>
+  auto operator()(A a, B b) const { return a + b; }
+};
+struct minus {
+  template <typename A, typename B>
+  auto operator()(A a, B b) const { return a - b; }
+};
+struct multiplies {
+  template <typename A, typename B>
+  auto operator()(A a, B b) const { return a * b; }
+};
+struct divides {
+  template <typename A, typename B>
+  auto operator()(A a, B b) const { return a / b; }
+};
+// -0.0 - x flips the sign bit of every x, including 0.0, which 0.0 - x doesn't
+struct negate {
+  template <typename A>
+  auto operator()(A a) const { return -a; }
+  pack operator()(pack a) const { return pack::set1(-0.0) - a; }
+};
+// Same operand order as simd::double_pack::min/max: the second operand is returned if either one is NaN
+struct minimum {
+  template <typename A, typename B>
+  auto operator()(A a, B b) const { return a < b ? a : b; }
+  pack operator()(pack a, pack b) const { return pack::min(a, b); }
+};
+struct maximum {
+  template <typename A, typename B>
+  auto operator()(A a, B b) const { return a > b ? a : b; }
+  pack operator()(pack a, pack b) const { return pack::max(a, b); }
+};
+
+template <typename T>
+auto as_node(const T& x) {
+  if constexpr (Node<T>) {
+    return x;
+  } else if constexpr (Scalar<T>) {
+    return scalar<T> {{}, x};
+  } else {
+    using value_type = std::remove_cvref_t<decltype(*x.data())>;
+    return terminal<value_type> {{}, x.data(), size_t(x.size())};
+  }
+}
+
+template <typename Op, typename L, typename R>
+auto make_binary(const L& l, const R& r) {
+  using left_node = decltype(as_node(l));
+  using right_node = decltype(as_node(r));
+  return binary<Op, left_node, right_node> {as_node(l), as_node(r)};
+}
+
+// At least one side must be an array or an expression, `2.0 * 3.0` stays a plain multiplication
+template <typename L, typename R>
+concept BinaryOperands = (Operand<L> && (Operand<R> || Scalar<R>)) || (Scalar<L> && Operand<R>);
+
+// =================================================================
+// 3. Evaluating an expression in one fused loop
+// =================================================================
+// out[i] = e[i] for every i. When the expression computes doubles, the loop runs over whole packs, unrolled 4 times,
+// so a chain of operations on doubles is vectorized even where the compiler wouldn't vectorize the scalar loop.
+// `out` may be one of the arrays in the expression (a = a * b + c): every element is read before it is written.
+template <typename T, Node E>
+void assign(T* out, size_t size, const E& e) {
+  assert(e.size() == size || e.size() == kBroadcast);
+  size_t i = 0;
+  if constexpr (E::packable && std::is_same_v<T, double>) {
+    constexpr size_t width = pack::width;
+    for (; i + 4 * width <= size; i += 4 * width) {
+      e.load(i).store(out + i);
+      e.load(i + width).store(out + i + width);
+      e.load(i + 2 * width).store(out + i + 2 * width);
+      e.load(i + 3 * width).store(out + i + 3 * width);
+    }
+    for (; i + width <= size; i += width) {
+      e.load(i).store(out + i);
+    }
+  }
+  for (; i < size; i++) {
+    out[i] = e[i];
+  }
+}
+
+// A reduction consumes the expression directly, so sum(a * b) is a dot product without a temporary
+template <Operand E>
+auto sum(const E& expression) {
+  const auto e = as_node(expression);
+  using value_type = typename decltype(e)::value_type;
+  const size_t size = e.size();
+  size_t i = 0;
+  value_type result {};
+  if constexpr (decltype(e)::packable) {
+    constexpr size_t width = pack::width;
+    pack acc[4] {pack::zero(), pack::zero(), pack::zero(), pack::zero()};
+    for (; i + 4 * width <= size; i += 4 * width) {
+      acc[0] = acc[0] + e.load(i);
+      acc[1] = acc[1] + e.load(i + width);
+      acc[2] = acc[2] + e.load(i + 2 * width);
+      acc[3] = acc[3] + e.load(i + 3 * width);
+    }
+    for (; i + width <= size; i += width) {
+      acc[0] = acc[0] + e.load(i);
+    }
+    result = ((acc[0] + acc[1]) + (acc[2] + acc[3])).hsum();
+  }
+  for (; i < size; i++) {
+    result += e[i];
+  }
+  return result;
+}
+
+} // namespace expr
+
+// =================================================================
+// 4. Operators that build expressions instead of computing them
+// =================================================================
+// The arithmetic operators are declared in the global namespace, where Array and StaticArray live, so that
+// argument-dependent lookup finds them for `a * b`. They are constrained to expr operands, other types never see them.
+template <typename L, typename R>
+requires expr::BinaryOperands<L, R>
+auto operator+(const L& l, const R& r) {
+  return expr::make_binary<expr::plus>(l, r);
+}
+
+template <typename L, typename R>
+requires expr::BinaryOperands<L, R>
+auto operator-(const L& l, const R& r) {
+  return expr::make_binary<expr::minus>(l, r);
+}
+
+template <typename L, typename R>
+requires expr::BinaryOperands<L, R>
+auto operator*(const L& l, const R& r) {
+  return expr::make_binary<expr::multiplies>(l, r);
+}
+
+template <typename L, typename R>
+requires expr::BinaryOperands<L, R>
+auto operator/(const L& l, const R& r) {
+  return expr::make_binary<expr::divides>(l, r);
+}
+
+template <expr::Operand E>
+auto operator-(const E& e) {
+  using node = decltype(expr::as_node(e));
+  return expr::unary<expr::negate, node> {{}, expr::as_node(e)};
+}
+
+namespace expr {
+
+// min and max are named functions, a global operator can't be named min.
+template <typename L, typename R>
+requires BinaryOperands<L, R>
+auto min(const L& l, const R& r) {
+  return make_binary<minimum>(l, r);
+}
+
+template <typename L, typename R>
+requires BinaryOperands<L, R>
+auto max(const L& l, const R& r) {
+  return make_binary<maximum>(l, r);
+}
+
+} // namespace expr
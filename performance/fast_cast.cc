@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "fast_cast.h"
+
+/**
+ * 1. A diamond with a virtual base, like BaseCls6 ... DerivedCls9 in class_inheritance.h
+ * 2. Up-, down- and cross-casts agree with dynamic_cast
+ * 3. fast_cast vs dynamic_cast
+ */
+
+// =================================================================
+// 1. A diamond with a virtual base, like BaseCls6 ... DerivedCls9 in class_inheritance.h
+// =================================================================
+// BaseCls6 isn't polymorphic, so dynamic_cast can't be used on it at all; this copy adds the fast_castable root.
+class Node : public fast_castable {
+  public:
+    explicit Node(int id) : id_(id) {}
+    fast_cast_record fast_cast_self() const override { return fast_cast_record_of(this); }
+    int id_;
+};
+
+class NodeLeft : virtual public Node {
+  public:
+    explicit NodeLeft(int id) : Node(id) {}
+    fast_cast_record fast_cast_self() const override { return fast_cast_record_of(this); }
+    int left_ {1};
+};
+
+class NodeRight : virtual public Node {
+  public:
+    explicit NodeRight(int id) : Node(id) {}
+    fast_cast_record fast_cast_self() const override { return fast_cast_record_of(this); }
+    int right_ {2};
+};
+
+class NodeDiamond : public NodeLeft, public NodeRight {
+  public:
+    explicit NodeDiamond(int id) : Node(id), NodeLeft(id), NodeRight(id) {}
+    fast_cast_record fast_cast_self() const override { return fast_cast_record_of(this); }
+    int diamond_ {3};
+};
+
+template <> struct fast_cast_traits<Node> {
+  static constexpr uint32_t id {0};
+  using bases = fast_cast_bases<>;
+};
+template <> struct fast_cast_traits<NodeLeft> {
+  static constexpr uint32_t id {1};
+  using bases = fast_cast_bases<Node>;
+};
+template <> struct fast_cast_traits<NodeRight> {
+  static constexpr uint32_t id {2};
+  using bases = fast_cast_bases<Node>;
+};
+template <> struct fast_cast_traits<NodeDiamond> {
+  static constexpr uint32_t id {3};
+  using bases = fast_cast_bases<NodeLeft, NodeRight>;
+};
+
+// Two siblings that reuse an ID by mistake: no class sees both, so only the owner recorded in the table can tell
+// them apart
+class Vehicle : public fast_castable {
+  public:
+    fast_cast_record fast_cast_self() const override { return fast_cast_record_of(this); }
+};
+class Car : public Vehicle {
+  public:
+    fast_cast_record fast_cast_self() const override { return fast_cast_record_of(this); }
+};
+class Boat : public Vehicle {
+  public:
+    fast_cast_record fast_cast_self() const override { return fast_cast_record_of(this); }
+};
+template <> struct fast_cast_traits<Vehicle> {
+  static constexpr uint32_t id {0};
+  using bases = fast_cast_bases<>;
+};
+template <> struct fast_cast_traits<Car> {
+  static constexpr uint32_t id {1};
+  using bases = fast_cast_bases<Vehicle>;
+};
+template <> struct fast_cast_traits<Boat> {
+  static constexpr uint32_t id {1};
+  using bases = fast_cast_bases<Vehicle>;
+};
+
+// =================================================================
+// 2. Up-, down- and cross-casts agree with dynamic_cast
+// =================================================================
+void test_fast_cast() {
+  // Within one line of descent a duplicate ID is a compile error (offset_table's static_assert)
+  using fast_cast_detail::type_list;
+  static_assert(fast_cast_detail::unique_ids(fast_cast_detail::ancestors<NodeDiamond>::type{}));
+  static_assert(!fast_cast_detail::unique_ids(type_list<Car, Boat, Vehicle>{}));
+  Car car;
+  const Vehicle* vehicle = &car;
+  assert(fast_cast<Boat>(vehicle) == nullptr && dynamic_cast<const Boat*>(vehicle) == nullptr);
+  assert(fast_cast<Car>(vehicle) == &car);
+
+
+  NodeDiamond diamond {7};
+  NodeLeft left {8};
+  NodeRight right {9};
+
+  // Downcasts through the virtual base: static_cast can't do them, they need the offset of the complete object
+  for (const Node* node : {static_cast<Node*>(&diamond), static_cast<Node*>(&left), static_cast<Node*>(&right)}) {
+    assert(fast_cast<NodeDiamond>(node) == dynamic_cast<const NodeDiamond*>(node));
+    assert(fast_cast<NodeLeft>(node) == dynamic_cast<const NodeLeft*>(node));
+    assert(fast_cast<NodeRight>(node) == dynamic_cast<const NodeRight*>(node));
+    assert(fast_cast<Node>(node) == node);
+  }
+  // Cross-casts between the two sides of the diamond
+  NodeLeft* as_left = &diamond;
+  NodeRight* as_right = &diamond;
+  assert(fast_cast<NodeRight>(as_left) == as_right);
+  assert(fast_cast<NodeLeft>(as_right) == as_left);
+  assert(fast_cast<NodeRight>(static_cast<NodeLeft*>(&left)) == nullptr);
+  assert(fast_cast<NodeRight>(as_left)->right_ == 2);
+  // Upcasts
+  assert(fast_cast<Node>(&diamond) == static_cast<Node*>(&diamond));
+  assert(fast_cast<NodeLeft>(&diamond)->left_ == 1);
+  assert(fast_cast<NodeDiamond>(static_cast<Node*>(nullptr)) == nullptr);
+}
+
+// =================================================================
+// 3. fast_cast vs dynamic_cast
+// =================================================================
+// The objects are a random mix of the three concrete classes, so about a third of the down- and cross-casts succeed.
+template <typename Fn>
+void time_casts(const char* name, size_t count, Fn&& fn) {
+  double best {1e9};
+  size_t hits {0};
+  for (int round = 0; round < 5; round++) {
+    auto start = std::chrono::steady_clock::now();
+    hits = fn();
+    best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+  }
+  std::cout << name << ": " << best / double(count) << " ns/cast (" << hits << " hits)" << std::endl;
+}
+
+void benchmark_fast_cast(size_t count = 1'000'000) {
+  std::mt19937 rng {42};
+  std::vector<std::unique_ptr<Node>> nodes;
+  std::vector<Node*> bases;
+  std::vector<NodeLeft*> lefts;
+  std::vector<NodeDiamond*> diamonds;
+  for (size_t i = 0; i < count; i++) {
+    switch (rng() % 3) {
+      case 0: {
+        auto node = std::make_unique<NodeDiamond>(int(i));
+        diamonds.push_back(node.get());
+        lefts.push_back(node.get());
+        nodes.push_back(std::move(node));
+        break;
+      }
+      case 1: {
+        auto node = std::make_unique<NodeLeft>(int(i));
+        lefts.push_back(node.get());
+        nodes.push_back(std::move(node));
+        break;
+      }
+      default:
+        nodes.push_back(std::make_unique<NodeRight>(int(i)));
+        break;
+    }
+    bases.push_back(nodes.back().get());
+  }
+
+  auto count_hits = [](const auto& pointers, auto&& cast) {
+    size_t hits {0};
+    for (auto* p : pointers) {
+      hits += cast(p) != nullptr;
+    }
+    return hits;
+  };
+  // Upcasts to a virtual base: dynamic_cast and fast_cast both compile to a static conversion through the vbase offset
+  time_casts("up    dynamic_cast", diamonds.size(), [&] {
+    return count_hits(diamonds, [](NodeDiamond* p) { return dynamic_cast<Node*>(p); });
+  });
+  time_casts("up    fast_cast", diamonds.size(), [&] {
+    return count_hits(diamonds, [](NodeDiamond* p) { return fast_cast<Node>(p); });
+  });
+  time_casts("down  dynamic_cast", bases.size(), [&] {
+    return count_hits(bases, [](Node* p) { return dynamic_cast<NodeDiamond*>(p); });
+  });
+  time_casts("down  fast_cast", bases.size(), [&] {
+    return count_hits(bases, [](Node* p) { return fast_cast<NodeDiamond>(p); });
+  });
+  time_casts("cross dynamic_cast", lefts.size(), [&] {
+    return count_hits(lefts, [](NodeLeft* p) { return dynamic_cast<NodeRight*>(p); });
+  });
+  time_casts("cross fast_cast", lefts.size(), [&] {
+    return count_hits(lefts, [](NodeLeft* p) { return fast_cast<NodeRight>(p); });
+  });
+}
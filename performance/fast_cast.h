@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <typeinfo>
+
+/**
+ * 1. Why dynamic_cast is slow in deep and virtual hierarchies
+ * 2. Registering a class: a compile-time type ID and its direct bases
+ * 3. Ancestor sets computed at compile time
+ * 4. Offset tables per dynamic type, filled on first use
+ * 5. fast_cast<T>
+ */
+
+// =================================================================
+// 1. Why dynamic_cast is slow in deep and virtual hierarchies
+// =================================================================
+// dynamic_cast (see class_inheritance.h) has to find the target type in the inheritance graph of the dynamic type at
+// runtime: it walks the type_info of every base class, and with the Itanium ABI, type_info objects from different
+// shared libraries are compared by their mangled names, i.e. string compares. The cost grows with the depth of the
+// hierarchy, and cross-casts (from one base to a sibling base, as in the DerivedCls9 diamond) are the slowest case.
+// fast_cast is an opt-in replacement: every class gets a small integer ID at compile time, and every dynamic type gets
+// a table, indexed by that ID, with the offset of each of its ancestors inside the complete object. A cast is then one
+// virtual call to find the complete object and its table, and one table lookup.
+
+namespace fast_cast_detail {
+template <typename... Ts>
+struct type_list {};
+}
+
+// =================================================================
+// 2. Registering a class: a compile-time type ID and its direct bases
+// =================================================================
+// Each class that takes part specializes fast_cast_traits, e.g.
+//   template <> struct fast_cast_traits<DerivedCls9> {
+//     static constexpr uint32_t id {3};
+//     using bases = fast_cast_bases<DerivedCls7, DerivedCls8>;
+//   };
+// IDs must be unique within a hierarchy, and should be small and dense since they index the offset tables. Two classes
+// on the same line of descent with the same ID don't compile (see offset_table()). Siblings can't be checked at
+// compile time, since no class sees both of them; every table entry remembers which class it belongs to, so a cast
+// to a sibling that reuses an ID fails like dynamic_cast instead of returning the wrong object.
+template <typename T>
+struct fast_cast_traits;
+
+template <typename... Bases>
+using fast_cast_bases = fast_cast_detail::type_list<Bases...>;
+
+// The root of a hierarchy derives from fast_castable, and every class overrides fast_cast_self() with
+//   fast_cast_record fast_cast_self() const override { return fast_cast_record_of(this); }
+// which is how a pointer of any static type finds its complete object and the table of its dynamic type. A class that
+// forgets the override would silently use the table of its base, so fast_cast_record_of() asserts that it's called
+// for the dynamic type.
+struct fast_cast_entry {
+  ptrdiff_t offset;  // of the ancestor in the complete object
+  const void* type;  // the ancestor that owns this ID, see type_tag below
+};
+
+struct fast_cast_record {
+  const void* self;                // the complete (most derived) object
+  const fast_cast_entry* entries;  // one per type ID
+  size_t size;
+};
+
+class fast_castable {
+  public:
+    virtual ~fast_castable() = default;
+    virtual fast_cast_record fast_cast_self() const = 0;
+};
+
+namespace fast_cast_detail {
+
+// =================================================================
+// 3. Ancestor sets computed at compile time
+// =================================================================
+// The ancestors of T are T itself plus the ancestors of each direct base. A virtual base reachable through several
+// paths shows up several times in the list, which is harmless, it gets the same table entry every time.
+template <typename... Lists>
+struct concat;
+template <>
+struct concat<> {
+  using type = type_list<>;
+};
+template <typename... Ts>
+struct concat<type_list<Ts...>> {
+  using type = type_list<Ts...>;
+};
+template <typename... Ts, typename... Us, typename... Rest>
+struct concat<type_list<Ts...>, type_list<Us...>, Rest...> {
+  using type = typename concat<type_list<Ts..., Us...>, Rest...>::type;
+};
+
+template <typename T, typename Bases = typename fast_cast_traits<T>::bases>
+struct ancestors;
+template <typename T, typename... Bases>
+struct ancestors<T, type_list<Bases...>> {
+  using type = typename concat<type_list<T>, typename ancestors<Bases>::type...>::type;
+};
+
+template <typename... Ts>
+constexpr uint32_t max_id(type_list<Ts...>) {
+  uint32_t result {0};
+  ((result = fast_cast_traits<Ts>::id > result ? fast_cast_traits<Ts>::id : result), ...);
+  return result;
+}
+
+// A base that is inherited non-virtually through two paths is ambiguous: like dynamic_cast, we fail such a cast
+template <typename Derived, typename Base>
+concept unambiguous_base = std::is_base_of_v<Base, Derived> && std::is_convertible_v<const Derived*, const Base*>;
+
+constexpr ptrdiff_t kNotAncestor {PTRDIFF_MIN};
+
+// A unique address per class, cheaper to compare than a std::type_info
+template <typename T>
+inline constexpr char type_tag {};
+
+// Distinct classes in the list have distinct IDs. A class reachable through several paths is listed several times,
+// which is fine: it's the same class.
+template <typename T, typename... Ts>
+constexpr bool id_unique_in = ((std::is_same_v<T, Ts> || fast_cast_traits<T>::id != fast_cast_traits<Ts>::id) && ...);
+template <typename... Ts>
+constexpr bool unique_ids(type_list<Ts...>) {
+  return (id_unique_in<Ts, Ts...> && ...);
+}
+
+// =================================================================
+// 4. Offset tables per dynamic type, filled on first use
+// =================================================================
+// For a complete object of type D, the position of every base class subobject is fixed, including virtual bases (their
+// offset only varies between different most-derived types, and D *is* the most-derived type here). Virtual base
+// offsets can only be read from a live object, so the offsets are not precomputed: the table is filled at runtime
+// from the first complete D we see, once, thread-safely. Only the set of ancestors and their IDs is compile-time.
+template <typename D, typename... Ancestors>
+const std::array<fast_cast_entry, max_id(type_list<Ancestors...>{}) + 1>& offset_table(const D* self,
+                                                                                        type_list<Ancestors...>) {
+  static_assert(unique_ids(type_list<Ancestors...>{}),
+                "two classes among D and its ancestors share a fast_cast_traits<>::id");
+  static const auto table = [self] {
+    std::array<fast_cast_entry, max_id(type_list<Ancestors...>{}) + 1> entries;
+    entries.fill({kNotAncestor, nullptr});
+    const char* base = reinterpret_cast<const char*>(self);
+    auto add = [&]<typename A>(const A*) {
+      if constexpr (unambiguous_base<D, A>) {
+        entries[fast_cast_traits<A>::id] = {reinterpret_cast<const char*>(static_cast<const A*>(self)) - base,
+                                            &type_tag<A>};
+      }
+    };
+    (add(static_cast<const Ancestors*>(nullptr)), ...);
+    return entries;
+  }();
+  return table;
+}
+
+} // namespace fast_cast_detail
+
+template <typename D>
+fast_cast_record fast_cast_record_of(const D* self) {
+  // Called from the fast_cast_self() of a base: the class of *self doesn't override it
+  assert(typeid(*self) == typeid(D) && "every class in a fast_cast hierarchy must override fast_cast_self()");
+  const auto& table = fast_cast_detail::offset_table(self, typename fast_cast_detail::ancestors<D>::type{});
+  return {self, table.data(), table.size()};
+}
+
+// =================================================================
+// 5. fast_cast<T>
+// =================================================================
+// Same contract as dynamic_cast<T*>: returns nullptr if the object isn't a T (or if T is an ambiguous base).
+// Upcasts to an unambiguous static base don't even need the table, they are plain pointer conversions.
+template <typename T, typename P>
+requires std::is_base_of_v<fast_castable, P>
+const T* fast_cast(const P* p) {
+  if constexpr (fast_cast_detail::unambiguous_base<P, T>) {
+    return p;
+  } else {
+    if (p == nullptr) {
+      return nullptr;
+    }
+    const fast_cast_record record = p->fast_cast_self();
+    constexpr uint32_t id = fast_cast_traits<T>::id;
+    if (id >= record.size || record.entries[id].type != &fast_cast_detail::type_tag<T>) {
+      return nullptr;
+    }
+    return reinterpret_cast<const T*>(static_cast<const char*>(record.self) + record.entries[id].offset);
+  }
+}
+
+template <typename T, typename P>
+requires std::is_base_of_v<fast_castable, P>
+T* fast_cast(P* p) {
+  return const_cast<T*>(fast_cast<T>(static_cast<const P*>(p)));
+}
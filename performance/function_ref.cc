@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "function_ref.h"
+
+/**
+ * 1. function_ref and inplace_function hold the same callables as std::function
+ * 2. Construction and invocation against std::function and raw lambdas
+ */
+
+// The same callables as test_std_function() in function_lambda.cc
+int add_numbers(int a, int b) {
+  return a + b;
+}
+class Adder2 {
+  public:
+    int operator()(int a, int b) const {
+      return a + b;
+    }
+};
+
+int apply_twice(function_ref<int(int, int)> fn, int a, int b) {
+  return fn(fn(a, b), b);
+}
+
+// =================================================================
+// 1. function_ref and inplace_function hold the same callables as std::function
+// =================================================================
+void test_function_ref() {
+  Adder2 adder;
+  int offset {10};
+  auto lambda = [offset](int a, int b) { return a + b + offset; };
+
+  assert(apply_twice(add_numbers, 1, 2) == 5);
+  assert(apply_twice(adder, 1, 2) == 5);
+  assert(apply_twice(lambda, 1, 2) == 25);
+  assert(apply_twice([](int a, int b) { return a * b; }, 3, 4) == 48);
+
+  std::array<inplace_function<int(int, int)>, 3> functions;
+  functions[0] = add_numbers;
+  functions[1] = adder;
+  functions[2] = lambda;
+  assert(functions[0](1, 2) == 3 && functions[1](1, 2) == 3 && functions[2](1, 2) == 13);
+
+  // Copies and moves keep the captured state
+  std::string name {"a string that is too long for the small string optimization"};
+  inplace_function<size_t(), 64> size_of {[name] { return name.size(); }};
+  inplace_function<size_t(), 64> copy {size_of};
+  inplace_function<size_t(), 64> moved {std::move(size_of)};
+  assert(copy() == name.size() && moved() == name.size());
+  assert(!size_of);
+
+  // A capture bigger than the capacity doesn't compile:
+  // std::array<char, 100> big {};
+  // inplace_function<int(), 32> too_big {[big] { return int(big[0]); }}; // error: the callable doesn't fit
+}
+
+// =================================================================
+// 2. Construction and invocation against std::function and raw lambdas
+// =================================================================
+// The lambda captures 24 bytes, more than the 16-byte small buffer of libstdc++'s std::function, so constructing the
+// std::function allocates, while inplace_function and function_ref don't.
+template <typename Fn>
+double time_ns(size_t count, Fn&& fn) {
+  double best {1e18};
+  for (int round = 0; round < 5; round++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best / double(count);
+}
+
+// noinline keeps the compiler from seeing through the callable at the call site, as it couldn't in real code
+template <typename F>
+[[gnu::noinline]] long long call_many(const F& fn, const std::vector<int>& values) {
+  long long sum {0};
+  for (int v : values) {
+    sum += fn(v, 1);
+  }
+  return sum;
+}
+
+void benchmark_function_ref(size_t count = 10'000'000) {
+  std::vector<int> values(count);
+  for (size_t i = 0; i < count; i++) {
+    values[i] = int(i % 1000);
+  }
+  long long a {1};
+  long long b {2};
+  long long c {3};
+  auto lambda = [a, b, c](int x, int y) { return int(x * a + y * b + c); };
+
+  volatile long long sink {0};
+  double construct_std = time_ns(count, [&] {
+    for (size_t i = 0; i < count; i++) {
+      std::function<int(int, int)> fn {lambda};
+      sink = fn(1, 2);
+    }
+  });
+  double construct_inplace = time_ns(count, [&] {
+    for (size_t i = 0; i < count; i++) {
+      inplace_function<int(int, int)> fn {lambda};
+      sink = fn(1, 2);
+    }
+  });
+  double construct_ref = time_ns(count, [&] {
+    for (size_t i = 0; i < count; i++) {
+      function_ref<int(int, int)> fn {lambda};
+      sink = fn(1, 2);
+    }
+  });
+
+  std::function<int(int, int)> std_fn {lambda};
+  inplace_function<int(int, int)> inplace_fn {lambda};
+  function_ref<int(int, int)> ref_fn {lambda};
+  double call_lambda = time_ns(count, [&] { sink = call_many(lambda, values); });
+  double call_std = time_ns(count, [&] { sink = call_many(std_fn, values); });
+  double call_inplace = time_ns(count, [&] { sink = call_many(inplace_fn, values); });
+  double call_ref = time_ns(count, [&] { sink = call_many(ref_fn, values); });
+
+  std::cout << "construct + call once (ns): std::function " << construct_std << ", inplace_function "
+            << construct_inplace << ", function_ref " << construct_ref << std::endl
+            << "call (ns): lambda " << call_lambda << ", std::function " << call_std << ", inplace_function "
+            << call_inplace << ", function_ref " << call_ref << std::endl;
+}
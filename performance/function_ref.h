@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 1. What std::function costs
+ * 2. function_ref<Sig>: a non-owning callable for parameters
+ * 3. inplace_function<Sig, Capacity>: an owning callable that never allocates
+ */
+
+// =================================================================
+// 1. What std::function costs
+// =================================================================
+// std::function (see test_std_function() in function_lambda.cc) owns a copy of the callable. If the callable is bigger
+// than the small buffer of the implementation (16 bytes in libstdc++), constructing the std::function allocates it on
+// the heap. A call goes through a type-erased manager/invoker pointer, and then through the stored callable.
+// For a parameter that is only called during the function call, owning a copy is unnecessary, and for a stored
+// callback we often know an upper bound of its size, so both cases can avoid the allocation.
+
+template <typename Sig>
+class function_ref;
+
+// =================================================================
+// 2. function_ref<Sig>: a non-owning callable for parameters
+// =================================================================
+// function_ref is two pointers: the address of the callable and a function that knows its type and calls it.
+// It doesn't copy the callable, so it must not outlive it, exactly like std::string_view and the string it refers to.
+// Use it for parameters, never store it:
+//   void for_each_pair(function_ref<int(int, int)> fn);
+//   for_each_pair([&](int a, int b) { return a + b + offset; }); // OK, the lambda lives until the call returns
+template <typename R, typename... Args>
+class function_ref<R(Args...)> {
+  public:
+    template <typename F>
+    requires (!std::is_same_v<std::remove_cvref_t<F>, function_ref> && !std::is_function_v<std::remove_reference_t<F>> &&
+              std::is_invocable_r_v<R, F&, Args...>)
+    function_ref(F&& fn) noexcept
+        : object_(const_cast<void*>(static_cast<const void*>(std::addressof(fn)))),
+          invoker_([](void* object, Args... args) -> R {
+            return std::invoke(*static_cast<std::add_pointer_t<F>>(object), std::forward<Args>(args)...);
+          }) {}
+
+    // A plain function pointer is stored directly, so function_ref doesn't dangle when built from a function name
+    function_ref(R (*fn)(Args...)) noexcept
+        : object_(reinterpret_cast<void*>(fn)),
+          invoker_([](void* object, Args... args) -> R {
+            return reinterpret_cast<R (*)(Args...)>(object)(std::forward<Args>(args)...);
+          }) {}
+
+    R operator()(Args... args) const {
+      return invoker_(object_, std::forward<Args>(args)...);
+    }
+
+  private:
+    void* object_;
+    R (*invoker_)(void*, Args...);
+};
+
+// =================================================================
+// 3. inplace_function<Sig, Capacity>: an owning callable that never allocates
+// =================================================================
+// Like std::function, but the callable is always stored in a buffer of Capacity bytes inside the object. A callable
+// that doesn't fit is a compile error instead of a hidden heap allocation, so the cost is visible where it is created.
+template <typename Sig, size_t Capacity = 32, size_t Alignment = alignof(std::max_align_t)>
+class inplace_function;
+
+template <typename R, typename... Args, size_t Capacity, size_t Alignment>
+class inplace_function<R(Args...), Capacity, Alignment> {
+  // One table per stored type for the lifetime operations, like the hand-built vtable of poly_value (see poly_value.h).
+  // The invoker is kept in the object itself, so a call loads one function pointer, like function_ref.
+  using invoker = R (*)(void* storage, Args&&... args);
+  template <typename F>
+  static R invoke_as(void* storage, Args&&... args) {
+    return std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+  }
+
+  struct ops {
+    void (*copy)(const void* src, void* dst);
+    void (*move)(void* src, void* dst) noexcept;
+    void (*destroy)(void* storage) noexcept;
+  };
+
+  template <typename F>
+  static constexpr ops ops_for {
+    [](const void* src, void* dst) { ::new (dst) F(*static_cast<const F*>(src)); },
+    [](void* src, void* dst) noexcept {
+      ::new (dst) F(std::move(*static_cast<F*>(src)));
+      static_cast<F*>(src)->~F();
+    },
+    [](void* storage) noexcept { static_cast<F*>(storage)->~F(); },
+  };
+
+  public:
+    inplace_function() noexcept = default;
+
+    template <typename F, typename Fn = std::decay_t<F>>
+    requires (!std::is_same_v<Fn, inplace_function> && std::is_invocable_r_v<R, Fn&, Args...>)
+    inplace_function(F&& fn) {
+      static_assert(sizeof(Fn) <= Capacity, "the callable doesn't fit into the inplace_function, increase Capacity");
+      static_assert(Alignment % alignof(Fn) == 0, "the callable is over-aligned for the inplace_function");
+      static_assert(std::is_nothrow_move_constructible_v<Fn>, "the callable must be nothrow move constructible");
+      static_assert(std::is_copy_constructible_v<Fn>, "the callable must be copy constructible");
+      ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(fn));
+      ops_ = &ops_for<Fn>;
+      invoke_ = &invoke_as<Fn>;
+    }
+
+    inplace_function(const inplace_function& other) : ops_(other.ops_), invoke_(other.invoke_) {
+      if (ops_ != nullptr) {
+        ops_->copy(other.storage_, storage_);
+      }
+    }
+
+    inplace_function(inplace_function&& other) noexcept
+        : ops_(std::exchange(other.ops_, nullptr)), invoke_(std::exchange(other.invoke_, nullptr)) {
+      if (ops_ != nullptr) {
+        ops_->move(other.storage_, storage_);
+      }
+    }
+
+    inplace_function& operator=(const inplace_function& other) {
+      if (this != &other) {
+        inplace_function copy {other};
+        *this = std::move(copy);
+      }
+      return *this;
+    }
+
+    inplace_function& operator=(inplace_function&& other) noexcept {
+      if (this != &other) {
+        reset();
+        ops_ = std::exchange(other.ops_, nullptr);
+        invoke_ = std::exchange(other.invoke_, nullptr);
+        if (ops_ != nullptr) {
+          ops_->move(other.storage_, storage_);
+        }
+      }
+      return *this;
+    }
+
+    ~inplace_function() {
+      reset();
+    }
+
+    // Calling an empty inplace_function throws std::bad_function_call, like std::function
+    R operator()(Args... args) const {
+      if (invoke_ == nullptr) {
+        throw std::bad_function_call();
+      }
+      return invoke_(const_cast<unsigned char*>(storage_), std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  private:
+    void reset() {
+      if (ops_ != nullptr) {
+        ops_->destroy(storage_);
+        ops_ = nullptr;
+        invoke_ = nullptr;
+      }
+    }
+
+    alignas(Alignment) unsigned char storage_[Capacity];
+    const ops* ops_ {nullptr};
+    invoker invoke_ {nullptr};
+};
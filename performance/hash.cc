@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "hash.h"
+#include "perf_counters.h"
+
+// cpu_dispatch.h (through hash.h) defines CPU_DISPATCH_X86
+#if defined(CPU_DISPATCH_X86)
+#include <x86intrin.h>
+#endif
+
+/**
+ * 1. Quality tests in the style of SMHasher
+ * 2. Throughput in bytes per cycle
+ */
+
+// =================================================================
+// 1. Quality tests in the style of SMHasher
+// =================================================================
+// Avalanche: flipping any single input bit must flip every output bit with probability 1/2. Returns the worst
+// deviation from 1/2 over all (input bit, output bit) pairs. Only every bit_step-th input bit is tested for long keys.
+template <typename Hash>
+double avalanche_bias(Hash&& hash, size_t size, size_t samples, size_t bit_step = 1) {
+  std::mt19937_64 random {size};
+  std::vector<unsigned char> key(size);
+  std::vector<uint32_t> flips((size * 8 + bit_step - 1) / bit_step * 64, 0);
+  for (size_t sample = 0; sample < samples; sample++) {
+    for (unsigned char& byte : key) {
+      byte = static_cast<unsigned char>(random());
+    }
+    uint64_t original = hash(key.data(), size);
+    for (size_t bit = 0, row = 0; bit < size * 8; bit += bit_step, row++) {
+      key[bit / 8] ^= static_cast<unsigned char>(1u << (bit % 8));
+      uint64_t changed = original ^ hash(key.data(), size);
+      key[bit / 8] ^= static_cast<unsigned char>(1u << (bit % 8));
+      for (size_t out = 0; out < 64; out++) {
+        flips[row * 64 + out] += (changed >> out) & 1;
+      }
+    }
+  }
+  double worst {0.0};
+  for (uint32_t count : flips) {
+    worst = std::max(worst, std::abs(double(count) / double(samples) - 0.5));
+  }
+  return worst;
+}
+
+template <typename Key, typename Hash>
+size_t count_collisions(const std::vector<Key>& keys, Hash&& hash) {
+  std::vector<uint64_t> hashes;
+  hashes.reserve(keys.size());
+  for (const Key& key : keys) {
+    hashes.push_back(hash(key));
+  }
+  std::sort(hashes.begin(), hashes.end());
+  return size_t(hashes.end() - std::unique(hashes.begin(), hashes.end()));
+}
+
+// The fullest bucket of a power-of-two table that uses the low bits of the hash, relative to the average
+template <typename Key, typename Hash>
+double worst_bucket_load(const std::vector<Key>& keys, Hash&& hash, size_t buckets) {
+  std::vector<size_t> load(buckets, 0);
+  for (const Key& key : keys) {
+    load[hash(key) & (buckets - 1)]++;
+  }
+  return double(*std::max_element(load.begin(), load.end())) * double(buckets) / double(keys.size());
+}
+
+void test_hash() {
+  using namespace hashing;
+  const uint64_t seed {0};
+  auto bytes = [seed](const unsigned char* p, size_t size) { return hash_bytes(p, size, seed); };
+  auto integer = [](const unsigned char* p, size_t) {
+    uint64_t value;
+    std::memcpy(&value, p, 8);
+    return uint64_t(hash<uint64_t>{}(value));
+  };
+
+  // Avalanche over every code path: the integer mix, 1-3 bytes, 4-16 bytes, the 16-byte loop and the bulk path.
+  // With 10000 samples the standard deviation of a flip probability is 0.005, so 0.03 is a generous 6 sigma.
+  // 1-byte keys are left out: there are only 256 of them, too few for the bias of even a random function to be small.
+  assert(avalanche_bias(integer, 8, 10000) < 0.03);
+  for (size_t size : {2, 3, 4, 7, 8, 12, 16, 17, 40, 100, 256}) {
+    assert(avalanche_bias(bytes, size, 10000, size <= 16 ? 1 : 7) < 0.03);
+  }
+  for (size_t size : {257, 1000, 5000}) {
+    assert(avalanche_bias(bytes, size, 2000, 37) < 0.07);
+  }
+
+  // Sparse keys: every 64-bit integer with at most two bits set, and every 32-byte or 1000-byte key with one or two
+  // bits set. These are the keys that weak hashes (and the identity) map to few distinct values after truncation.
+  std::vector<uint64_t> sparse_integers {0};
+  for (int i = 0; i < 64; i++) {
+    sparse_integers.push_back(uint64_t(1) << i);
+    for (int j = i + 1; j < 64; j++) {
+      sparse_integers.push_back((uint64_t(1) << i) | (uint64_t(1) << j));
+    }
+  }
+  assert(count_collisions(sparse_integers, hash<uint64_t>{}) == 0);
+  assert(count_collisions(sparse_integers, [](uint64_t x) { return hash<uint64_t>{}(x) & 0xFFFFFFFFu; }) == 0);
+  for (size_t size : {32, 1000}) {
+    std::vector<std::string> sparse_strings {std::string(size, '\0')};
+    for (size_t i = 0; i < size * 8; i++) {
+      std::string key(size, '\0');
+      key[i / 8] = char(1 << (i % 8));
+      sparse_strings.push_back(key);
+      for (size_t j = i + 1; size <= 32 && j < size * 8; j++) {
+        std::string key2 = key;
+        key2[j / 8] ^= char(1 << (j % 8));
+        sparse_strings.push_back(key2);
+      }
+    }
+    assert(count_collisions(sparse_strings, hash<std::string>{}) == 0);
+  }
+
+  // Text keys like the ones in std_map.cc, and keys that only differ in their length
+  std::vector<std::string> text_keys;
+  for (int i = 0; i < 1'000'000; i++) {
+    text_keys.push_back("key_" + std::to_string(i));
+  }
+  assert(count_collisions(text_keys, hash<std::string>{}) == 0);
+  assert(count_collisions(std::vector<std::string>{"", std::string(1, '\0'), std::string(2, '\0'),
+                                                   std::string(17, '\0'), std::string(300, '\0')},
+                          hash<std::string>{}) == 0);
+
+  // Strided integers all land in bucket 0 with the identity, and spread evenly with the mix
+  std::vector<uint64_t> strided;
+  for (uint64_t i = 0; i < 1'000'000; i++) {
+    strided.push_back(i << 12);
+  }
+  assert(worst_bucket_load(strided, std::hash<uint64_t>{}, 1024) == 1024.0);
+  assert(worst_bucket_load(strided, hash<uint64_t>{}, 1024) < 1.2);
+
+  // Pairs and tuples are order sensitive, and equal values hash equal
+  using Triple = std::tuple<int, int, int>;
+  assert(hash<Triple>{}({1, 2, 3}) != hash<Triple>{}({3, 2, 1}));
+  assert((hash<std::pair<int, int>>{}({1, 2}) != hash<std::pair<int, int>>{}({2, 1})));
+  assert((hash<std::pair<int, std::string>>{}({1, "one"}) == hash<std::pair<int, std::string>>{}({1, "one"})));
+  std::vector<Triple> grid;
+  for (int x = 0; x < 100; x++) {
+    for (int y = 0; y < 100; y++) {
+      for (int z = 0; z < 100; z++) {
+        grid.emplace_back(x, y, z);
+      }
+    }
+  }
+  assert(count_collisions(grid, hash<Triple>{}) == 0);
+  assert(hash<double>{}(0.0) == hash<double>{}(-0.0));
+
+  // Heterogeneous lookup: find() with a string_view doesn't construct a std::string
+  std::unordered_map<std::string, int, hash<std::string>, std::equal_to<>> m {{"one", 1}, {"two", 2}};
+  assert(m.find(std::string_view {"two"})->second == 2);
+  assert(hash<std::string>{}(std::string {"two"}) == hash<std::string_view>{}("two"));
+
+  // The scalar and the AVX2 bulk paths compute the same hash
+  std::mt19937_64 random {42};
+  std::vector<unsigned char> data(5000);
+  for (unsigned char& byte : data) {
+    byte = static_cast<unsigned char>(random());
+  }
+  std::vector<uint64_t> expected;
+  cpu_dispatch::force_isa(cpu_dispatch::isa::scalar);
+  for (size_t size = detail::kBulkSize + 1; size <= data.size(); size += 97) {
+    expected.push_back(hash_bytes(data.data(), size, 7));
+  }
+  cpu_dispatch::force_isa(cpu_dispatch::supported_isa());
+  for (size_t size = detail::kBulkSize + 1, i = 0; size <= data.size(); size += 97, i++) {
+    assert(hash_bytes(data.data(), size, 7) == expected[i]);
+  }
+}
+
+// =================================================================
+// 2. Throughput in bytes per cycle
+// =================================================================
+// Cycles come from the hardware counters when they are available, otherwise from the time stamp counter, which ticks
+// at the nominal frequency of the CPU rather than the actual one. Other architectures fall back to nanoseconds.
+inline uint64_t time_stamp() {
+#if defined(CPU_DISPATCH_X86)
+  return __rdtsc();
+#else
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+template <typename Fn>
+double best_cycles(Fn&& fn) {
+  PerfCounters counters;
+  double best {1e18};
+  for (int round = 0; round < 5; round++) {
+    counters.start();
+    uint64_t start = time_stamp();
+    fn();
+    uint64_t ticks = time_stamp() - start;
+    PerfCounters::Sample sample = counters.stop();
+    best = std::min(best, double(counters.available() ? sample.cycles : ticks));
+  }
+  return best;
+}
+
+void benchmark_hash(size_t total_bytes = size_t{1} << 28) {
+  std::cout << "cycles from " << (PerfCounters().available() ? "perf counters" : "rdtsc") << std::endl;
+  std::vector<char> buffer(size_t{1} << 20);
+  std::mt19937_64 random {1};
+  for (char& c : buffer) {
+    c = char(random());
+  }
+
+  volatile size_t sink {0};
+  for (size_t size : {8, 16, 32, 64, 128, 256, 1024, 4096, 65536}) {
+    size_t count = total_bytes / size;
+    // Consecutive keys start at different offsets, so the loads are unaligned as in a real table
+    auto run = [&](auto&& hash) {
+      return best_cycles([&] {
+        size_t offset {0};
+        size_t sum {0};
+        for (size_t i = 0; i < count; i++) {
+          sum += hash(std::string_view {buffer.data() + offset, size});
+          offset += size + 1;
+          if (offset + size > buffer.size()) {
+            offset = i % 64;
+          }
+        }
+        sink = sum;
+      });
+    };
+    double ours = run(hashing::hash<std::string_view>{});
+    double standard = run(std::hash<std::string_view>{});
+    double bytes = double(count * size);
+    std::cout << size << " bytes: hashing::hash " << bytes / ours << " bytes/cycle, std::hash " << bytes / standard
+              << " bytes/cycle" << std::endl;
+  }
+
+  // Integer keys: the mix costs a few cycles over the identity
+  size_t count = total_bytes / 8;
+  auto run_integers = [&](auto&& hash) {
+    return best_cycles([&] {
+      size_t sum {0};
+      for (uint64_t i = 0; i < count; i++) {
+        sum += hash(i);
+      }
+      sink = sum;
+    });
+  };
+  std::cout << "uint64_t: hashing::hash " << run_integers(hashing::hash<uint64_t>{}) / double(count)
+            << " cycles/key, std::hash " << run_integers(std::hash<uint64_t>{}) / double(count) << " cycles/key"
+            << std::endl;
+
+  // std::hash has no specialization for tuples, so the tuple keys of std_pair_and_tuple.cc need a functor anyway
+  using Triple = std::tuple<int, int, int>;
+  auto start = std::chrono::steady_clock::now();
+  std::unordered_set<Triple, hashing::hash<Triple>> grid;
+  for (int x = 0; x < 100; x++) {
+    for (int y = 0; y < 100; y++) {
+      for (int z = 0; z < 100; z++) {
+        grid.emplace(x, y, z);
+      }
+    }
+  }
+  std::cout << "unordered_set<tuple<int, int, int>>: "
+            << std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                   double(grid.size())
+            << " ns/insert" << std::endl;
+}
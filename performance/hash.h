@@ -0,0 +1,321 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "cpu_dispatch.h"
+
+/**
+ * 1. What std::hash gives us
+ * 2. Building blocks: 64-bit mixing and the folded multiply
+ * 3. A string hash: short keys, medium keys and a SIMD bulk path
+ * 4. Combining hashes of pairs and tuples
+ * 5. The hash functors
+ */
+
+// =================================================================
+// 1. What std::hash gives us
+// =================================================================
+// std::hash<int> in libstdc++ and libc++ is the identity: keys with a common stride (multiples of 1024, pointers to
+// 64-byte objects, ...) all land in the same few buckets of a power-of-two sized table. std::hash<std::string> is
+// murmur2-style, byte-oriented with a long dependency chain, so it gets slow for long keys.
+// The functors here are non-cryptographic: they are fast and well distributed, but a hash of a key chosen by an
+// attacker can be predicted, so don't use them where untrusted input decides the keys (hash flooding).
+
+namespace hashing {
+
+namespace detail {
+
+// =================================================================
+// 2. Building blocks: 64-bit mixing and the folded multiply
+// =================================================================
+// The finalizer of splitmix64: a bijection in which every input bit affects every output bit with probability ~1/2
+constexpr uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBull;
+  x ^= x >> 31;
+  return x;
+}
+
+// 64 x 64 -> 128-bit multiply, folded back to 64 bits: one mul instruction mixes all bits of both inputs
+inline uint64_t mum(uint64_t a, uint64_t b) {
+  __uint128_t product = __uint128_t(a) * b;
+  return uint64_t(product) ^ uint64_t(product >> 64);
+}
+
+constexpr uint64_t kPrime0 {0xA0761D6478BD642Full};
+constexpr uint64_t kPrime1 {0xE7037ED1A0B428DBull};
+constexpr uint64_t kPrime2 {0x8EBC6AF09C88C6E3ull};
+constexpr uint32_t kPrime32 {0x9E3779B1u};
+
+// Keys are read as little-endian words on every machine, so a hash doesn't depend on the byte order
+inline uint64_t read64(const unsigned char* p) {
+  uint64_t value;
+  std::memcpy(&value, p, 8);
+  if constexpr (std::endian::native == std::endian::big) {
+    value = __builtin_bswap64(value);
+  }
+  return value;
+}
+
+inline uint64_t read32(const unsigned char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, 4);
+  if constexpr (std::endian::native == std::endian::big) {
+    value = __builtin_bswap32(value);
+  }
+  return value;
+}
+
+// =================================================================
+// 3. A string hash: short keys, medium keys and a SIMD bulk path
+// =================================================================
+// Keys up to 16 bytes (most map keys) are read with at most four overlapping loads and no loop, keys up to kBulkSize
+// bytes with a loop of 16-byte steps, both like wyhash. Longer keys are processed in 64-byte stripes like xxh3: the
+// stripe is spread over 8 independent 64-bit accumulators, which has no dependency between the lanes, so it maps
+// directly onto SIMD registers.
+constexpr size_t kStripeSize {64};
+constexpr size_t kStripesPerBlock {16};
+constexpr size_t kBulkSize {256};
+
+// Stripe s of a block is keyed with secret words [s, s + 8), the scramble at the end of a block with [16, 24)
+constexpr std::array<uint64_t, 24> kSecret = [] {
+  std::array<uint64_t, 24> secret {};
+  uint64_t state {0x2545F4914F6CDD1Dull};
+  for (uint64_t& word : secret) {
+    state += 0x9E3779B97F4A7C15ull;
+    word = mix64(state);
+  }
+  return secret;
+}();
+constexpr size_t kLastStripeSecret {kStripesPerBlock - 1};
+
+// One stripe: each lane adds the product of the low and high halves of (data ^ secret), and the data itself to the
+// neighbouring lane, so no input bit can be cancelled out by the multiply alone.
+inline void accumulate_stripe(uint64_t* acc, const unsigned char* p, const uint64_t* secret) {
+  for (size_t i = 0; i < 8; i++) {
+    uint64_t data = read64(p + 8 * i);
+    uint64_t key = data ^ secret[i];
+    acc[i ^ 1] += data;
+    acc[i] += (key & 0xFFFFFFFFu) * (key >> 32);
+  }
+}
+
+inline void scramble(uint64_t* acc, const uint64_t* secret) {
+  for (size_t i = 0; i < 8; i++) {
+    acc[i] = (acc[i] ^ (acc[i] >> 47) ^ secret[i]) * kPrime32;
+  }
+}
+
+// Every full stripe except the last one, then the last 64 bytes of the key, which may overlap the previous stripe.
+// size > kBulkSize, so there is always at least one full stripe.
+inline void accumulate_scalar(uint64_t* acc, const unsigned char* p, size_t size) {
+  const size_t stripes = (size - 1) / kStripeSize;
+  for (size_t s = 0; s < stripes; s++) {
+    accumulate_stripe(acc, p + s * kStripeSize, kSecret.data() + s % kStripesPerBlock);
+    if (s % kStripesPerBlock == kStripesPerBlock - 1) {
+      scramble(acc, kSecret.data() + kStripesPerBlock);
+    }
+  }
+  accumulate_stripe(acc, p + size - kStripeSize, kSecret.data() + kLastStripeSecret);
+}
+
+#if defined(CPU_DISPATCH_X86)
+// The same computation, 4 lanes per register: _mm256_mul_epu32 multiplies the low 32 bits of each 64-bit lane,
+// which is exactly (key & 0xFFFFFFFF) * (key >> 32) once the high half is shifted down.
+__attribute__((target("avx2")))
+inline void accumulate_stripe_avx2(__m256i* acc, const unsigned char* p, const uint64_t* secret) {
+  for (size_t i = 0; i < 2; i++) {
+    __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p) + i);
+    __m256i key = _mm256_xor_si256(data, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+    __m256i product = _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32));
+    __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    acc[i] = _mm256_add_epi64(acc[i], _mm256_add_epi64(product, swapped));
+  }
+}
+
+// AVX2 has no 64-bit multiply, acc * prime is built from two 32 x 32 -> 64-bit multiplies
+__attribute__((target("avx2")))
+inline void scramble_avx2(__m256i* acc, const uint64_t* secret) {
+  const __m256i prime = _mm256_set1_epi32(int(kPrime32));
+  for (size_t i = 0; i < 2; i++) {
+    __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i);
+    __m256i x = _mm256_xor_si256(_mm256_xor_si256(acc[i], _mm256_srli_epi64(acc[i], 47)), key);
+    __m256i low = _mm256_mul_epu32(x, prime);
+    __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+    acc[i] = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+  }
+}
+
+__attribute__((target("avx2")))
+inline void accumulate_avx2(uint64_t* acc_words, const unsigned char* p, size_t size) {
+  __m256i acc[2] {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc_words)),
+                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc_words) + 1)};
+  const size_t stripes = (size - 1) / kStripeSize;
+  size_t s = 0;
+  // Full blocks, with the stripe loop unrolled by the compiler since its trip count is a constant
+  for (; s + kStripesPerBlock <= stripes; s += kStripesPerBlock) {
+    for (size_t k = 0; k < kStripesPerBlock; k++) {
+      accumulate_stripe_avx2(acc, p + (s + k) * kStripeSize, kSecret.data() + k);
+    }
+    scramble_avx2(acc, kSecret.data() + kStripesPerBlock);
+  }
+  for (; s < stripes; s++) {
+    accumulate_stripe_avx2(acc, p + s * kStripeSize, kSecret.data() + s % kStripesPerBlock);
+  }
+  accumulate_stripe_avx2(acc, p + size - kStripeSize, kSecret.data() + kLastStripeSecret);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc_words), acc[0]);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc_words) + 1, acc[1]);
+}
+#else
+constexpr void (*accumulate_avx2)(uint64_t*, const unsigned char*, size_t) = nullptr;
+#endif
+
+// Picked once at startup (see cpu_dispatch.h), the result is the same on every target
+inline cpu_dispatch::kernel<void(uint64_t*, const unsigned char*, size_t)> accumulate {
+  accumulate_scalar, accumulate_avx2, nullptr
+};
+
+// Kept out of line, so that hash_bytes stays small enough to be inlined for short keys
+[[gnu::noinline]] inline uint64_t hash_bulk(const unsigned char* p, size_t size, uint64_t seed) {
+  uint64_t acc[8];
+  for (size_t i = 0; i < 8; i++) {
+    acc[i] = kSecret[i] + seed;
+  }
+  accumulate(acc, p, size);
+  uint64_t result = size * kPrime0 ^ seed;
+  for (size_t i = 0; i < 8; i += 2) {
+    result += mum(acc[i] ^ kSecret[8 + i], acc[i + 1] ^ kSecret[9 + i]);
+  }
+  return mix64(result);
+}
+
+} // namespace detail
+
+inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0) {
+  using namespace detail;
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  if (size > kBulkSize) {
+    return hash_bulk(p, size, seed);
+  }
+  seed ^= mum(seed ^ kPrime0, kPrime1);
+  uint64_t a;
+  uint64_t b;
+  if (size <= 16) {
+    if (size >= 4) {
+      // Two overlapping 4-byte loads from each end cover every length from 4 to 16
+      size_t middle = (size >> 3) << 2;
+      a = (read32(p) << 32) | read32(p + middle);
+      b = (read32(p + size - 4) << 32) | read32(p + size - 4 - middle);
+    } else if (size > 0) {
+      a = (uint64_t(p[0]) << 16) | (uint64_t(p[size >> 1]) << 8) | p[size - 1];
+      b = 0;
+    } else {
+      a = 0;
+      b = 0;
+    }
+  } else {
+    size_t i = size;
+    const unsigned char* q = p;
+    for (; i > 16; i -= 16, q += 16) {
+      seed = mum(read64(q) ^ kPrime1, read64(q + 8) ^ seed);
+    }
+    a = read64(p + size - 16);
+    b = read64(p + size - 8);
+  }
+  a ^= kPrime1;
+  b ^= seed;
+  __uint128_t product = __uint128_t(a) * b;
+  return mum(uint64_t(product) ^ kPrime0 ^ size, uint64_t(product >> 64) ^ kPrime2);
+}
+
+// =================================================================
+// 4. Combining hashes of pairs and tuples
+// =================================================================
+// `seed ^ value` or `seed * 31 + value` (as in boost::hash_combine or Java) are weak: (a, b) and (b, a) or small
+// differences in both elements collide. A folded multiply of the running state and the next element's hash isn't
+// symmetric and mixes every bit.
+inline uint64_t hash_combine(uint64_t seed, uint64_t value) {
+  return detail::mum(seed ^ detail::kPrime0, value ^ detail::kPrime1);
+}
+
+// =================================================================
+// 5. The hash functors
+// =================================================================
+// Drop-in replacements for std::hash, e.g. std::unordered_map<int, std::string, hashing::hash<int>>.
+template <typename T>
+struct hash;
+
+// Integers, enums and pointers: one mix, a few cycles, and strided keys spread over all buckets
+template <typename T>
+requires (std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>)
+struct hash<T> {
+  size_t operator()(T value) const noexcept {
+    if constexpr (std::is_pointer_v<T>) {
+      return size_t(detail::mix64(reinterpret_cast<uintptr_t>(value)));
+    } else {
+      return size_t(detail::mix64(uint64_t(value)));
+    }
+  }
+};
+
+// 0.0 and -0.0 compare equal, so they must hash equal. NaN never compares equal, any hash will do.
+template <typename T>
+requires std::is_floating_point_v<T>
+struct hash<T> {
+  size_t operator()(T value) const noexcept {
+    if (value == T(0)) {
+      value = T(0);
+    }
+    if constexpr (sizeof(T) == 4) {
+      return size_t(detail::mix64(std::bit_cast<uint32_t>(value)));
+    } else if constexpr (sizeof(T) == 8) {
+      return size_t(detail::mix64(std::bit_cast<uint64_t>(value)));
+    } else {
+      return size_t(hash_bytes(&value, sizeof(T)));
+    }
+  }
+};
+
+// Strings are transparent (is_transparent), so an unordered_map<std::string, V, hashing::hash<std::string>,
+// std::equal_to<>> can be searched with a std::string_view or a string literal without building a std::string.
+template <>
+struct hash<std::string_view> {
+  using is_transparent = void;
+  size_t operator()(std::string_view s) const noexcept {
+    return size_t(hash_bytes(s.data(), s.size()));
+  }
+};
+
+template <>
+struct hash<std::string> : hash<std::string_view> {};
+
+template <typename A, typename B>
+struct hash<std::pair<A, B>> {
+  size_t operator()(const std::pair<A, B>& p) const noexcept {
+    return size_t(hash_combine(hash<std::remove_cv_t<A>>{}(p.first), hash<std::remove_cv_t<B>>{}(p.second)));
+  }
+};
+
+template <typename... Ts>
+struct hash<std::tuple<Ts...>> {
+  size_t operator()(const std::tuple<Ts...>& t) const noexcept {
+    uint64_t seed {sizeof...(Ts)};
+    std::apply([&](const auto&... elements) {
+      ((seed = hash_combine(seed, hash<std::remove_cvref_t<decltype(elements)>>{}(elements))), ...);
+    }, t);
+    return size_t(seed);
+  }
+};
+
+} // namespace hashing
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lookup_table.h"
+
+/**
+ * 1. The tables are correct, and computed by the compiler
+ * 2. Against tables filled at runtime, including the startup cost
+ */
+
+// =================================================================
+// 1. The tables are correct, and computed by the compiler
+// =================================================================
+// Each static_assert is evaluated by the compiler, so it only compiles if the tables are constant expressions
+static_assert(tables::kCrc32Table[1] == 0x77073096u && tables::kCrc32Table[255] == 0x2D02EF8Du);
+static_assert(tables::crc32("123456789") == 0xCBF43926u); // the standard check value of CRC-32
+static_assert(tables::popcount(0xFFFF'0000'0F0F'0001ull) == 25);
+static_assert(tables::kSineTable[0] == 0.0 && tables::kSineTable[tables::kSineSteps / 4] > 1.0 - 1e-15);
+static_assert(tables::count_code_points("h\xC3\xA9llo \xE2\x82\xAC \xF0\x9F\x98\x80") == 9);
+
+// constinit is checked as well: a table used to initialize another static object is ready before any code runs
+constinit const uint32_t kEmptyCrc = tables::crc32("");
+
+void test_lookup_table() {
+  assert(kEmptyCrc == 0);
+
+  // make_table with any generator, also at runtime
+  constexpr auto squares = tables::make_table<10>([](size_t i) { return int(i * i); });
+  static_assert(squares[9] == 81 && squares.size() == 10);
+  size_t offset = squares.size();
+  auto runtime = tables::make_table<4>([offset](size_t i) { return i + offset; });
+  assert(runtime[3] == 13);
+
+  // CRC-32: the table and the bitwise loop agree, and a checksum can be continued over several pieces
+  std::mt19937_64 random {1};
+  std::string data(10'000, '\0');
+  for (char& c : data) {
+    c = char(random());
+  }
+  for (size_t size : {0, 1, 7, 100, 10'000}) {
+    std::string_view piece {data.data(), size};
+    assert(tables::crc32(piece) == tables::crc32_bitwise(piece));
+  }
+  std::string_view all {data};
+  assert(tables::crc32(all.substr(1234), tables::crc32(all.substr(0, 1234))) == tables::crc32(all));
+
+  for (int i = 0; i < 10'000; i++) {
+    uint64_t x = random();
+    assert(tables::popcount(x) == std::popcount(x));
+  }
+
+  // Every entry of the sine table against the C library, and the interpolated functions
+  for (size_t i = 0; i <= tables::kSineSteps; i++) {
+    double angle = 2.0 * M_PI * double(i) / double(tables::kSineSteps);
+    assert(std::abs(tables::kSineTable[i] - std::sin(angle)) < 1e-15);
+  }
+  for (double turns = -3.0; turns < 3.0; turns += 0.001) {
+    assert(std::abs(tables::table_sin(turns) - std::sin(2.0 * M_PI * turns)) < 3e-7);
+    assert(std::abs(tables::table_cos(turns) - std::cos(2.0 * M_PI * turns)) < 3e-7);
+  }
+  assert(std::abs(tables::table_sin(-1e-20)) < 1e-15);
+
+  // UTF-8: valid text of every sequence length, and the ways it can be broken
+  assert(tables::count_code_points("") == 0);
+  assert(tables::count_code_points("ascii") == 5);
+  assert(tables::count_code_points("\xF4\x8F\xBF\xBF") == 1);         // U+10FFFF, the last code point
+  assert(tables::count_code_points("\xC3") == -1);                    // truncated
+  assert(tables::count_code_points("\x80" "a") == -1);                // stray continuation byte
+  assert(tables::count_code_points("\xC0\xAF") == -1);                // overlong '/'
+  assert(tables::count_code_points("\xE0\x80\xAF") == -1);            // overlong with 3 bytes
+  assert(tables::count_code_points("\xED\xA0\x80") == -1);            // surrogate U+D800
+  assert(tables::count_code_points("\xF4\x90\x80\x80") == -1);        // beyond U+10FFFF
+  assert(tables::count_code_points("\xE2\x82" "a") == -1);            // continuation missing
+  for (size_t byte = 0; byte < 256; byte++) {
+    assert(tables::kUtf8ClassTable[byte] == tables::utf8_class_of(byte));
+  }
+}
+
+// =================================================================
+// 2. Against tables filled at runtime, including the startup cost
+// =================================================================
+// The usual runtime alternatives: a global array filled by an init function called from main(), and a table built on
+// first use behind a magic static. The polynomial is read from a volatile so that the optimizer can't turn the
+// runtime versions back into constants.
+volatile uint32_t runtime_polynomial {tables::kCrc32Polynomial};
+
+std::array<uint32_t, 256> build_crc32_table() {
+  const uint32_t polynomial = runtime_polynomial;
+  std::array<uint32_t, 256> table {};
+  for (uint32_t byte = 0; byte < 256; byte++) {
+    uint32_t crc = byte;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (crc & 1 ? polynomial : 0);
+    }
+    table[byte] = crc;
+  }
+  return table;
+}
+
+std::array<double, tables::kSineSteps + 1> build_sine_table() {
+  std::array<double, tables::kSineSteps + 1> table {};
+  for (size_t i = 0; i <= tables::kSineSteps; i++) {
+    table[i] = std::sin(2.0 * M_PI * double(i) / double(tables::kSineSteps));
+  }
+  return table;
+}
+
+std::array<uint32_t, 256> g_crc32_table;
+
+const std::array<uint32_t, 256>& crc32_table_on_first_use() {
+  static const std::array<uint32_t, 256> table = build_crc32_table();
+  return table;
+}
+
+template <typename Table>
+[[gnu::noinline]] uint32_t crc32_with(const Table& table, std::string_view data) {
+  uint32_t crc = ~0u;
+  for (char c : data) {
+    crc = table[(crc ^ uint8_t(c)) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+template <typename Fn>
+double best_ns(Fn&& fn) {
+  double best {1e18};
+  for (int round = 0; round < 5; round++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+void benchmark_lookup_table(size_t bytes = size_t {1} << 26) {
+  // Startup: what every run of the program pays before main() for the runtime tables, and 0 for the constexpr ones.
+  // The first build also includes the page faults of a fresh table, which is what a real startup sees.
+  auto first = std::chrono::steady_clock::now();
+  g_crc32_table = build_crc32_table();
+  auto sine = build_sine_table();
+  double cold = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - first).count();
+  volatile double sink {sine[1]};
+  double crc_build = best_ns([&] { g_crc32_table = build_crc32_table(); });
+  double sine_build = best_ns([&] { sink = build_sine_table()[7]; });
+  std::cout << "startup (ns): CRC-32 table " << crc_build << ", sine table " << sine_build << ", both cold " << cold
+            << ", constexpr tables 0" << std::endl;
+
+  std::mt19937_64 random {1};
+  std::string data(bytes, '\0');
+  for (char& c : data) {
+    c = char(random());
+  }
+  volatile uint32_t crc_sink {0};
+  double constexpr_table = best_ns([&] { crc_sink = crc32_with(tables::kCrc32Table, data); });
+  double global_table = best_ns([&] { crc_sink = crc32_with(g_crc32_table, data); });
+  double magic_static = best_ns([&] {
+    // The guard of the magic static is checked once per call, as a function that uses it would do
+    uint32_t crc = ~0u;
+    for (size_t i = 0; i < data.size(); i += 4096) {
+      const auto& table = crc32_table_on_first_use();
+      for (size_t k = i; k < std::min(i + 4096, data.size()); k++) {
+        crc = table[(crc ^ uint8_t(data[k])) & 0xFF] ^ (crc >> 8);
+      }
+    }
+    crc_sink = ~crc;
+  });
+  double bitwise = best_ns([&] { crc_sink = tables::crc32_bitwise(data); });
+  double gb = double(bytes);
+  std::cout << "CRC-32 (GB/s): constexpr table " << gb / constexpr_table << ", runtime table " << gb / global_table
+            << ", magic static " << gb / magic_static << ", bitwise " << gb / bitwise << std::endl;
+
+  std::vector<uint64_t> words(bytes / 8);
+  for (uint64_t& w : words) {
+    w = random();
+  }
+  volatile int popcount_sink {0};
+  double table_popcount = best_ns([&] {
+    int sum {0};
+    for (uint64_t w : words) {
+      sum += tables::popcount(w);
+    }
+    popcount_sink = sum;
+  });
+  double std_popcount = best_ns([&] {
+    int sum {0};
+    for (uint64_t w : words) {
+      sum += std::popcount(w);
+    }
+    popcount_sink = sum;
+  });
+  std::cout << "popcount (ns/word): table " << table_popcount / double(words.size()) << ", std::popcount "
+            << std_popcount / double(words.size()) << std::endl;
+
+  const size_t angles = 1 << 22;
+  double table_time = best_ns([&] {
+    double sum {0.0};
+    for (size_t i = 0; i < angles; i++) {
+      sum += tables::table_sin(double(i) * 1e-5);
+    }
+    sink = sum;
+  });
+  double libm_time = best_ns([&] {
+    double sum {0.0};
+    for (size_t i = 0; i < angles; i++) {
+      sum += std::sin(2.0 * M_PI * double(i) * 1e-5);
+    }
+    sink = sum;
+  });
+  std::cout << "sine (ns/call): table " << table_time / double(angles) << ", std::sin " << libm_time / double(angles)
+            << std::endl;
+
+  // Mostly ASCII with some 2 and 3 byte sequences, like text in European languages
+  std::string text;
+  while (text.size() < bytes / 4) {
+    text += "Stra\xC3\x9F" "e, caf\xC3\xA9, 10 \xE2\x82\xAC; ";
+  }
+  volatile int64_t count_sink {0};
+  double utf8 = best_ns([&] { count_sink = tables::count_code_points(text); });
+  std::cout << "UTF-8 code points (GB/s): " << double(text.size()) / utf8 << std::endl;
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * 1. Tables computed by the compiler
+ * 2. make_table
+ * 3. CRC-32
+ * 4. Popcount
+ * 5. Sine and cosine
+ * 6. UTF-8 byte classes
+ */
+
+// =================================================================
+// 1. Tables computed by the compiler
+// =================================================================
+// A lookup table that is filled at runtime (in main(), in a constructor of a global object, or on first use behind a
+// "magic static") costs startup time, a guard check on every access for the magic static, and a page of writable
+// memory that every process maps privately. A constexpr table has none of these costs: the compiler evaluates the
+// generator, like it evaluates add4<N> in function_template.cc or `constexpr Point p` in basic.cpp, and the linker
+// places the result in .rodata, which is shared between all processes that run the binary and paged in on demand.
+// A constexpr variable is also constinit (see basic.cpp), so using it from other static initializers is safe.
+
+namespace tables {
+
+// =================================================================
+// 2. make_table
+// =================================================================
+// make_table<N>(fn) returns {fn(0), fn(1), ..., fn(N - 1)}. Assigned to a constexpr variable, the whole table is
+// computed at compile time, and a generator that isn't a constant expression (it calls std::sin, allocates, ...) is a
+// compile error there. The same call still works at runtime, which the benchmark uses for the comparison.
+template <typename Fn>
+concept TableGenerator = std::invocable<const Fn&, size_t> &&
+                         std::default_initializable<std::invoke_result_t<const Fn&, size_t>>;
+
+template <size_t N, TableGenerator Fn>
+constexpr auto make_table(const Fn& fn) {
+  std::array<std::invoke_result_t<const Fn&, size_t>, N> table {};
+  for (size_t i = 0; i < N; i++) {
+    table[i] = fn(i);
+  }
+  return table;
+}
+
+// =================================================================
+// 3. CRC-32
+// =================================================================
+// CRC-32 as in zlib, gzip and PNG (reflected polynomial 0xEDB88320). The bitwise version shifts 8 times per byte, the
+// table version does it once with the remainder of the whole byte precomputed.
+constexpr uint32_t kCrc32Polynomial {0xEDB88320u};
+
+constexpr uint32_t crc32_entry(size_t byte) {
+  uint32_t crc = uint32_t(byte);
+  for (int bit = 0; bit < 8; bit++) {
+    crc = (crc >> 1) ^ (crc & 1 ? kCrc32Polynomial : 0);
+  }
+  return crc;
+}
+
+inline constexpr auto kCrc32Table = make_table<256>(crc32_entry);
+
+// constexpr as well, so checksums of string literals can be computed by the compiler
+constexpr uint32_t crc32(std::string_view data, uint32_t crc = 0) {
+  crc = ~crc;
+  for (char c : data) {
+    crc = kCrc32Table[(crc ^ uint8_t(c)) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+constexpr uint32_t crc32_bitwise(std::string_view data, uint32_t crc = 0) {
+  crc = ~crc;
+  for (char c : data) {
+    crc = crc32_entry((crc ^ uint8_t(c)) & 0xFF) ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// =================================================================
+// 4. Popcount
+// =================================================================
+// The number of set bits of every byte, the classic table for targets without a popcount instruction. On x86-64,
+// std::popcount is one instruction with -mpopcnt and a dozen shifts and masks without it, both faster than 8 lookups,
+// so prefer it there: a table pays off when one lookup replaces many instructions, as for CRC-32 above.
+inline constexpr auto kPopcountTable = make_table<256>([](size_t byte) {
+  uint8_t count {0};
+  for (; byte != 0; byte &= byte - 1) {
+    count++;
+  }
+  return count;
+});
+
+constexpr int popcount(uint64_t x) {
+  int count {0};
+  for (int byte = 0; byte < 8; byte++, x >>= 8) {
+    count += kPopcountTable[x & 0xFF];
+  }
+  return count;
+}
+
+// =================================================================
+// 5. Sine and cosine
+// =================================================================
+// std::sin isn't constexpr before C++26, so the table uses its own Taylor series. The argument is reduced to
+// [-pi/2, pi/2], where the terms shrink fast enough for double precision within 1 ulp or 2.
+namespace detail {
+
+constexpr double taylor_sin(double x) {
+  constexpr double pi = std::numbers::pi;
+  if (x > pi / 2) {
+    x = pi - x;
+  } else if (x < -pi / 2) {
+    x = -pi - x;
+  }
+  // x - x^3/3! + x^5/5! - ... = x (1 - x^2/(2*3) (1 - x^2/(4*5) (1 - ...))), evaluated from the innermost, smallest
+  // term outwards, which rounds less than adding the terms in order
+  double sum = 1.0;
+  for (int k = 14; k >= 1; k--) {
+    sum = 1.0 - x * x / double(2 * k * (2 * k + 1)) * sum;
+  }
+  return x * sum;
+}
+
+} // namespace detail
+
+// One period in kSineSteps steps, with one more entry so that interpolation never wraps around
+constexpr size_t kSineSteps {4096};
+
+inline constexpr auto kSineTable = make_table<kSineSteps + 1>([](size_t i) {
+  constexpr double pi = std::numbers::pi;
+  // Angles in [0, 2 pi) are shifted to (-pi, pi], where the reduction above is exact enough
+  double angle = 2.0 * pi * double(i) / double(kSineSteps);
+  return detail::taylor_sin(angle > pi ? angle - 2.0 * pi : angle);
+});
+
+// sin(2 pi * turns), for any turns, with linear interpolation between table entries: the error is below 3e-7, good
+// enough for oscillators, rotations in games and window functions, not for numerics.
+inline double table_sin(double turns) {
+  // turns - floor(turns) is in [0, 1], 1 when a tiny negative turns rounds up
+  double position = (turns - std::floor(turns)) * double(kSineSteps);
+  size_t index = std::min(size_t(position), kSineSteps - 1);
+  double fraction = position - double(index);
+  return kSineTable[index] + fraction * (kSineTable[index + 1] - kSineTable[index]);
+}
+
+// cos(x) = sin(x + a quarter turn)
+inline double table_cos(double turns) {
+  return table_sin(turns + 0.25);
+}
+
+// =================================================================
+// 6. UTF-8 byte classes
+// =================================================================
+// What a byte can be in UTF-8: ASCII, a continuation byte, the first byte of a 2, 3 or 4 byte sequence, or a byte
+// that never appears in valid UTF-8 (0xC0, 0xC1 would encode ASCII with two bytes, 0xF5-0xFF are beyond U+10FFFF).
+enum class utf8_class : uint8_t {
+  ascii,
+  continuation,
+  lead2,
+  lead3,
+  lead4,
+  invalid,
+};
+
+constexpr utf8_class utf8_class_of(size_t byte) {
+  if (byte < 0x80) {
+    return utf8_class::ascii;
+  } else if (byte < 0xC0) {
+    return utf8_class::continuation;
+  } else if (byte < 0xC2) {
+    return utf8_class::invalid;
+  } else if (byte < 0xE0) {
+    return utf8_class::lead2;
+  } else if (byte < 0xF0) {
+    return utf8_class::lead3;
+  } else if (byte < 0xF5) {
+    return utf8_class::lead4;
+  }
+  return utf8_class::invalid;
+}
+
+inline constexpr auto kUtf8ClassTable = make_table<256>(utf8_class_of);
+
+// The number of code points, or -1 if the text isn't well-formed UTF-8 (a truncated or overlong sequence, a stray
+// continuation byte, an invalid byte). Surrogates and overlong 3/4-byte forms need the second byte as well, which the
+// class of the lead byte alone can't decide.
+constexpr int64_t count_code_points(std::string_view text) {
+  int64_t count {0};
+  for (size_t i = 0; i < text.size(); count++) {
+    const uint8_t lead = uint8_t(text[i]);
+    size_t length {0};
+    switch (kUtf8ClassTable[lead]) {
+      case utf8_class::ascii:
+        i++;
+        continue;
+      case utf8_class::lead2:
+        length = 2;
+        break;
+      case utf8_class::lead3:
+        length = 3;
+        break;
+      case utf8_class::lead4:
+        length = 4;
+        break;
+      default:
+        return -1;
+    }
+    if (text.size() - i < length) {
+      return -1;
+    }
+    for (size_t k = 1; k < length; k++) {
+      if (kUtf8ClassTable[uint8_t(text[i + k])] != utf8_class::continuation) {
+        return -1;
+      }
+    }
+    const uint8_t second = uint8_t(text[i + 1]);
+    if ((lead == 0xE0 && second < 0xA0) || (lead == 0xED && second >= 0xA0) || (lead == 0xF0 && second < 0x90) ||
+        (lead == 0xF4 && second >= 0x90)) {
+      return -1;
+    }
+    i += length;
+  }
+  return count;
+}
+
+} // namespace tables
@@ -0,0 +1,118 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../language_itself/class_template.h"
+#include "mapped_array.h"
+
+/**
+ * 1. Open-or-create, grow, flush and share a MappedArray
+ * 2. Cold and warm start: deserializing into Array<T> vs mapping the file
+ */
+
+struct Sample {
+  int64_t id;
+  double value;
+};
+
+// =================================================================
+// 1. Open-or-create, grow, flush and share a MappedArray
+// =================================================================
+void test_mapped_array() {
+  const std::string path {"/tmp/mapped_array_test.bin"};
+  ::unlink(path.c_str());
+  {
+    auto arr = MappedArray<Sample>::open_or_create(path, 100);
+    assert(arr.size() == 100);
+    assert(arr[99].id == 0); // new elements are zero-initialized by ftruncate
+    for (size_t i = 0; i < arr.size(); i++) {
+      arr[i] = {int64_t(i), i * 0.5};
+    }
+
+    // A read-only mapping of the same file sees the writes without any flush
+    auto reader = MappedArray<Sample>::open_read_only(path);
+    assert(reader.size() == 100);
+    assert(reader[42].id == 42);
+
+    arr.resize(1'000'000);
+    assert(arr.size() == 1'000'000);
+    assert(arr[42].value == 21.0); // existing data survives the remap
+    arr[999'999] = {-1, -1.0};
+    arr.flush();
+  }
+  // Reopening keeps the length of the existing file, the initial length only applies to new files
+  auto arr = MappedArray<Sample>::open_or_create(path, 10);
+  assert(arr.size() == 1'000'000);
+  assert(arr[999'999].id == -1);
+  arr.resize(10);
+  assert(arr.size() == 10);
+  // A length whose size in bytes doesn't fit into off_t is rejected before the file is touched
+  try {
+    arr.resize(SIZE_MAX / 2);
+    assert(false);
+  } catch (const std::length_error&) {
+  }
+  assert(arr.size() == 10 && arr[9].id == 9);
+  ::unlink(path.c_str());
+}
+
+// =================================================================
+// 2. Cold and warm start: deserializing into Array<T> vs mapping the file
+// =================================================================
+// "Cold" means the file is not in the page cache. We evict it with posix_fadvise(POSIX_FADV_DONTNEED), which works
+// without root for clean pages, instead of dropping the caches of the whole machine.
+// Startup is measured as "open the dataset and read the first element", which is what a restarting service has to do
+// before it can serve. With the mapping, the rest of the data is paged in lazily as it is touched.
+void evict_from_page_cache(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  ::fdatasync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+void benchmark_mapped_array(const std::string& path = "/tmp/mapped_array_bench.bin",
+                            size_t bytes = size_t{2} << 30) {
+  const size_t length = bytes / sizeof(double);
+  {
+    auto arr = MappedArray<double>::open_or_create(path, length);
+    for (size_t i = 0; i < length; i++) {
+      arr[i] = double(i);
+    }
+    arr.flush();
+  }
+
+  auto deserialize = [&] {
+    std::ifstream in(path, std::ios::binary);
+    Array<double> arr(length);
+    in.read(reinterpret_cast<char*>(&arr[0]), std::streamsize(length * sizeof(double)));
+    return arr[length - 1];
+  };
+  auto map = [&] {
+    auto arr = MappedArray<double>::open_read_only(path);
+    return arr[length - 1];
+  };
+  auto seconds = [](auto&& start_up) {
+    auto start = std::chrono::steady_clock::now();
+    volatile double last = start_up();
+    (void)last;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  evict_from_page_cache(path);
+  double cold_deserialize = seconds(deserialize);
+  double warm_deserialize = seconds(deserialize);
+  evict_from_page_cache(path);
+  double cold_map = seconds(map);
+  double warm_map = seconds(map);
+  std::cout << (bytes >> 20) << " MiB: Array<double> deserialize cold " << cold_deserialize << " s, warm "
+            << warm_deserialize << " s; MappedArray<double> cold " << cold_map << " s, warm " << warm_map << " s"
+            << std::endl;
+  ::unlink(path.c_str());
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * 1. A file-backed array for trivially copyable types
+ * 2. Growing the file and the mapping
+ * 3. Flushing and read-only sharing across processes
+ *
+ * Array<T> in class_template.h lives on the heap, so a dataset has to be read (deserialized) into it on every start,
+ * which is O(n). MappedArray<T> maps the file into the address space instead: opening is O(1), and the pages are
+ * loaded by the kernel on first access and stay in the page cache across restarts, which also makes datasets larger
+ * than RAM usable. The file contains the raw elements and nothing else, so its size is length * sizeof(T).
+ */
+
+// =================================================================
+// 1. A file-backed array for trivially copyable types
+// =================================================================
+// Only trivially copyable types can be used, since the bytes in the file are used as objects directly,
+// without running any constructor. The type should also not contain pointers, they are meaningless in another process.
+template <typename T>
+requires std::is_trivially_copyable_v<T>
+class MappedArray {
+  public:
+    enum class Mode {
+      read_only,  // PROT_READ, any number of processes can map the file at the same time
+      read_write, // PROT_READ | PROT_WRITE, writes go to the page cache and are shared with other mappings
+    };
+
+    // Opens the file, creating it if it doesn't exist. A new file is extended to `length` zero-initialized elements,
+    // an existing file keeps its length (use resize() to change it).
+    static MappedArray open_or_create(const std::string& path, size_t length) {
+      return MappedArray(path, Mode::read_write, length);
+    }
+
+    static MappedArray open_read_only(const std::string& path) {
+      return MappedArray(path, Mode::read_only, 0);
+    }
+
+    // Like Array<T>, copying is deleted, but a mapping can be moved
+    MappedArray(const MappedArray& arr) = delete;
+    MappedArray& operator=(const MappedArray& arr) = delete;
+    MappedArray(MappedArray&& other) noexcept
+        : fd_(std::exchange(other.fd_, -1)),
+          mode_(other.mode_),
+          ptr_(std::exchange(other.ptr_, nullptr)),
+          length_(std::exchange(other.length_, 0)) {}
+    MappedArray& operator=(MappedArray&& other) noexcept {
+      if (this != &other) {
+        close();
+        fd_ = std::exchange(other.fd_, -1);
+        mode_ = other.mode_;
+        ptr_ = std::exchange(other.ptr_, nullptr);
+        length_ = std::exchange(other.length_, 0);
+      }
+      return *this;
+    }
+
+    ~MappedArray() {
+      close();
+    }
+
+    // Writing through a read-only mapping is not caught here, the page is mapped without PROT_WRITE so it raises SIGSEGV
+    T& operator[](size_t index) {
+      assert(index < length_);
+      return ptr_[index];
+    }
+    const T& operator[](size_t index) const {
+      assert(index < length_);
+      return ptr_[index];
+    }
+
+    T* data() { return ptr_; }
+    const T* data() const { return ptr_; }
+    size_t size() const { return length_; }
+    Mode mode() const { return mode_; }
+
+    // =================================================================
+    // 2. Growing the file and the mapping
+    // =================================================================
+    // The file is resized with ftruncate (new elements read as zero) and the mapping follows it. On Linux mremap
+    // can extend the mapping in place or move it without copying any data, elsewhere we unmap and map again.
+    // Either way, pointers and references into the array are invalidated, like std::vector::resize.
+    // If the mapping can't follow, the file is truncated back to its old size, so that the file and the mapping still
+    // agree, and the array keeps its old contents.
+    void resize(size_t new_length) {
+      assert(mode_ == Mode::read_write);
+      if (new_length > size_t(std::numeric_limits<off_t>::max()) / sizeof(T)) {
+        throw std::length_error("MappedArray::resize: the file would be larger than off_t can describe");
+      }
+      const size_t old_length = length_;
+      if (::ftruncate(fd_, static_cast<off_t>(new_length * sizeof(T))) != 0) {
+        throw std::system_error(errno, std::generic_category(), "ftruncate");
+      }
+      try {
+        remap(new_length);
+      } catch (...) {
+        [[maybe_unused]] int restored = ::ftruncate(fd_, static_cast<off_t>(old_length * sizeof(T)));
+        throw;
+      }
+    }
+
+    // =================================================================
+    // 3. Flushing and read-only sharing across processes
+    // =================================================================
+    // Every process that maps the same file with MAP_SHARED sees the same physical pages, so a read-only mapping in
+    // another process observes the writes right away. flush() is only about durability: it blocks until the dirty pages
+    // are written back to the file, otherwise the kernel writes them back at its own pace (and at the latest on munmap).
+    void flush() {
+      if (ptr_ != nullptr && ::msync(ptr_, length_ * sizeof(T), MS_SYNC) != 0) {
+        throw std::system_error(errno, std::generic_category(), "msync");
+      }
+    }
+
+  private:
+    MappedArray(const std::string& path, Mode mode, size_t initial_length) : mode_(mode) {
+      int flags = mode == Mode::read_only ? O_RDONLY : O_RDWR | O_CREAT;
+      fd_ = ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+      if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+      }
+      struct stat st {};
+      if (::fstat(fd_, &st) != 0) {
+        int error = errno;
+        ::close(fd_);
+        throw std::system_error(error, std::generic_category(), "fstat " + path);
+      }
+      size_t length = static_cast<size_t>(st.st_size) / sizeof(T);
+      try {
+        if (length == 0 && initial_length > 0) {
+          resize(initial_length);
+        } else {
+          remap(length);
+        }
+      } catch (...) {
+        ::close(fd_);
+        throw;
+      }
+    }
+
+    void remap(size_t new_length) {
+      size_t old_bytes = length_ * sizeof(T);
+      size_t new_bytes = new_length * sizeof(T);
+      void* mapped = nullptr;
+      if (new_bytes == 0) {
+        // mmap can't map zero bytes
+        unmap();
+        return;
+      }
+      // On failure the old mapping is left as it was: mremap doesn't touch it, and the new mapping is made before the
+      // old one is unmapped
+#if defined(__linux__)
+      if (ptr_ != nullptr) {
+        mapped = ::mremap(ptr_, old_bytes, new_bytes, MREMAP_MAYMOVE);
+        if (mapped == MAP_FAILED) {
+          throw std::system_error(errno, std::generic_category(), "mremap");
+        }
+      } else
+#endif
+      {
+        int prot = mode_ == Mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+        mapped = ::mmap(nullptr, new_bytes, prot, MAP_SHARED, fd_, 0);
+        if (mapped == MAP_FAILED) {
+          throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        unmap();
+      }
+      ptr_ = static_cast<T*>(mapped);
+      length_ = new_length;
+    }
+
+    void unmap() {
+      if (ptr_ != nullptr) {
+        ::munmap(ptr_, length_ * sizeof(T));
+        ptr_ = nullptr;
+        length_ = 0;
+      }
+    }
+
+    void close() {
+      unmap();
+      if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+      }
+    }
+
+    int fd_ {-1};
+    Mode mode_ {Mode::read_only};
+    T* ptr_ {nullptr};
+    size_t length_ {0};
+};
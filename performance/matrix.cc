@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "matrix.h"
+
+/**
+ * 1. The blocked GEMM agrees with a triple loop, for every shape and target
+ * 2. GFLOP/s from 64^3 to 4096^3 against a triple loop
+ */
+
+// =================================================================
+// 1. The blocked GEMM agrees with a triple loop, for every shape and target
+// =================================================================
+// The textbook loop, C = alpha * A * B + beta * C
+void naive_gemm(size_t m, size_t n, size_t k, double alpha, const double* a, size_t lda, const double* b, size_t ldb,
+                double beta, double* c, size_t ldc) {
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      double sum {0.0};
+      for (size_t p = 0; p < k; p++) {
+        sum += a[i * lda + p] * b[p * ldb + j];
+      }
+      c[i * ldc + j] = alpha * sum + beta * c[i * ldc + j];
+    }
+  }
+}
+
+void check_gemm(size_t m, size_t n, size_t k, thread_pool& pool, gemm::blocking sizes) {
+  std::mt19937_64 random {m * 10'000 + n * 100 + k};
+  std::uniform_real_distribution<double> uniform {-1.0, 1.0};
+  // Leading dimensions larger than the matrices, as for a submatrix
+  const size_t lda = k + 3;
+  const size_t ldb = n + 1;
+  const size_t ldc = n + 2;
+  std::vector<double> a(m * lda), b(k * ldb), c(m * ldc), expected;
+  for (std::vector<double>* v : {&a, &b, &c}) {
+    for (double& x : *v) {
+      x = uniform(random);
+    }
+  }
+  expected = c;
+  naive_gemm(m, n, k, 0.5, a.data(), lda, b.data(), ldb, -2.0, expected.data(), ldc);
+  gemm::dgemm(m, n, k, 0.5, a.data(), lda, b.data(), ldb, -2.0, c.data(), ldc, pool, sizes);
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      assert(std::abs(c[i * ldc + j] - expected[i * ldc + j]) <= 1e-12 * double(k + 1));
+    }
+    // The padding between rows is never written
+    for (size_t j = n; j < ldc; j++) {
+      assert(c[i * ldc + j] == expected[i * ldc + j]);
+    }
+  }
+}
+
+void test_matrix() {
+  thread_pool pool {4};
+  // Tiny blocks, so that every loop of the blocked GEMM runs several times and every edge case is hit
+  const gemm::blocking tiny {12, 16, 24};
+  for (cpu_dispatch::isa target : {cpu_dispatch::isa::scalar, cpu_dispatch::supported_isa()}) {
+    cpu_dispatch::force_isa(target);
+    assert(gemm::microkernel.bound_isa() == std::min(target, cpu_dispatch::isa::avx2)); // no AVX-512 kernel yet
+    for (size_t m : {1, 5, 6, 7, 13, 40}) {
+      for (size_t n : {1, 7, 8, 9, 17, 50}) {
+        for (size_t k : {1, 15, 16, 33}) {
+          check_gemm(m, n, k, pool, tiny);
+          check_gemm(m, n, k, pool, gemm::default_blocking());
+        }
+      }
+    }
+    // Large enough for the parallel path, with blocks of the default size
+    check_gemm(200, 300, 150, pool, gemm::default_blocking());
+    check_gemm(130, 70, 600, pool, tiny);
+  }
+  cpu_dispatch::force_isa(cpu_dispatch::supported_isa());
+
+  // alpha = 0 and beta = 0 overwrite C without reading A, B or the old C
+  std::vector<double> c(4, std::nan(""));
+  double one {1.0};
+  gemm::dgemm(2, 2, 1, 0.0, &one, 1, &one, 2, 0.0, c.data(), 2);
+  assert(std::all_of(c.begin(), c.end(), [](double x) { return x == 0.0; }));
+
+  // Matrix with a dynamic size (Array) and a static size (StaticArray)
+  Matrix<double> a(2, 3);
+  Matrix<double> b(3, 2);
+  Matrix<double> product(2, 2);
+  for (size_t i = 0; i < 6; i++) {
+    a.data()[i] = double(i + 1);   // {{1, 2, 3}, {4, 5, 6}}
+    b.data()[i] = double(i + 7);   // {{7, 8}, {9, 10}, {11, 12}}
+  }
+  multiply(a, b, product);
+  assert(product(0, 0) == 58 && product(0, 1) == 64 && product(1, 0) == 139 && product(1, 1) == 154);
+
+  Matrix<double, 2, 3> sa;
+  Matrix<double, 3, 2> sb;
+  Matrix<double, 2, 2> sp;
+  std::copy(a.data(), a.data() + 6, sa.data());
+  std::copy(b.data(), b.data() + 6, sb.data());
+  multiply(sa, sb, sp);
+  assert(sp(1, 1) == 154 && sp.rows() == 2 && sizeof(sp) == 2 * sizeof(size_t) + 4 * sizeof(double));
+
+  Matrix<int, 2, 2> ia;
+  Matrix<int, 2, 2> ip;
+  ia(0, 0) = 1;
+  ia(0, 1) = 2;
+  ia(1, 0) = 3;
+  ia(1, 1) = 4;
+  multiply(ia, ia, ip);
+  assert(ip(0, 0) == 7 && ip(0, 1) == 10 && ip(1, 0) == 15 && ip(1, 1) == 22);
+}
+
+// =================================================================
+// 2. GFLOP/s from 64^3 to 4096^3 against a triple loop
+// =================================================================
+// The triple loop takes minutes above 1024^3, so it only runs up to naive_limit
+void benchmark_matrix(std::vector<size_t> sizes = {64, 128, 256, 512, 1024, 2048, 4096}, size_t naive_limit = 1024) {
+  gemm::blocking blocking = gemm::default_blocking();
+  std::cout << "microkernel " << cpu_dispatch::isa_name(gemm::microkernel.bound_isa()) << ", mc " << blocking.mc
+            << ", kc " << blocking.kc << ", nc " << blocking.nc << ", threads " << thread_pool::global().size()
+            << std::endl;
+  thread_pool single {1};
+  for (size_t n : sizes) {
+    Matrix<double> a(n, n);
+    Matrix<double> b(n, n);
+    Matrix<double> c(n, n);
+    std::mt19937_64 random {n};
+    std::uniform_real_distribution<double> uniform {-1.0, 1.0};
+    for (size_t i = 0; i < n * n; i++) {
+      a.data()[i] = uniform(random);
+      b.data()[i] = uniform(random);
+    }
+    const double flops = 2.0 * double(n) * double(n) * double(n);
+    // Small sizes are repeated, so that every measurement takes at least ~0.1 s
+    const int repeat = int(std::max(1.0, 2e8 / flops));
+    auto gflops = [&](auto&& fn) {
+      double best {1e18};
+      for (int round = 0; round < 3; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; r++) {
+          fn();
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      }
+      return flops * repeat / best * 1e-9;
+    };
+
+    std::cout << n << "^3 (GFLOP/s):";
+    if (n <= naive_limit) {
+      std::cout << " triple loop " << gflops([&] {
+        naive_gemm(n, n, n, 1.0, a.data(), n, b.data(), n, 0.0, c.data(), n);
+      }) << ",";
+    }
+    std::cout << " blocked, 1 thread " << gflops([&] { multiply(a, b, c, single); }) << ", blocked, pool "
+              << gflops([&] { multiply(a, b, c); }) << std::endl;
+  }
+}
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "../language_itself/class_template.h"
+#include "cpu_dispatch.h"
+#include "parallel.h"
+#include "tiled.h"
+
+/**
+ * 1. A matrix on top of Array and StaticArray
+ * 2. Why a triple loop is slow
+ * 3. The microkernel
+ * 4. Packing panels of A and B
+ * 5. The blocked, multi-threaded GEMM
+ */
+
+// =================================================================
+// 1. A matrix on top of Array and StaticArray
+// =================================================================
+// Matrix<T> has its size chosen at runtime and stores its elements in an Array<T>, Matrix<T, Rows, Columns> has a
+// compile-time size and stores them in a StaticArray<T, Rows * Columns>, without a heap allocation. Both are row-major
+// and contiguous, and like Array they can't be copied.
+inline constexpr size_t dynamic {0};
+
+template <typename T, size_t Rows = dynamic, size_t Columns = dynamic>
+class Matrix {
+  static_assert((Rows == dynamic) == (Columns == dynamic), "either both dimensions are static or none");
+  static constexpr bool is_static = Rows != dynamic;
+  using storage = std::conditional_t<is_static, StaticArray<T, Rows * Columns>, Array<T>>;
+
+  public:
+    Matrix() requires is_static : rows_(Rows), columns_(Columns) {}
+
+    // Zero-initialized, Array<T> itself leaves its elements uninitialized
+    Matrix(size_t rows, size_t columns) requires (!is_static)
+        : rows_(rows), columns_(columns), storage_(rows * columns) {
+      std::fill(data(), data() + rows * columns, T {});
+    }
+
+    size_t rows() const { return rows_; }
+    size_t columns() const { return columns_; }
+    T* data() { return storage_.data(); }
+    const T* data() const { return storage_.data(); }
+
+    T& operator()(size_t row, size_t column) {
+      assert(row < rows_ && column < columns_);
+      return data()[row * columns_ + column];
+    }
+    const T& operator()(size_t row, size_t column) const {
+      assert(row < rows_ && column < columns_);
+      return data()[row * columns_ + column];
+    }
+
+  private:
+    size_t rows_;
+    size_t columns_;
+    storage storage_;
+};
+
+// =================================================================
+// 2. Why a triple loop is slow
+// =================================================================
+// C[i][j] += A[i][p] * B[p][j] does 2 flops per 2 loads. With the inner loop over p, B is read column-wise, one cache
+// line per element. Even in the i-p-j order, every element of C is loaded and stored once per p, so the loop is limited
+// by the load/store ports at a fraction of the 16 flops/cycle that two AVX2 FMA units can do.
+// The blocked GEMM (the structure of GotoBLAS and BLIS) keeps a 6 x 8 block of C in 12 AVX2 registers for a whole
+// stretch of kc values of p, so the inner loop does 12 FMAs (96 flops) per 2 loads of B and 6 broadcasts of A. Around
+// it, the loops are blocked so that the piece of B used by the microkernel stays in L1, the piece of A in L2, and the
+// panel of B in L3, and both are copied ("packed") into the exact order the microkernel reads them.
+namespace gemm {
+
+constexpr size_t kMR {6}; // rows of the register block
+constexpr size_t kNR {8}; // columns of the register block, two AVX2 registers of doubles
+
+// kc: a kc x kNR micro-panel of B takes half of L1. mc: an mc x kc block of A takes half of L2. nc: a kc x nc panel of
+// B, a few MB, for the L3. All of them can be overridden, like the tile size in tiled.h.
+struct blocking {
+  size_t mc;
+  size_t kc;
+  size_t nc;
+};
+
+inline blocking default_blocking() {
+  const tiling::cache_sizes& cache = tiling::cache();
+  size_t kc = std::clamp<size_t>(cache.l1 / 2 / (kNR * sizeof(double)), 64, 512) / 8 * 8;
+  size_t mc = std::clamp<size_t>(cache.l2 / 2 / (kc * sizeof(double)), kMR, 1020) / kMR * kMR;
+  return {mc, kc, 4096};
+}
+
+// =================================================================
+// 3. The microkernel
+// =================================================================
+// C[0..kMR)[0..kNR) += alpha * A * B for a packed kMR x kc panel of A (column by column: kMR values per p) and a packed
+// kc x kNR panel of B (row by row: kNR values per p).
+inline void microkernel_scalar(size_t kc, const double* a, const double* b, double* c, size_t ldc, double alpha) {
+  double acc[kMR][kNR] {};
+  for (size_t p = 0; p < kc; p++, a += kMR, b += kNR) {
+    for (size_t i = 0; i < kMR; i++) {
+      for (size_t j = 0; j < kNR; j++) {
+        acc[i][j] += a[i] * b[j];
+      }
+    }
+  }
+  for (size_t i = 0; i < kMR; i++) {
+    for (size_t j = 0; j < kNR; j++) {
+      c[i * ldc + j] += alpha * acc[i][j];
+    }
+  }
+}
+
+#if defined(CPU_DISPATCH_X86)
+// 12 accumulators, 2 registers for the row of B and 1 for the broadcast of A: 15 of the 16 ymm registers. They are
+// separate variables on purpose, GCC keeps an array of __m256d in memory and stores it on every iteration.
+__attribute__((target("avx2,fma")))
+inline void microkernel_avx2(size_t kc, const double* a, const double* b, double* c, size_t ldc, double alpha) {
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+  __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+  for (size_t p = 0; p < kc; p++, a += kMR, b += kNR) {
+    const __m256d b0 = _mm256_loadu_pd(b);
+    const __m256d b1 = _mm256_loadu_pd(b + 4);
+    __m256d ai = _mm256_broadcast_sd(a);
+    c00 = _mm256_fmadd_pd(ai, b0, c00);
+    c01 = _mm256_fmadd_pd(ai, b1, c01);
+    ai = _mm256_broadcast_sd(a + 1);
+    c10 = _mm256_fmadd_pd(ai, b0, c10);
+    c11 = _mm256_fmadd_pd(ai, b1, c11);
+    ai = _mm256_broadcast_sd(a + 2);
+    c20 = _mm256_fmadd_pd(ai, b0, c20);
+    c21 = _mm256_fmadd_pd(ai, b1, c21);
+    ai = _mm256_broadcast_sd(a + 3);
+    c30 = _mm256_fmadd_pd(ai, b0, c30);
+    c31 = _mm256_fmadd_pd(ai, b1, c31);
+    ai = _mm256_broadcast_sd(a + 4);
+    c40 = _mm256_fmadd_pd(ai, b0, c40);
+    c41 = _mm256_fmadd_pd(ai, b1, c41);
+    ai = _mm256_broadcast_sd(a + 5);
+    c50 = _mm256_fmadd_pd(ai, b0, c50);
+    c51 = _mm256_fmadd_pd(ai, b1, c51);
+  }
+  const __m256d scale = _mm256_set1_pd(alpha);
+  const __m256d rows[kMR][2] {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+  for (size_t i = 0; i < kMR; i++) {
+    double* row = c + i * ldc;
+    _mm256_storeu_pd(row, _mm256_fmadd_pd(scale, rows[i][0], _mm256_loadu_pd(row)));
+    _mm256_storeu_pd(row + 4, _mm256_fmadd_pd(scale, rows[i][1], _mm256_loadu_pd(row + 4)));
+  }
+}
+#else
+constexpr void (*microkernel_avx2)(size_t, const double*, const double*, double*, size_t, double) = nullptr;
+#endif
+
+// Picked once at startup (see cpu_dispatch.h)
+inline cpu_dispatch::kernel<void(size_t, const double*, const double*, double*, size_t, double)> microkernel {
+  microkernel_scalar, microkernel_avx2, nullptr
+};
+
+// =================================================================
+// 4. Packing panels of A and B
+// =================================================================
+// Packing copies every element of A and B once per block, O(n^2) work for O(n^3) flops, and in exchange the
+// microkernel reads both with unit stride from memory that is already in the cache. Panels at the edges are padded
+// with zeros, so the microkernel always computes a full kMR x kNR block.
+inline void pack_a_panel(const double* a, size_t lda, size_t rows, size_t kc, double* packed) {
+  for (size_t p = 0; p < kc; p++) {
+    for (size_t i = 0; i < kMR; i++) {
+      *packed++ = i < rows ? a[i * lda + p] : 0.0;
+    }
+  }
+}
+
+inline void pack_b_panel(const double* b, size_t ldb, size_t columns, size_t kc, double* packed) {
+  for (size_t p = 0; p < kc; p++) {
+    const double* row = b + p * ldb;
+    for (size_t j = 0; j < kNR; j++) {
+      *packed++ = j < columns ? row[j] : 0.0;
+    }
+  }
+}
+
+// =================================================================
+// 5. The blocked, multi-threaded GEMM
+// =================================================================
+// Below this many multiply-adds, waking up the pool costs more than it saves
+constexpr size_t kParallelThreshold {size_t {1} << 21};
+
+// C = alpha * A * B + beta * C, for row-major A (m x k), B (k x n) and C (m x n) with leading dimensions lda, ldb, ldc.
+// For every kc x nc panel of B: the panel and all of A's columns in that range are packed (in parallel), then the
+// (mc rows) x (a range of kNR columns) blocks of C are distributed over the pool. Every block of C is written by one
+// thread only, so no synchronization is needed besides the end of each phase.
+inline void dgemm(size_t m, size_t n, size_t k, double alpha, const double* a, size_t lda, const double* b, size_t ldb,
+                  double beta, double* c, size_t ldc, thread_pool& pool = thread_pool::global(),
+                  blocking sizes = default_blocking()) {
+  for (size_t i = 0; i < m; i++) {
+    double* row = c + i * ldc;
+    for (size_t j = 0; j < n; j++) {
+      // beta == 0 overwrites C, even NaN, as in BLAS
+      row[j] = beta == 0.0 ? 0.0 : beta * row[j];
+    }
+  }
+  if (m == 0 || n == 0 || k == 0 || alpha == 0.0) {
+    return;
+  }
+
+  const bool parallel = pool.size() > 1 && m * n * k >= kParallelThreshold;
+  auto for_tasks = [&](size_t count, auto&& task) {
+    if (parallel) {
+      parallel_for(0, count, 1, task, pool);
+    } else {
+      for (size_t t = 0; t < count; t++) {
+        task(t);
+      }
+    }
+  };
+
+  const size_t a_panels = (m + kMR - 1) / kMR;
+  const size_t mc_panels = std::max<size_t>(1, sizes.mc / kMR);
+  const size_t m_blocks = (a_panels + mc_panels - 1) / mc_panels;
+  std::vector<double> packed_a(a_panels * kMR * sizes.kc);
+  std::vector<double> packed_b(((std::min(n, sizes.nc) + kNR - 1) / kNR) * kNR * sizes.kc);
+
+  for (size_t jc = 0; jc < n; jc += sizes.nc) {
+    const size_t nc = std::min(sizes.nc, n - jc);
+    const size_t b_panels = (nc + kNR - 1) / kNR;
+    // Enough column ranges that every thread gets several tasks, even when m fits into a single block
+    const size_t n_chunks = std::min(b_panels, std::max<size_t>(1, parallel ? 4 * pool.size() / m_blocks : 1));
+    const size_t chunk_panels = (b_panels + n_chunks - 1) / n_chunks;
+
+    for (size_t pc = 0; pc < k; pc += sizes.kc) {
+      const size_t kc = std::min(sizes.kc, k - pc);
+      for_tasks(b_panels, [&](size_t jr) {
+        pack_b_panel(b + pc * ldb + jc + jr * kNR, ldb, std::min(kNR, nc - jr * kNR), kc,
+                     packed_b.data() + jr * kNR * kc);
+      });
+      for_tasks(a_panels, [&](size_t ir) {
+        pack_a_panel(a + ir * kMR * lda + pc, lda, std::min(kMR, m - ir * kMR), kc, packed_a.data() + ir * kMR * kc);
+      });
+
+      for_tasks(m_blocks * n_chunks, [&](size_t task) {
+        const size_t ir_begin = (task / n_chunks) * mc_panels;
+        const size_t ir_end = std::min(a_panels, ir_begin + mc_panels);
+        const size_t jr_begin = (task % n_chunks) * chunk_panels;
+        const size_t jr_end = std::min(b_panels, jr_begin + chunk_panels);
+        // The micro-panel of B stays in L1 while the loop over ir streams the block of A from L2
+        for (size_t jr = jr_begin; jr < jr_end; jr++) {
+          const size_t columns = std::min(kNR, nc - jr * kNR);
+          for (size_t ir = ir_begin; ir < ir_end; ir++) {
+            const size_t rows = std::min(kMR, m - ir * kMR);
+            const double* pa = packed_a.data() + ir * kMR * kc;
+            const double* pb = packed_b.data() + jr * kNR * kc;
+            double* block = c + ir * kMR * ldc + jc + jr * kNR;
+            if (rows == kMR && columns == kNR) {
+              microkernel(kc, pa, pb, block, ldc, alpha);
+            } else {
+              // An edge block: computed in full into a buffer, and only the valid part is added to C
+              double buffer[kMR * kNR] {};
+              microkernel(kc, pa, pb, buffer, kNR, alpha);
+              for (size_t i = 0; i < rows; i++) {
+                for (size_t j = 0; j < columns; j++) {
+                  block[i * ldc + j] += buffer[i * kNR + j];
+                }
+              }
+            }
+          }
+        }
+      });
+    }
+  }
+}
+
+} // namespace gemm
+
+// out = a * b. doubles go through the blocked GEMM, other types through a loop in i-p-j order, which at least reads
+// B and writes out row-wise.
+template <typename T, size_t M, size_t K, size_t N>
+void multiply(const Matrix<T, M, K>& a, const Matrix<T, K, N>& b, Matrix<T, M, N>& out,
+              thread_pool& pool = thread_pool::global()) {
+  assert(a.columns() == b.rows() && out.rows() == a.rows() && out.columns() == b.columns());
+  assert(out.data() != a.data() && out.data() != b.data());
+  const size_t m = a.rows();
+  const size_t k = a.columns();
+  const size_t n = b.columns();
+  if constexpr (std::is_same_v<T, double>) {
+    gemm::dgemm(m, n, k, 1.0, a.data(), k, b.data(), n, 0.0, out.data(), n, pool);
+  } else {
+    std::fill(out.data(), out.data() + m * n, T {});
+    for (size_t i = 0; i < m; i++) {
+      for (size_t p = 0; p < k; p++) {
+        const T x = a(i, p);
+        for (size_t j = 0; j < n; j++) {
+          out(i, j) += x * b(p, j);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "minmax.h"
+
+/**
+ * 1. The reductions agree with the standard algorithms, including NaN and ties
+ * 2. Against std::max_element and std::minmax_element
+ */
+
+// =================================================================
+// 1. The reductions agree with the standard algorithms, including NaN and ties
+// =================================================================
+template <typename T>
+void check_against_std(const std::vector<T>& values) {
+  auto [lo, hi] = reduce::minmax(values);
+  assert(reduce::min(values) == *std::min_element(values.begin(), values.end()) && lo == reduce::min(values));
+  assert(reduce::max(values) == *std::max_element(values.begin(), values.end()) && hi == reduce::max(values));
+  assert(reduce::argmin(values) == size_t(std::min_element(values.begin(), values.end()) - values.begin()));
+  assert(reduce::argmax(values) == size_t(std::max_element(values.begin(), values.end()) - values.begin()));
+}
+
+template <typename T>
+void test_minmax_type() {
+  std::mt19937_64 random {sizeof(T)};
+  // Sizes around the vector width, around the argmin block, and a few blocks
+  for (size_t n : {1, 2, 3, 7, 31, 32, 33, 64, 100, 1000, 4095, 4096, 8193, 20000, 100'000}) {
+    std::vector<T> values(n);
+    for (T& x : values) {
+      if constexpr (std::is_floating_point_v<T>) {
+        x = T(std::uniform_real_distribution<double>(-1e6, 1e6)(random));
+      } else {
+        x = T(random());
+      }
+    }
+    check_against_std(values);
+    // Ties: the first index wins, in the middle of a block and across blocks
+    std::vector<T> ties(n, T(5));
+    check_against_std(ties);
+    ties[n / 2] = T(1);
+    ties[n - 1] = T(1);
+    check_against_std(ties);
+    // Increasing and decreasing data, the worst case for the argmin rescans
+    std::vector<T> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    check_against_std(sorted);
+    std::reverse(sorted.begin(), sorted.end());
+    check_against_std(sorted);
+
+    std::vector<T> clamped(values);
+    reduce::clamp(clamped, T(10), T(100));
+    for (size_t i = 0; i < n; i++) {
+      assert(clamped[i] == std::clamp(values[i], T(10), T(100)));
+    }
+  }
+}
+
+void test_minmax() {
+  test_minmax_type<int8_t>();
+  test_minmax_type<uint8_t>();
+  test_minmax_type<int16_t>();
+  test_minmax_type<uint32_t>();
+  test_minmax_type<int64_t>();
+  test_minmax_type<uint64_t>();
+  test_minmax_type<float>();
+  test_minmax_type<double>();
+
+  // NaN: min and max return NaN, argmin and argmax the first NaN, clamp leaves it alone
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  for (size_t n : {1, 5, 40, 10'000}) {
+    for (size_t position : {size_t {0}, n / 2, n - 1}) {
+      std::vector<double> values(n, 1.0);
+      values[position] = nan;
+      values[n - 1 - position / 2] = nan;
+      size_t first = std::min(position, n - 1 - position / 2);
+      assert(std::isnan(reduce::min(values)) && std::isnan(reduce::max(values)));
+      auto [lo, hi] = reduce::minmax(values);
+      assert(std::isnan(lo) && std::isnan(hi));
+      assert(reduce::argmin(values) == first && reduce::argmax(values) == first);
+      reduce::clamp(values, 2.0, 3.0);
+      assert(std::isnan(values[position]) && std::isnan(values[n - 1 - position / 2]));
+      assert(std::all_of(values.begin(), values.end(), [](double x) { return std::isnan(x) || x == 2.0; }));
+    }
+  }
+
+  // Any contiguous range, with the concept rejecting what can't be reduced
+  std::array<float, 4> a {3.0f, -1.0f, 2.0f, -1.0f};
+  assert(reduce::min(a) == -1.0f && reduce::argmin(a) == 1);
+  // A mutable std::span goes through the same overloads as a std::span<const T>
+  std::vector<int> ints {4, -7, 9, 0, -7, 9, 3};
+  std::span<int> mutable_span {ints};
+  assert(reduce::min(mutable_span) == -7 && reduce::max(mutable_span) == 9);
+  assert((reduce::minmax(mutable_span) == std::pair {-7, 9}));
+  assert(reduce::argmin(mutable_span) == 1 && reduce::argmax(mutable_span) == 2);
+  reduce::clamp(mutable_span, -1, 5);
+  assert((ints == std::vector<int> {4, -1, 5, 0, -1, 5, 3}));
+  static_assert(reduce::Reducible<int> && reduce::Reducible<double> && !reduce::Reducible<bool>);
+  static_assert(!reduce::ReducibleRange<std::vector<long double>>);
+}
+
+// =================================================================
+// 2. Against std::max_element and std::minmax_element
+// =================================================================
+template <typename Fn>
+double best_ns(size_t count, Fn&& fn) {
+  double best {1e18};
+  for (int round = 0; round < 5; round++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best / double(count);
+}
+
+template <typename T>
+void benchmark_minmax_type(const char* name, size_t n) {
+  std::mt19937_64 random {1};
+  std::vector<T> values(n);
+  for (T& x : values) {
+    x = T(random() % 1'000'000);
+  }
+  volatile size_t sink {0};
+  double ours_max = best_ns(n, [&] { sink = size_t(reduce::max(values)); });
+  double std_max = best_ns(n, [&] { sink = size_t(*std::max_element(values.begin(), values.end())); });
+  double ours_argmax = best_ns(n, [&] { sink = reduce::argmax(values); });
+  double ours_minmax = best_ns(n, [&] { sink = size_t(reduce::minmax(values).second); });
+  double std_minmax = best_ns(n, [&] {
+    sink = size_t(*std::minmax_element(values.begin(), values.end()).second);
+  });
+  std::cout << name << " (ns/element): max " << ours_max << ", argmax " << ours_argmax << ", std::max_element "
+            << std_max << ", minmax " << ours_minmax << ", std::minmax_element " << std_minmax << std::endl;
+}
+
+void benchmark_minmax(size_t n = 10'000'000) {
+  benchmark_minmax_type<int8_t>("int8_t", n);
+  benchmark_minmax_type<int32_t>("int32_t", n);
+  benchmark_minmax_type<int64_t>("int64_t", n);
+  benchmark_minmax_type<float>("float", n);
+  benchmark_minmax_type<double>("double", n);
+}
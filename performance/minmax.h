@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 1. Which types can be reduced, and what happens to NaN
+ * 2. Portable SIMD with vector extensions
+ * 3. min, max and minmax
+ * 4. argmin and argmax
+ * 5. clamp
+ */
+
+// =================================================================
+// 1. Which types can be reduced, and what happens to NaN
+// =================================================================
+// max(T& a, T& b) in function_template.cc compares two values, and std::max_element walks a range the same way, one
+// comparison and one branch per element. The functions here compare a whole SIMD register of elements per instruction.
+// NaN semantics, for float and double:
+// - min, max and minmax return NaN if the range contains a NaN, a NaN is never silently skipped.
+// - argmin and argmax return the index of the first NaN if there is one.
+// - clamp leaves NaN unchanged, like std::clamp.
+// Ties return the first index, like std::min_element and std::max_element. -0.0 and 0.0 compare equal, so either one
+// may be returned by min and max.
+namespace reduce {
+
+// Built like the concepts in types.cpp. bool is an integral type, but it has no order worth reducing, and long double
+// has no SIMD support.
+template <typename T>
+concept Reducible = (std::integral<T> && !std::same_as<T, bool>) || std::same_as<T, float> || std::same_as<T, double>;
+
+template <typename R>
+concept ReducibleRange = std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+                         Reducible<std::remove_cv_t<std::ranges::range_value_t<R>>>;
+
+namespace detail {
+
+// =================================================================
+// 2. Portable SIMD with vector extensions
+// =================================================================
+// A GCC/Clang vector is one SIMD register, so the same code works for every element type without intrinsics.
+// Comparisons give a mask of all-ones lanes, and `?:` selects lane by lane. The width follows the target: 32 bytes
+// with -mavx2 or -march=native, 16 bytes (SSE2, NEON) otherwise. A 32-byte vector without AVX would be split into
+// two halves and passed through memory between functions, which is slower than std::max_element.
+#ifdef __AVX2__
+constexpr size_t kVectorBytes {32};
+#else
+constexpr size_t kVectorBytes {16};
+#endif
+
+template <typename T>
+struct vector_of {
+  typedef T type __attribute__((vector_size(kVectorBytes)));
+};
+template <typename T>
+using vec = typename vector_of<T>::type;
+
+template <typename T>
+constexpr size_t kLanes {kVectorBytes / sizeof(T)};
+
+template <typename T>
+vec<T> load(const T* p) {
+  vec<T> v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+template <typename T>
+bool is_nan(T x) {
+  if constexpr (std::is_floating_point_v<T>) {
+    return x != x;
+  } else {
+    return false;
+  }
+}
+
+// =================================================================
+// 3. min, max and minmax
+// =================================================================
+// One pass that tracks the minimum and/or the maximum, and whether a NaN was seen. A comparison with NaN is false, so
+// NaN lanes never replace the running minimum, and they are reported separately. The last, partial vector is loaded
+// so that it ends at the end of the range: it overlaps elements that were already seen, which doesn't change a min or
+// a max, so there is no scalar tail loop.
+template <typename T>
+struct extremes {
+  T min;
+  T max;
+  bool nan;
+};
+
+template <typename T, bool Min, bool Max>
+extremes<T> scan(const T* p, size_t n) {
+  assert(n > 0);
+  constexpr size_t lanes = kLanes<T>;
+  extremes<T> result {p[0], p[0], is_nan(p[0])};
+  if (n < lanes) {
+    for (size_t i = 1; i < n; i++) {
+      if constexpr (Min) {
+        result.min = p[i] < result.min ? p[i] : result.min;
+      }
+      if constexpr (Max) {
+        result.max = result.max < p[i] ? p[i] : result.max;
+      }
+      result.nan |= is_nan(p[i]);
+    }
+    return result;
+  }
+
+  // Two independent accumulators per reduction, so consecutive iterations don't wait for each other
+  vec<T> lo0 = load(p);
+  vec<T> lo1 = lo0;
+  vec<T> hi0 = lo0;
+  vec<T> hi1 = lo0;
+  auto nan = lo0 != lo0;
+  auto step = [&](vec<T> x, vec<T>& lo, vec<T>& hi) {
+    if constexpr (Min) {
+      lo = x < lo ? x : lo;
+    }
+    if constexpr (Max) {
+      hi = hi < x ? x : hi;
+    }
+    if constexpr (std::is_floating_point_v<T>) {
+      nan |= x != x;
+    }
+  };
+  size_t i = lanes;
+  for (; i + 2 * lanes <= n; i += 2 * lanes) {
+    step(load(p + i), lo0, hi0);
+    step(load(p + i + lanes), lo1, hi1);
+  }
+  for (; i < n; i += lanes) {
+    step(load(p + std::min(i, n - lanes)), lo0, hi0);
+  }
+  // The second accumulators only hold elements of the range, so they can be merged like two more vectors of data
+  step(lo1, lo0, hi0);
+  step(hi1, lo0, hi0);
+
+  for (size_t lane = 0; lane < lanes; lane++) {
+    result.min = lo0[lane] < result.min ? lo0[lane] : result.min;
+    result.max = result.max < hi0[lane] ? hi0[lane] : result.max;
+    result.nan |= nan[lane] != 0;
+  }
+  return result;
+}
+
+template <typename T>
+T nan_or(T value, bool nan) {
+  if constexpr (std::is_floating_point_v<T>) {
+    return nan ? std::numeric_limits<T>::quiet_NaN() : value;
+  } else {
+    return value;
+  }
+}
+
+} // namespace detail
+
+// The range must not be empty
+template <Reducible T>
+T min(std::span<const T> values) {
+  detail::extremes<T> e = detail::scan<T, true, false>(values.data(), values.size());
+  return detail::nan_or(e.min, e.nan);
+}
+
+template <Reducible T>
+T max(std::span<const T> values) {
+  detail::extremes<T> e = detail::scan<T, false, true>(values.data(), values.size());
+  return detail::nan_or(e.max, e.nan);
+}
+
+// Both in a single pass over the data, {min, max}
+template <Reducible T>
+std::pair<T, T> minmax(std::span<const T> values) {
+  detail::extremes<T> e = detail::scan<T, true, true>(values.data(), values.size());
+  return {detail::nan_or(e.min, e.nan), detail::nan_or(e.max, e.nan)};
+}
+
+// =================================================================
+// 4. argmin and argmax
+// =================================================================
+// Tracking an index per lane would need index lanes as wide as the elements, which overflow quickly for 8-bit and
+// 16-bit types. Instead, the range is reduced block by block, each block small enough to stay in the L1 cache. Only
+// when a block beats the best value so far (rarely, for most data) is it scanned again to find the first index of
+// its minimum, so the data is read from memory once.
+namespace detail {
+
+template <typename T>
+constexpr size_t kBlockSize {16 * 1024 / sizeof(T)};
+
+template <typename T, bool Min>
+size_t arg_extreme(const T* p, size_t n) {
+  if (n == 0) {
+    return 0;
+  }
+  size_t best_index {0};
+  T best = p[0];
+  for (size_t block = 0; block < n; block += kBlockSize<T>) {
+    const T* q = p + block;
+    const size_t size = std::min(kBlockSize<T>, n - block);
+    extremes<T> e = scan<T, Min, !Min>(q, size);
+    if (e.nan) {
+      return block + size_t(std::find_if(q, q + size, [](T x) { return is_nan(x); }) - q);
+    }
+    T candidate = Min ? e.min : e.max;
+    if (Min ? candidate < best : best < candidate) {
+      best = candidate;
+      best_index = block + size_t(std::find(q, q + size, candidate) - q);
+    }
+  }
+  return best_index;
+}
+
+} // namespace detail
+
+// The index of the first minimum, or 0 for an empty range
+template <Reducible T>
+size_t argmin(std::span<const T> values) {
+  return detail::arg_extreme<T, true>(values.data(), values.size());
+}
+
+template <Reducible T>
+size_t argmax(std::span<const T> values) {
+  return detail::arg_extreme<T, false>(values.data(), values.size());
+}
+
+// =================================================================
+// 5. clamp
+// =================================================================
+// Every element is limited to [lo, hi] in place. Clamping is idempotent, so the last vector may overlap the previous
+// one, as in scan().
+template <Reducible T>
+void clamp(std::span<T> values, std::type_identity_t<T> lo, std::type_identity_t<T> hi) {
+  assert(!(hi < lo));
+  constexpr size_t lanes = detail::kLanes<T>;
+  T* p = values.data();
+  const size_t n = values.size();
+  auto clamp_one = [lo, hi](T x) { return x < lo ? lo : hi < x ? hi : x; };
+  if (n < lanes) {
+    for (size_t i = 0; i < n; i++) {
+      p[i] = clamp_one(p[i]);
+    }
+    return;
+  }
+  detail::vec<T> vlo {};
+  detail::vec<T> vhi {};
+  vlo += lo;
+  vhi += hi;
+  for (size_t i = 0; i < n; i += lanes) {
+    T* q = p + std::min(i, n - lanes);
+    detail::vec<T> x = detail::load(q);
+    x = x < vlo ? vlo : x;
+    x = vhi < x ? vhi : x;
+    std::memcpy(q, &x, sizeof(x));
+  }
+}
+
+// The same functions for any contiguous range of a reducible type: std::vector, std::array, C arrays, std::span
+// The span is built with an explicit element type: from a std::span<int>, `std::span {data, size}` would deduce
+// std::span<int> again, which only matches these overloads, not the std::span<const T> ones.
+namespace detail {
+template <ReducibleRange R>
+std::span<const std::ranges::range_value_t<R>> const_span(const R& values) {
+  return {std::ranges::data(values), std::ranges::size(values)};
+}
+} // namespace detail
+
+template <ReducibleRange R>
+auto min(const R& values) {
+  return min(detail::const_span(values));
+}
+template <ReducibleRange R>
+auto max(const R& values) {
+  return max(detail::const_span(values));
+}
+template <ReducibleRange R>
+auto minmax(const R& values) {
+  return minmax(detail::const_span(values));
+}
+template <ReducibleRange R>
+size_t argmin(const R& values) {
+  return argmin(detail::const_span(values));
+}
+template <ReducibleRange R>
+size_t argmax(const R& values) {
+  return argmax(detail::const_span(values));
+}
+template <ReducibleRange R, typename T = std::ranges::range_value_t<R>>
+requires (!std::same_as<std::remove_cvref_t<R>, std::span<T>>)
+void clamp(R&& values, std::type_identity_t<T> lo, std::type_identity_t<T> hi) {
+  clamp(std::span<T> {std::ranges::data(values), std::ranges::size(values)}, lo, hi);
+}
+
+} // namespace reduce
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <barrier>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+#include "numa_array.h"
+
+/**
+ * 1. Every element is initialized exactly once by its owner
+ * 2. STREAM-style bandwidth for each policy
+ */
+
+// =================================================================
+// 1. Every element is initialized exactly once by its owner
+// =================================================================
+void test_numa_array() {
+  for (numa::Policy policy : {numa::Policy::serial, numa::Policy::local, numa::Policy::interleave}) {
+    numa::NumaArray<double> arr(1'000'003, policy, 3);
+    for (size_t i = 0; i < arr.size(); i += 997) {
+      assert(arr[i] == 0.0);
+    }
+    // mbind applied the policy to the whole mapping
+    assert(numa::policy_at(arr.data()) == policy && numa::policy_at(&arr[arr.size() - 1]) == policy);
+    // The partitions cover the array without gaps or overlaps
+    size_t next {0};
+    for (size_t worker = 0; worker < 3; worker++) {
+      numa::Range range = numa::worker_range<double>(arr.size(), 3, worker);
+      assert(range.begin == next);
+      next = range.end;
+    }
+    assert(next == arr.size());
+  }
+
+  // Workers are pinned to the CPUs the process may use, in order, even under taskset or a cpuset
+  const std::vector<int> cpus = numa::allowed_cpus();
+  std::vector<int> ran_on(5, -1);
+  numa::run_partitioned<double>(1000, ran_on.size(), [&](size_t worker, numa::Range) {
+    ran_on[worker] = ::sched_getcpu();
+  });
+  for (size_t worker = 0; worker < ran_on.size(); worker++) {
+    assert(ran_on[worker] == cpus[worker % cpus.size()]);
+  }
+}
+
+// =================================================================
+// 2. STREAM-style bandwidth for each policy
+// =================================================================
+// The four STREAM kernels (https://www.cs.virginia.edu/stream/) run on all workers, each on the range it owns.
+// With `serial` all pages sit on one node, with `local` each worker reads its own node, and `interleave` sits in between.
+// On a single-node machine the three policies should be equal, which is a good sanity check for the harness itself;
+// with `numa=fake=N` the kernel exposes N nodes, and the policies can be checked to place pages as expected
+// (e.g. with `numastat -p <pid>`), even though the bandwidth numbers stay the same.
+void benchmark_numa_array(size_t length = size_t{1} << 26, size_t workers = std::thread::hardware_concurrency()) {
+  std::cout << "nodes: " << numa::node_count() << ", workers: " << workers << std::endl;
+  for (numa::Policy policy : {numa::Policy::serial, numa::Policy::local, numa::Policy::interleave}) {
+    numa::NumaArray<double> a(length, policy, workers);
+    numa::NumaArray<double> b(length, policy, workers);
+    numa::NumaArray<double> c(length, policy, workers);
+    const double scalar {3.0};
+    double* pa = a.data();
+    double* pb = b.data();
+    double* pc = c.data();
+
+    // bytes moved per element for each kernel, as counted by STREAM
+    struct Kernel {
+      const char* name;
+      double bytes_per_element;
+      std::function<void(size_t, size_t)> run;
+    };
+    const Kernel kernels[] {
+        {"copy", 16, [=](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) pc[i] = pa[i]; }},
+        {"scale", 16, [=](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) pb[i] = scalar * pc[i]; }},
+        {"add", 24, [=](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) pc[i] = pa[i] + pb[i]; }},
+        {"triad", 24,
+         [=](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) pa[i] = pb[i] + scalar * pc[i]; }},
+    };
+    double best[std::size(kernels)];
+    std::fill(std::begin(best), std::end(best), 1e9);
+
+    // The same pinned threads run every round of every kernel, so thread creation isn't measured and each worker stays
+    // on the CPU that first touched its range. The barriers line the workers up, and worker 0 times each round.
+    std::barrier sync(std::ptrdiff_t(a.workers()));
+    a.for_each_partition([&](size_t worker, numa::Range range) {
+      for (size_t kernel = 0; kernel < std::size(kernels); kernel++) {
+        for (int round = 0; round < 5; round++) {
+          sync.arrive_and_wait();
+          auto start = std::chrono::steady_clock::now();
+          kernels[kernel].run(range.begin, range.end);
+          sync.arrive_and_wait();
+          if (worker == 0) {
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best[kernel] = std::min(best[kernel], seconds);
+          }
+        }
+      }
+    });
+    for (size_t kernel = 0; kernel < std::size(kernels); kernel++) {
+      std::cout << numa::policy_name(policy) << " " << kernels[kernel].name << ": "
+                << kernels[kernel].bytes_per_element * double(length) / best[kernel] / 1e9 << " GB/s" << std::endl;
+    }
+  }
+}
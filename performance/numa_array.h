@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * 1. Why a single-threaded initialization is bad on NUMA machines
+ * 2. Memory policies through mbind
+ * 3. Static partitioning shared by the initialization and the later passes
+ * 4. NumaArray<T>: parallel first-touch initialization
+ *
+ * NUMA simulation on a single-node machine: boot with `numa=fake=2` (or `numa=fake=4U`) on the kernel command line.
+ */
+
+// =================================================================
+// 1. Why a single-threaded initialization is bad on NUMA machines
+// =================================================================
+// Linux doesn't allocate physical memory when we call new or mmap, it only reserves address space. A physical page is
+// allocated when it is first written ("first touch"), and by default on the NUMA node of the CPU that writes it.
+// So if one thread zero-initializes a large Array<T> or StaticArray (see class_template.h), every page ends up on that
+// thread's node, and when many threads process the array later, all of them pull the data over the cross-socket link.
+// The fix is to let each worker touch the pages it will process later, or to interleave the pages over all nodes.
+
+namespace numa {
+
+// =================================================================
+// 2. Memory policies through mbind
+// =================================================================
+// We call the mbind system call directly instead of linking libnuma, the constants are the values from <linux/mempolicy.h>.
+enum class Policy {
+  serial,      // Baseline: the calling thread initializes everything, pages land on its node
+  local,       // MPOL_LOCAL: each page lands on the node of the worker that first touches it
+  interleave,  // MPOL_INTERLEAVE: pages are spread round-robin over all nodes, regardless of who touches them
+};
+
+inline const char* policy_name(Policy policy) {
+  switch (policy) {
+    case Policy::serial: return "serial";
+    case Policy::local: return "local";
+    case Policy::interleave: return "interleave";
+  }
+  return "unknown";
+}
+
+// The nodes are listed in /sys/devices/system/node as node0, node1, ...
+inline int node_count() {
+  static const int count = [] {
+    int nodes = 0;
+    while (::access(("/sys/devices/system/node/node" + std::to_string(nodes)).c_str(), F_OK) == 0) {
+      nodes++;
+    }
+    return nodes == 0 ? 1 : nodes;
+  }();
+  return count;
+}
+
+inline void bind_memory(void* addr, size_t bytes, Policy policy) {
+  constexpr int kMpolInterleave {3}; // MPOL_INTERLEAVE
+  constexpr int kMpolLocal {4};      // MPOL_LOCAL
+  if (policy == Policy::serial) {
+    return;
+  }
+  unsigned long node_mask {0};
+  for (int node = 0; node < node_count() && node < int(8 * sizeof(node_mask)); node++) {
+    node_mask |= 1ul << node;
+  }
+  int mode = policy == Policy::interleave ? kMpolInterleave : kMpolLocal;
+  // MPOL_LOCAL takes an empty node mask
+  const unsigned long* mask = policy == Policy::interleave ? &node_mask : nullptr;
+  unsigned long max_node = policy == Policy::interleave ? 8 * sizeof(node_mask) : 0;
+  if (::syscall(SYS_mbind, addr, bytes, mode, mask, max_node, 0) != 0) {
+    throw std::system_error(errno, std::generic_category(), "mbind");
+  }
+}
+
+// The policy the kernel applies to the page at addr, read back with get_mempolicy(MPOL_F_ADDR). Kernels before 5.12
+// report MPOL_LOCAL as MPOL_PREFERRED with an empty node mask.
+inline Policy policy_at(const void* addr) {
+  constexpr int kMpolPreferred {1}; // MPOL_PREFERRED
+  constexpr int kMpolInterleave {3};
+  constexpr int kMpolLocal {4};
+  constexpr unsigned long kMpolFAddr {2}; // MPOL_F_ADDR
+  int mode {0};
+  unsigned long node_mask[16] {};
+  if (::syscall(SYS_get_mempolicy, &mode, node_mask, 8 * sizeof(node_mask), addr, kMpolFAddr) != 0) {
+    throw std::system_error(errno, std::generic_category(), "get_mempolicy");
+  }
+  const bool no_nodes = std::all_of(std::begin(node_mask), std::end(node_mask), [](unsigned long m) { return m == 0; });
+  if (mode == kMpolInterleave) {
+    return Policy::interleave;
+  }
+  if (mode == kMpolLocal || (mode == kMpolPreferred && no_nodes)) {
+    return Policy::local;
+  }
+  return Policy::serial;
+}
+
+// =================================================================
+// 3. Static partitioning shared by the initialization and the later passes
+// =================================================================
+// First touch only pays off if the same worker processes the same range later, so the initialization and the
+// compute passes must use the same partitioning. Chunks are rounded to whole pages so that no page is shared by two workers.
+struct Range {
+  size_t begin;
+  size_t end;
+};
+
+template <typename T>
+Range worker_range(size_t length, size_t workers, size_t worker) {
+  const size_t page_elements = std::max<size_t>(1, size_t(::sysconf(_SC_PAGESIZE)) / sizeof(T));
+  const size_t pages = (length + page_elements - 1) / page_elements;
+  const size_t first_page = pages * worker / workers;
+  const size_t last_page = pages * (worker + 1) / workers;
+  return {std::min(length, first_page * page_elements), std::min(length, last_page * page_elements)};
+}
+
+// The CPUs the calling thread may run on. Under taskset or in a container with a cpuset these are not 0 to
+// hardware_concurrency() - 1, and pinning to a CPU outside of them fails with EINVAL.
+inline std::vector<int> allowed_cpus() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (::sched_getaffinity(0, sizeof(set), &set) != 0) {
+    throw std::system_error(errno, std::generic_category(), "sched_getaffinity");
+  }
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// Pin the calling thread to one CPU, so the node it runs on, and therefore where its pages land, doesn't change.
+// Returns 0 or the error of pthread_setaffinity_np.
+inline int pin_to_cpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+}
+
+// Runs fn(worker, range) on `workers` threads, each with the range it owns and pinned to the worker'th allowed CPU.
+// A thread that can't be pinned still runs, but the placement is no longer guaranteed, so the error is thrown once all
+// threads are done.
+template <typename T, typename Fn>
+void run_partitioned(size_t length, size_t workers, Fn&& fn) {
+  const std::vector<int> cpus = allowed_cpus();
+  std::vector<int> errors(workers, 0);
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  for (size_t worker = 0; worker < workers; worker++) {
+    threads.emplace_back([&, worker] {
+      errors[worker] = pin_to_cpu(cpus[worker % cpus.size()]);
+      fn(worker, worker_range<T>(length, workers, worker));
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (int error : errors) {
+    if (error != 0) {
+      throw std::system_error(error, std::generic_category(), "pthread_setaffinity_np");
+    }
+  }
+}
+
+// =================================================================
+// 4. NumaArray<T>: parallel first-touch initialization
+// =================================================================
+// An Array<T> whose memory comes straight from mmap (so no page has been touched yet), gets the requested policy,
+// and is zero-initialized by `workers` threads, each touching only the range that run_partitioned() will give it later.
+template <typename T>
+requires std::is_trivially_default_constructible_v<T>
+class NumaArray {
+  public:
+    NumaArray(size_t length, Policy policy, size_t workers = std::thread::hardware_concurrency())
+        : length_(length), bytes_(std::max<size_t>(1, length * sizeof(T))), workers_(std::max<size_t>(1, workers)) {
+      void* mapped = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mapped == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      ptr_ = static_cast<T*>(mapped);
+      try {
+        bind_memory(mapped, bytes_, policy);
+      } catch (...) {
+        ::munmap(mapped, bytes_);
+        throw;
+      }
+      if (policy == Policy::serial) {
+        std::memset(ptr_, 0, length_ * sizeof(T));
+      } else {
+        try {
+          run_partitioned<T>(length_, workers_, [this](size_t, Range range) {
+            std::memset(ptr_ + range.begin, 0, (range.end - range.begin) * sizeof(T));
+          });
+        } catch (...) {
+          ::munmap(mapped, bytes_);
+          throw;
+        }
+      }
+    }
+
+    NumaArray(const NumaArray& arr) = delete;
+    NumaArray& operator=(const NumaArray& arr) = delete;
+
+    ~NumaArray() {
+      ::munmap(ptr_, bytes_);
+    }
+
+    T& operator[](size_t index) {
+      assert(index < length_);
+      return ptr_[index];
+    }
+
+    T* data() { return ptr_; }
+    size_t size() const { return length_; }
+    size_t workers() const { return workers_; }
+
+    // Runs fn(worker, range) with the same partitioning that was used to first-touch the pages
+    template <typename Fn>
+    void for_each_partition(Fn&& fn) {
+      run_partitioned<T>(length_, workers_, std::forward<Fn>(fn));
+    }
+
+  private:
+    T* ptr_ {nullptr};
+    size_t length_;
+    size_t bytes_;
+    size_t workers_;
+};
+
+} // namespace numa
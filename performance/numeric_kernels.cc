@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "numeric_kernels.h"
+
+/**
+ * 1. Which path each range takes
+ * 2. Every path gives the same results
+ * 3. Scalar against vector, int8_t to double
+ */
+
+// =================================================================
+// 1. Which path each range takes
+// =================================================================
+namespace kernels_test {
+
+using kernels::path;
+
+auto twice_plus_one = [](auto x) { return x * 2 + 1; };
+auto typed = [](double x) { return x * 2 + 1; };
+
+static_assert(kernels::SimdArithmetic<int8_t> && kernels::SimdArithmetic<uint16_t> && kernels::SimdArithmetic<double>);
+static_assert(!kernels::SimdArithmetic<bool> && !kernels::SimdArithmetic<long double>);
+static_assert(!kernels::SimdArithmetic<std::complex<double>> && kernels::TriviallyRelocatable<std::complex<double>>);
+static_assert(!kernels::TriviallyRelocatable<std::string> && kernels::TriviallyRelocatable<long double>);
+static_assert(kernels::ContiguousRangeOf<std::vector<float>, float> && kernels::ContiguousRangeOf<int[4], int>);
+static_assert(kernels::ContiguousRangeOf<const std::array<int, 3>&, int>);
+static_assert(kernels::ContiguousRangeOf<std::span<const int>, int>);
+static_assert(!kernels::ContiguousRangeOf<std::list<float>, float>);
+static_assert(!kernels::ContiguousRangeOf<std::vector<float>, double>);
+static_assert(!kernels::ContiguousRangeOf<std::vector<bool>, bool>);
+
+// sum: vector, unrolled or scalar
+static_assert(kernels::sum_path<std::vector<int8_t>&> == path::vector);
+static_assert(kernels::sum_path<const std::array<double, 8>&> == path::vector);
+static_assert(kernels::sum_path<std::span<const uint32_t>> == path::vector);
+static_assert(kernels::sum_path<float(&)[16]> == path::vector);
+static_assert(kernels::sum_path<std::vector<std::complex<double>>&> == path::unrolled);
+static_assert(kernels::sum_path<std::vector<long double>&> == path::unrolled);
+static_assert(kernels::sum_path<std::vector<std::string>&> == path::scalar);
+static_assert(kernels::sum_path<std::list<int>&> == path::scalar);
+static_assert(kernels::sum_path<std::deque<double>&> == path::scalar);
+static_assert(kernels::sum_path<std::vector<bool>&> == path::scalar);
+
+// transform: the vector path needs the same element type on both sides and a callable that takes a vector
+static_assert(kernels::transform_path<std::vector<int16_t>&, std::vector<int16_t>&, decltype(twice_plus_one)> ==
+              path::vector);
+static_assert(kernels::transform_path<std::vector<double>&, std::span<double>, decltype(twice_plus_one)> ==
+              path::vector);
+static_assert(kernels::transform_path<std::vector<double>&, std::vector<double>&, decltype(typed)> == path::scalar);
+static_assert(kernels::transform_path<std::vector<int>&, std::vector<int64_t>&, decltype(twice_plus_one)> ==
+              path::scalar);
+static_assert(kernels::transform_path<std::list<float>&, std::vector<float>&, decltype(twice_plus_one)> ==
+              path::scalar);
+// The output must be writable
+static_assert(kernels::transform_path<std::vector<float>&, const std::vector<float>&, decltype(twice_plus_one)> ==
+              path::scalar);
+
+// inclusive_scan
+static_assert(kernels::scan_path<std::vector<uint8_t>&, std::vector<uint8_t>&> == path::vector);
+static_assert(kernels::scan_path<const std::vector<float>&, std::span<float>> == path::vector);
+static_assert(kernels::scan_path<std::vector<int>&, std::vector<int64_t>&> == path::scalar);
+static_assert(kernels::scan_path<std::deque<int>&, std::vector<int>&> == path::scalar);
+static_assert(kernels::scan_path<std::vector<std::complex<float>>&, std::vector<std::complex<float>>&> == path::scalar);
+
+// =================================================================
+// 2. Every path gives the same results
+// =================================================================
+// Values small enough that float and double sums and scans are exact in any order, and that x * 2 + 1 fits an int8_t
+template <typename T>
+std::vector<T> random_values(size_t n, uint64_t seed) {
+  std::mt19937_64 random {seed};
+  std::vector<T> values(n);
+  for (T& x : values) {
+    x = T(int(random() % 101) - 50);
+  }
+  return values;
+}
+
+template <typename T>
+void check_paths() {
+  using kernels::path;
+  // Sizes around the vector width, and past the blocks of the narrow integer sums (2^8 vectors for 8-bit elements,
+  // 2^16 vectors for 16-bit ones)
+  for (size_t n : {0, 1, 3, 7, 15, 16, 17, 31, 32, 33, 63, 100, 1000, 1 << 20 | 5}) {
+    std::vector<T> values = random_values<T>(n, n + sizeof(T));
+    const std::list<T> list(values.begin(), values.end());
+
+    using S = kernels::sum_type<T>;
+    const S expected = std::accumulate(values.begin(), values.end(), S {});
+    assert(kernels::sum(values) == expected);
+    assert(kernels::sum<path::unrolled>(values) == expected);
+    assert(kernels::sum<path::scalar>(values) == expected);
+    assert(kernels::sum(list) == expected);
+    assert(kernels::sum(std::span(values).subspan(n / 2)) ==
+           std::accumulate(values.begin() + std::ptrdiff_t(n / 2), values.end(), S {}));
+
+    std::vector<T> expected_out(n);
+    std::transform(values.begin(), values.end(), expected_out.begin(), [](T x) { return T(x * 2 + 1); });
+    std::vector<T> out(n);
+    kernels::transform(values, out, twice_plus_one);
+    assert(out == expected_out);
+    std::vector<T> scalar_out(n);
+    kernels::transform<path::scalar>(values, scalar_out, twice_plus_one);
+    assert(scalar_out == expected_out);
+    // In place
+    std::vector<T> in_place = values;
+    kernels::transform(in_place, in_place, twice_plus_one);
+    assert(in_place == expected_out);
+
+    // std::inclusive_scan into the same type, wrapping around for the narrow integers like the kernels do
+    std::inclusive_scan(values.begin(), values.end(), expected_out.begin(), [](T a, T b) { return T(a + b); });
+    kernels::inclusive_scan(values, out);
+    assert(out == expected_out);
+    kernels::inclusive_scan<path::scalar>(values, scalar_out);
+    assert(scalar_out == expected_out);
+    std::vector<T> from_list(n);
+    kernels::inclusive_scan(list, from_list);
+    assert(from_list == expected_out);
+  }
+}
+
+// The narrow integer sums add 2^(8 * sizeof(T)) vectors into lanes twice as wide before widening again: the largest and
+// the smallest values over several full blocks and a tail must neither wrap around nor lose a block
+template <typename T>
+void check_block_extremes() {
+  constexpr size_t block = (size_t(1) << (8 * sizeof(T))) * kernels::detail::kLanes<T>;
+  const size_t n = 3 * block + kernels::detail::kLanes<T> + 5;
+  for (T value : {std::numeric_limits<T>::max(), std::numeric_limits<T>::min()}) {
+    const std::vector<T> values(n, value);
+    const auto expected = kernels::sum_type<T>(n) * value;
+    assert(kernels::sum(values) == expected);
+    assert(kernels::sum<path::scalar>(values) == expected);
+    assert(kernels::sum(std::span(values).first(block)) == kernels::sum_type<T>(block) * value);
+    assert(kernels::sum(std::span(values).first(block + 1)) == kernels::sum_type<T>(block + 1) * value);
+  }
+}
+
+} // namespace kernels_test
+
+void test_numeric_kernels() {
+  using namespace kernels_test;
+  check_paths<int8_t>();
+  check_paths<uint8_t>();
+  check_paths<int16_t>();
+  check_paths<uint16_t>();
+  check_paths<int32_t>();
+  check_paths<uint32_t>();
+  check_paths<int64_t>();
+  check_paths<float>();
+  check_paths<double>();
+
+  // Integer sums don't overflow the element type
+  std::vector<int8_t> large(1'000'000, 127);
+  assert(kernels::sum(large) == 127'000'000);
+  std::vector<uint16_t> wide(200'000, 65535);
+  assert(kernels::sum(wide) == 200'000ull * 65535);
+  std::vector<int32_t> ints(100, INT32_MIN);
+  assert(kernels::sum(ints) == 100ll * INT32_MIN);
+  check_block_extremes<int8_t>();
+  check_block_extremes<uint8_t>();
+  check_block_extremes<int16_t>();
+  check_block_extremes<uint16_t>();
+
+  // The other paths, for types that don't fit a SIMD lane
+  std::vector<std::complex<double>> complex {{1, 2}, {3, 4}, {5, 6}, {7, 8}, {9, 10}};
+  assert(kernels::sum(complex) == std::complex<double>(25, 30));
+  std::vector<std::string> words {"con", "cept", "s"};
+  assert(kernels::sum(words) == "concepts");
+  std::vector<std::string> prefixes(3);
+  kernels::inclusive_scan(words, prefixes);
+  assert(prefixes.back() == "concepts" && prefixes[1] == "concept");
+  std::vector<double> halves(5);
+  kernels::transform(std::array {1, 2, 3, 4, 5}, halves, [](int x) { return x / 2.0; });
+  assert(halves[4] == 2.5);
+
+  // A C array, and a vector callable with a comparison: negative lanes are replaced by zero
+  int16_t raw[40];
+  std::iota(std::begin(raw), std::end(raw), int16_t {-20});
+  kernels::transform(raw, raw, [](auto x) { return x < 0 ? 0 * x : x; });
+  assert(raw[0] == 0 && raw[19] == 0 && raw[39] == 19 && kernels::sum(raw) == 190);
+}
+
+// =================================================================
+// 3. Scalar against vector, int8_t to double
+// =================================================================
+template <typename Fn>
+double best_ns(size_t count, Fn&& fn) {
+  double best {1e18};
+  for (int round = 0; round < 5; round++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best / double(count);
+}
+
+template <typename T>
+void benchmark_numeric_kernels_type(const char* name, size_t n) {
+  using kernels::path;
+  std::vector<T> values = kernels_test::random_values<T>(n, 1);
+  std::vector<T> out(n);
+  volatile double sink {0.0};
+  auto fn = kernels_test::twice_plus_one;
+
+  const double sum_scalar = best_ns(n, [&] { sink = double(kernels::sum<path::scalar>(values)); });
+  const double sum_vector = best_ns(n, [&] { sink = double(kernels::sum(values)); });
+  const double transform_scalar = best_ns(n, [&] { kernels::transform<path::scalar>(values, out, fn); });
+  const double transform_vector = best_ns(n, [&] { kernels::transform(values, out, fn); });
+  const double scan_scalar = best_ns(n, [&] { kernels::inclusive_scan<path::scalar>(values, out); });
+  const double scan_vector = best_ns(n, [&] { kernels::inclusive_scan(values, out); });
+  sink = double(out[n - 1]);
+  std::cout << name << " (ns/element, scalar -> vector): sum " << sum_scalar << " -> " << sum_vector << " ("
+            << sum_scalar / sum_vector << "x), transform " << transform_scalar << " -> " << transform_vector << " ("
+            << transform_scalar / transform_vector << "x), inclusive_scan " << scan_scalar << " -> " << scan_vector
+            << " (" << scan_scalar / scan_vector << "x)" << std::endl;
+}
+
+// 1M elements (1 to 8 MB per array), so that the arrays stay in the L2 or L3 cache and the kernels, not the memory,
+// are measured
+void benchmark_numeric_kernels(size_t n = 1'000'000) {
+  benchmark_numeric_kernels_type<int8_t>("int8_t", n);
+  benchmark_numeric_kernels_type<int16_t>("int16_t", n);
+  benchmark_numeric_kernels_type<int32_t>("int32_t", n);
+  benchmark_numeric_kernels_type<int64_t>("int64_t", n);
+  benchmark_numeric_kernels_type<float>("float", n);
+  benchmark_numeric_kernels_type<double>("double", n);
+}
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 1. The concept hierarchy
+ * 2. Paths, and how a kernel picks one
+ * 3. Portable SIMD with vector extensions
+ * 4. sum
+ * 5. transform
+ * 6. inclusive_scan
+ */
+
+// =================================================================
+// 1. The concept hierarchy
+// =================================================================
+// types.cpp builds concepts from type traits (Integral), from requires expressions (Addable, Addable2) and from nested
+// requirements (Addable3), and constrains add4 and add5 with std::integral and std::floating_point. The concepts here
+// are built the same way, and each one refines the previous one:
+// - TriviallyRelocatable: the object is its bytes. It can be copied with memcpy and dropped without a destructor, so
+//   a kernel may keep it in registers, in several accumulators, or in a SIMD lane.
+// - SimdArithmetic: a trivially relocatable number that fits a SIMD lane. bool is integral but has no arithmetic worth
+//   vectorizing, and long double (16 bytes) has no SIMD support.
+// ContiguousRangeOf<T> is a range whose elements are T and sit next to each other in memory, so they can be loaded a
+// vector at a time: std::vector, std::array, C arrays, std::span, soa_vector columns.
+// Because SimdArithmetic is defined in terms of TriviallyRelocatable, a constraint that uses it subsumes one that uses
+// TriviallyRelocatable alone, and the compiler picks the most constrained overload or specialization that matches.
+namespace kernels {
+
+template <typename T>
+concept TriviallyRelocatable = std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>;
+
+template <typename T>
+concept SimdArithmetic = TriviallyRelocatable<T> && std::is_arithmetic_v<T> && !std::same_as<T, bool> && requires {
+  requires sizeof(T) <= 8;
+};
+
+template <typename R, typename T>
+concept ContiguousRangeOf = std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+                            std::same_as<std::remove_cv_t<std::ranges::range_value_t<R>>, T>;
+
+// The element type of a range, without const
+template <std::ranges::range R>
+using element_t = std::remove_cv_t<std::ranges::range_value_t<R>>;
+
+// =================================================================
+// 2. Paths, and how a kernel picks one
+// =================================================================
+// Every kernel has a path variable template, e.g. sum_path<R>, with one partial specialization per path. The
+// specializations are constrained by the concepts above and the compiler chooses the most constrained one that is
+// satisfied, so adding a type that qualifies for a faster path needs no registration. The kernel branches on the path
+// with if constexpr, and tests can static_assert which path a range takes.
+// A path can also be forced with an explicit template argument, kernels::sum<kernels::path::scalar>(v), as long as it
+// is not faster than the one that would be chosen (the benchmarks compare the paths this way).
+enum class path {
+  scalar,   // one element at a time through the iterators, for any input range
+  unrolled, // contiguous and trivially relocatable: independent accumulators, no loop-carried dependency
+  vector,   // contiguous SimdArithmetic: a SIMD register of elements per instruction
+};
+
+// =================================================================
+// 3. Portable SIMD with vector extensions
+// =================================================================
+// As in minmax.h: a GCC/Clang vector is one SIMD register, 32 bytes with AVX2 and 16 bytes (SSE2, NEON) otherwise, so
+// one implementation covers every element type from int8_t to double. The arithmetic is the same on both compilers;
+// shuffles are not, and shift_lanes (section 6) has a version for each.
+namespace detail {
+
+#ifdef __AVX2__
+constexpr size_t kVectorBytes {32};
+#else
+constexpr size_t kVectorBytes {16};
+#endif
+
+template <typename T>
+constexpr size_t kLanes {kVectorBytes / sizeof(T)};
+
+// Lanes elements of T. Wider element types with the same number of lanes span several registers, which is how the
+// integer sums widen their elements.
+template <typename T, size_t Lanes>
+struct vector_of {
+  typedef T type __attribute__((vector_size(Lanes * sizeof(T))));
+};
+template <typename T, size_t Lanes = kLanes<T>>
+using vec = typename vector_of<T, Lanes>::type;
+
+template <typename T>
+vec<T> load(const T* p) {
+  vec<T> v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+template <typename T>
+void store(T* p, const vec<T>& v) {
+  std::memcpy(p, &v, sizeof(v));
+}
+
+} // namespace detail
+
+// =================================================================
+// 4. sum
+// =================================================================
+// Integers are summed in 64 bits, so that a sum of int8_t or int32_t doesn't overflow; other types in their own type.
+// Like std::reduce, the unrolled and vector paths assume that + is associative and commutative and add in a different
+// order than std::accumulate: integer sums are exact, float and double sums may differ in the last bits.
+template <typename T>
+using sum_type = std::conditional_t<std::is_integral_v<T> && !std::same_as<T, bool>,
+                                    std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>, T>;
+
+template <typename T>
+concept Summable = std::default_initializable<sum_type<T>> && requires(sum_type<T>& total, const T& x) {
+  total += x;
+};
+
+template <typename R>
+constexpr path sum_path = path::scalar;
+
+template <typename R>
+requires ContiguousRangeOf<R, element_t<R>> && TriviallyRelocatable<element_t<R>>
+constexpr path sum_path<R> = path::unrolled;
+
+template <typename R>
+requires ContiguousRangeOf<R, element_t<R>> && SimdArithmetic<element_t<R>>
+constexpr path sum_path<R> = path::vector;
+
+namespace detail {
+
+template <typename T, std::ranges::input_range R>
+sum_type<T> sum_scalar(R&& values) {
+  sum_type<T> total {};
+  for (auto&& x : values) {
+    total += x;
+  }
+  return total;
+}
+
+// Four accumulators, so that an addition never waits for the previous one (3 to 4 cycles for floating point)
+template <typename T>
+sum_type<T> sum_unrolled(const T* p, size_t n) {
+  sum_type<T> total[4] {};
+  size_t i {0};
+  for (; i + 4 <= n; i += 4) {
+    total[0] += p[i];
+    total[1] += p[i + 1];
+    total[2] += p[i + 2];
+    total[3] += p[i + 3];
+  }
+  for (; i < n; i++) {
+    total[0] += p[i];
+  }
+  total[0] += total[1];
+  total[2] += total[3];
+  total[0] += total[2];
+  return total[0];
+}
+
+// An integer type of the given size and signedness
+template <size_t Bytes, bool Signed>
+using integer_of_size = std::conditional_t<Bytes == 1, std::conditional_t<Signed, int8_t, uint8_t>,
+                        std::conditional_t<Bytes == 2, std::conditional_t<Signed, int16_t, uint16_t>,
+                        std::conditional_t<Bytes == 4, std::conditional_t<Signed, int32_t, uint32_t>,
+                                           std::conditional_t<Signed, int64_t, uint64_t>>>>;
+
+// Integers are converted to lanes of twice their width (int8_t to int16_t, ..., int32_t to int64_t), two registers
+// per register of data. 2^8 int8_t or 2^16 int16_t values always fit in a lane of twice the width, so the narrow types
+// are added in blocks of that many vectors, and each block is then added to the 64-bit total. Converting int8_t
+// straight to 32 bits would need four registers per register of data, which GCC compiles to much slower code.
+// Floating point adds in its own lanes, with four accumulators.
+template <typename T>
+sum_type<T> sum_vector(const T* p, size_t n) {
+  constexpr size_t lanes = kLanes<T>;
+  sum_type<T> total {};
+  size_t i {0};
+  if constexpr (std::is_floating_point_v<T>) {
+    vec<T> acc[4] {};
+    for (; i + 4 * lanes <= n; i += 4 * lanes) {
+      acc[0] += load(p + i);
+      acc[1] += load(p + i + lanes);
+      acc[2] += load(p + i + 2 * lanes);
+      acc[3] += load(p + i + 3 * lanes);
+    }
+    for (; i + lanes <= n; i += lanes) {
+      acc[0] += load(p + i);
+    }
+    acc[0] += acc[1];
+    acc[2] += acc[3];
+    acc[0] += acc[2];
+    for (size_t lane = 0; lane < lanes; lane++) {
+      total += acc[0][lane];
+    }
+  } else {
+    using wide = integer_of_size<sizeof(T) < 8 ? 2 * sizeof(T) : 8, std::is_signed_v<T>>;
+    constexpr size_t block = sizeof(T) < 4 ? (size_t(1) << (8 * sizeof(T))) * lanes : SIZE_MAX;
+    while (i + lanes <= n) {
+      const size_t end = n - i > block ? i + block : n;
+      vec<wide, lanes> acc {};
+      for (; i + lanes <= end; i += lanes) {
+        acc += __builtin_convertvector(load(p + i), vec<wide, lanes>);
+      }
+      for (size_t lane = 0; lane < lanes; lane++) {
+        total += acc[lane];
+      }
+    }
+  }
+  for (; i < n; i++) {
+    total += p[i];
+  }
+  return total;
+}
+
+} // namespace detail
+
+template <path P, std::ranges::input_range R, typename T = element_t<R>>
+requires Summable<T> && (P <= sum_path<R>)
+sum_type<T> sum(R&& values) {
+  if constexpr (P == path::vector) {
+    return detail::sum_vector(std::ranges::data(values), std::ranges::size(values));
+  } else if constexpr (P == path::unrolled) {
+    return detail::sum_unrolled(std::ranges::data(values), std::ranges::size(values));
+  } else {
+    return detail::sum_scalar<T>(values);
+  }
+}
+
+template <std::ranges::input_range R, typename T = element_t<R>>
+requires Summable<T>
+sum_type<T> sum(R&& values) {
+  return sum<sum_path<R>>(std::forward<R>(values));
+}
+
+// =================================================================
+// 5. transform
+// =================================================================
+// out[i] = fn(in[i]). The vector path calls fn with a whole vector, so fn must also accept one: a generic lambda such
+// as [](auto x) { return x * 2 + 1; } works for both, since the operators of a vector work lane by lane and a scalar
+// operand is broadcast. A lambda with a declared element type, [](double x) {...}, doesn't accept a vector and takes
+// the scalar path. Beware that a generic lambda whose body doesn't compile for a vector (std::sqrt(x), say) is a
+// compile error rather than a fallback, because the body has to be instantiated to deduce its return type.
+// in and out may be the same range, but must not otherwise overlap.
+template <typename In, typename Out, typename F>
+constexpr path transform_path = path::scalar;
+
+template <typename In, typename Out, typename F>
+requires SimdArithmetic<element_t<In>> && ContiguousRangeOf<In, element_t<In>> &&
+         ContiguousRangeOf<Out, element_t<In>> && std::ranges::output_range<Out, element_t<In>> &&
+         std::invocable<F&, const element_t<In>&> &&
+         std::invocable<F&, detail::vec<element_t<In>>> &&
+         std::same_as<std::invoke_result_t<F&, detail::vec<element_t<In>>>, detail::vec<element_t<In>>>
+constexpr path transform_path<In, Out, F> = path::vector;
+
+template <path P, std::ranges::input_range In, std::ranges::range Out, typename F>
+requires std::ranges::output_range<Out, std::invoke_result_t<F&, std::ranges::range_reference_t<In>>> &&
+         (P <= transform_path<In, Out, F>)
+void transform(In&& in, Out&& out, F fn) {
+  if constexpr (P == path::vector) {
+    using T = element_t<In>;
+    constexpr size_t lanes = detail::kLanes<T>;
+    const T* p = std::ranges::data(in);
+    T* q = std::ranges::data(out);
+    const size_t n = std::ranges::size(in);
+    assert(std::ranges::size(out) >= n);
+    const size_t full = n - n % lanes;
+    for (size_t i = 0; i < full; i += lanes) {
+      detail::store(q + i, fn(detail::load(p + i)));
+    }
+    for (size_t i = full; i < n; i++) {
+      q[i] = fn(p[i]);
+    }
+  } else {
+    auto o = std::ranges::begin(out);
+    for (auto&& x : in) {
+      *o = fn(x);
+      ++o;
+    }
+  }
+}
+
+template <std::ranges::input_range In, std::ranges::range Out, typename F>
+requires std::ranges::output_range<Out, std::invoke_result_t<F&, std::ranges::range_reference_t<In>>>
+void transform(In&& in, Out&& out, F fn) {
+  transform<transform_path<In, Out, F>>(std::forward<In>(in), std::forward<Out>(out), std::move(fn));
+}
+
+// =================================================================
+// 6. inclusive_scan
+// =================================================================
+// Running sums, out[i] = in[0] + ... + in[i], in the element type (integers wrap around, as with std::inclusive_scan
+// into the same type). A scalar scan is a chain of dependent additions. The vector path computes the running sums of a
+// whole vector in log2(lanes) steps of "shift the lanes up by 1, 2, 4... and add", then adds the last sum of the
+// previous vector to every lane, so only that one addition per vector is on the dependency chain.
+// As for sum, float and double results may differ in the last bits from a sequential scan.
+template <typename In, typename Out>
+constexpr path scan_path = path::scalar;
+
+template <typename In, typename Out>
+requires SimdArithmetic<element_t<In>> && ContiguousRangeOf<In, element_t<In>> &&
+         ContiguousRangeOf<Out, element_t<In>> && std::ranges::output_range<Out, element_t<In>>
+constexpr path scan_path<In, Out> = path::vector;
+
+namespace detail {
+
+// The integer type of the shuffle indices, as wide as T
+template <typename T>
+using index_t = std::conditional_t<sizeof(T) == 1, int8_t,
+                std::conditional_t<sizeof(T) == 2, int16_t, std::conditional_t<sizeof(T) == 4, int32_t, int64_t>>>;
+
+// The lanes moved up by Shift, with zeros shifted in: an index of lanes or more selects from the zero vector
+template <size_t Shift, typename T, size_t... Lane>
+vec<T> shift_lanes(vec<T> x, std::index_sequence<Lane...>) {
+  constexpr size_t lanes = kLanes<T>;
+#ifdef __clang__
+  // Clang has no __builtin_shuffle: __builtin_shufflevector takes the indices as constants instead of a vector
+  return __builtin_shufflevector(x, vec<T> {}, int(Lane >= Shift ? Lane - Shift : lanes + Lane)...);
+#else
+  using indices = vec<index_t<T>>;
+  return __builtin_shuffle(x, vec<T> {}, indices {index_t<T>(Lane >= Shift ? Lane - Shift : lanes + Lane)...});
+#endif
+}
+
+template <typename T, size_t... Step>
+vec<T> prefix_sums(vec<T> x, std::index_sequence<Step...>) {
+  ((x += shift_lanes<size_t(1) << Step, T>(x, std::make_index_sequence<kLanes<T>> {})), ...);
+  return x;
+}
+
+constexpr size_t log2(size_t n) {
+  return n <= 1 ? 0 : 1 + log2(n / 2);
+}
+
+template <typename T>
+void scan_vector(const T* p, T* q, size_t n) {
+  // Signed overflow is undefined in vector lanes too. Unsigned lanes wrap around, and give the same bits.
+  if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    using U = std::make_unsigned_t<T>;
+    scan_vector(reinterpret_cast<const U*>(p), reinterpret_cast<U*>(q), n);
+  } else {
+    constexpr size_t lanes = kLanes<T>;
+    vec<T> carry {};
+    size_t i {0};
+    for (; i + lanes <= n; i += lanes) {
+      vec<T> x = prefix_sums<T>(load(p + i), std::make_index_sequence<log2(lanes)> {}) + carry;
+      store(q + i, x);
+      carry = vec<T> {} + x[lanes - 1];
+    }
+    T running = carry[0];
+    for (; i < n; i++) {
+      running = T(running + p[i]);
+      q[i] = running;
+    }
+  }
+}
+
+} // namespace detail
+
+template <path P, std::ranges::input_range In, std::ranges::range Out, typename T = element_t<In>>
+requires std::ranges::output_range<Out, T> && std::copyable<T> && (P <= scan_path<In, Out>)
+void inclusive_scan(In&& in, Out&& out) {
+  if constexpr (P == path::vector) {
+    assert(std::ranges::size(out) >= std::ranges::size(in));
+    detail::scan_vector(std::ranges::data(in), std::ranges::data(out), std::ranges::size(in));
+  } else {
+    auto o = std::ranges::begin(out);
+    auto it = std::ranges::begin(in);
+    const auto last = std::ranges::end(in);
+    if (it == last) {
+      return;
+    }
+    T running = *it;
+    *o = running;
+    for (++it, ++o; it != last; ++it, ++o) {
+      running = T(running + *it);
+      *o = running;
+    }
+  }
+}
+
+template <std::ranges::input_range In, std::ranges::range Out, typename T = element_t<In>>
+requires std::ranges::output_range<Out, T> && std::copyable<T>
+void inclusive_scan(In&& in, Out&& out) {
+  inclusive_scan<scan_path<In, Out>>(std::forward<In>(in), std::forward<Out>(out));
+}
+
+} // namespace kernels
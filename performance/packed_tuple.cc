@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "packed_tuple.h"
+
+/**
+ * 1. Declared order for access, sorted order for storage
+ * 2. Memory and scan time for 100M tuples: struct, std::tuple and packed_tuple
+ */
+
+// =================================================================
+// 1. Declared order for access, sorted order for storage
+// =================================================================
+void test_packed_tuple() {
+  packed_tuple<char, double, int16_t> t {'a', 2.5, 7};
+  assert(get<0>(t) == 'a' && get<1>(t) == 2.5 && get<2>(t) == 7);
+  // The double is stored first, the char last
+  assert(static_cast<void*>(&get<1>(t)) == static_cast<void*>(&t));
+  assert(reinterpret_cast<char*>(&get<0>(t)) - reinterpret_cast<char*>(&t) == 10);
+
+  // Structured bindings, by reference and by value, like the pairs of std_pair_and_tuple.cc
+  auto& [c, d, s] = t;
+  c = 'b';
+  d = 3.5;
+  assert(get<0>(t) == 'b' && t.get<1>() == 3.5);
+  auto [c2, d2, s2] = t;
+  s2 = 100;
+  assert(s == 7 && c2 == 'b' && d2 == 3.5);
+  static_assert(std::is_same_v<std::tuple_element_t<2, decltype(t)>, int16_t>);
+  static_assert(std::tuple_size_v<decltype(t)> == 3);
+
+  assert(t == (packed_tuple<char, double, int16_t> {'b', 3.5, 7}));
+  assert(!(t == (packed_tuple<char, double, int16_t> {'b', 3.5, 8})));
+  assert(t.to_tuple() == std::make_tuple('b', 3.5, int16_t {7}));
+  assert((packed_tuple<char, double, int16_t> {} == packed_tuple<char, double, int16_t> {0, 0.0, 0}));
+
+  // Usable at compile time
+  constexpr packed_tuple<bool, int64_t, int32_t> constant {true, 1LL << 40, -1};
+  static_assert(get<1>(constant) == 1LL << 40 && get<2>(constant) == -1 && get<0>(constant));
+
+  // Non-trivial elements are moved in and out
+  packed_tuple<char, std::string, std::unique_ptr<int>> owning {'x', std::string(50, 'y'), std::make_unique<int>(3)};
+  std::unique_ptr<int> p = get<2>(std::move(owning));
+  assert(*p == 3 && get<2>(owning) == nullptr && get<1>(owning).size() == 50);
+  std::string taken = std::move(owning).get<1>();
+  assert(taken.size() == 50);
+
+  // Already sorted shapes keep their order and size, equal alignments keep their relative order
+  static_assert(packed_tuple<int32_t, int32_t, int32_t>::kOrder == std::array<size_t, 3> {0, 1, 2});
+  static_assert(packed_tuple<char, int16_t, char, int16_t>::kOrder == std::array<size_t, 4> {1, 3, 0, 2});
+  static_assert(packed_tuple<char, int16_t, char, int16_t>::kPosition == std::array<size_t, 4> {2, 0, 3, 1});
+  static_assert(sizeof(packed_tuple<double>) == sizeof(double) && sizeof(packed_tuple<char, char, char>) == 3);
+}
+
+// =================================================================
+// 2. Memory and scan time for 100M tuples: struct, std::tuple and packed_tuple
+// =================================================================
+// An account record, with the members in the order a programmer would write them down
+struct account {
+  bool active;
+  double balance;
+  int32_t id;
+  bool flagged;
+  int16_t branch;
+};
+
+template <size_t I>
+auto field(const account& a) {
+  return std::get<I>(std::tie(a.active, a.balance, a.id, a.flagged, a.branch));
+}
+template <size_t I, typename Tuple>
+auto field(const Tuple& t) {
+  using std::get;
+  return get<I>(t);
+}
+
+template <typename Row>
+void benchmark_layout(const char* name, size_t n) {
+  std::vector<Row> rows(n);
+  for (size_t i = 0; i < n; i++) {
+    const uint64_t h = (i + 1) * 0x9E3779B97F4A7C15ull;
+    rows[i] = Row {(h >> 63) != 0, double(h % 1'000'000) * 0.01, int32_t(i), (h & 0xF) == 0, int16_t(h >> 48)};
+  }
+  volatile double sink {0.0};
+  auto best_seconds = [](auto&& fn) {
+    double best {1e18};
+    for (int round = 0; round < 3; round++) {
+      auto start = std::chrono::steady_clock::now();
+      fn();
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+  };
+  // One field, and a predicate on three fields
+  const double sum = best_seconds([&] {
+    double acc[4] {};
+    for (size_t i = 0; i + 4 <= n; i += 4) {
+      for (size_t lane = 0; lane < 4; lane++) {
+        acc[lane] += field<1>(rows[i + lane]);
+      }
+    }
+    sink = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+  });
+  const double filter = best_seconds([&] {
+    size_t count {0};
+    for (const Row& row : rows) {
+      count += field<0>(row) & !field<3>(row) & (field<4>(row) > 0);
+    }
+    sink = double(count);
+  });
+  std::cout << name << ": " << sizeof(Row) << " bytes, " << sizeof(Row) * n / (1024 * 1024) << " MB, sum(balance) "
+            << sum * 1e3 << " ms, count(active && !flagged && branch > 0) " << filter * 1e3 << " ms" << std::endl;
+}
+
+// The three vectors are built one after the other, at most 2.4 GB at a time
+void benchmark_packed_tuple(size_t n = 100'000'000) {
+  benchmark_layout<account>("struct in declaration order", n);
+  benchmark_layout<std::tuple<bool, double, int32_t, bool, int16_t>>("std::tuple", n);
+  benchmark_layout<packed_tuple<bool, double, int32_t, bool, int16_t>>("packed_tuple", n);
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 1. Padding in declaration order
+ * 2. The storage order, computed at compile time
+ * 3. packed_tuple
+ * 4. Tuple protocol: get, tuple_size, tuple_element, structured bindings
+ * 5. Sizes of common shapes
+ */
+
+// =================================================================
+// 1. Padding in declaration order
+// =================================================================
+// Every member of a struct is placed at the next offset that is a multiple of its alignment, and the size of the struct
+// is rounded up to a multiple of its largest alignment, so that the elements of an array are aligned too. A
+// std::tuple<char, double, char> (or a struct with these members) therefore takes 24 bytes: 1 + 7 bytes of padding
+// before the double + 8 + 1 + 7 bytes of padding at the end, for 10 bytes of data. Ordering the members by decreasing
+// alignment leaves no holes between them, only the padding at the end: double, char, char is 16 bytes.
+// In memory-bound scans over many tuples, the padding is read like the data, so the time goes down with the size.
+// packed_tuple does the reordering at compile time, while get<I> keeps the order of the declaration.
+
+// =================================================================
+// 2. The storage order, computed at compile time
+// =================================================================
+namespace packed_detail {
+
+// kOrder[position] is the declared index of the element stored at that position: a stable sort by decreasing
+// alignment, so elements of the same alignment keep their relative order
+template <typename... Ts>
+constexpr std::array<size_t, sizeof...(Ts)> storage_order() {
+  constexpr std::array<size_t, sizeof...(Ts)> alignments {alignof(Ts)...};
+  std::array<size_t, sizeof...(Ts)> order {};
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  // Insertion sort: a handful of elements, and it is stable
+  for (size_t i = 1; i < order.size(); i++) {
+    for (size_t j = i; j > 0 && alignments[order[j - 1]] < alignments[order[j]]; j--) {
+      std::swap(order[j - 1], order[j]);
+    }
+  }
+  return order;
+}
+
+// The inverse: kPosition[declared index] is the storage position of that element
+template <typename... Ts>
+constexpr std::array<size_t, sizeof...(Ts)> storage_position() {
+  constexpr std::array<size_t, sizeof...(Ts)> order = storage_order<Ts...>();
+  std::array<size_t, sizeof...(Ts)> position {};
+  for (size_t i = 0; i < order.size(); i++) {
+    position[order[i]] = i;
+  }
+  return position;
+}
+
+// The storage is a chain of structs, each holding the next element and the rest of the chain. Since the alignment
+// never increases along the chain, the rest starts right after the element and the chain has the same size as a flat
+// struct of the elements in that order. All members of every struct are public and of one access level, so the chain
+// is standard-layout whenever the elements are.
+template <typename... Ts>
+struct storage;
+
+template <typename T>
+struct storage<T> {
+  T head;
+};
+
+template <typename T, typename... Rest>
+struct storage<T, Rest...> {
+  T head;
+  storage<Rest...> tail;
+};
+
+template <size_t Position, typename Storage>
+constexpr auto& element(Storage& s) {
+  if constexpr (Position == 0) {
+    return s.head;
+  } else {
+    return element<Position - 1>(s.tail);
+  }
+}
+
+// storage<> of the elements of Ts in storage order
+template <typename Tuple, typename Indices>
+struct sorted_storage;
+
+template <typename... Ts, size_t... Positions>
+struct sorted_storage<std::tuple<Ts...>, std::index_sequence<Positions...>> {
+  static constexpr std::array<size_t, sizeof...(Ts)> kOrder = storage_order<Ts...>();
+  using type = storage<std::tuple_element_t<kOrder[Positions], std::tuple<Ts...>>...>;
+};
+
+} // namespace packed_detail
+
+// =================================================================
+// 3. packed_tuple
+// =================================================================
+// A tuple of at least one element (and no references), constructed and accessed in declaration order and stored by
+// decreasing alignment. The elements are value-initialized by the default constructor, like those of std::tuple.
+template <typename... Ts>
+requires (sizeof...(Ts) > 0 && (std::is_object_v<Ts> && ...))
+class packed_tuple {
+  public:
+    using storage_type =
+        typename packed_detail::sorted_storage<std::tuple<Ts...>, std::index_sequence_for<Ts...>>::type;
+    static constexpr std::array<size_t, sizeof...(Ts)> kOrder = packed_detail::storage_order<Ts...>();
+    static constexpr std::array<size_t, sizeof...(Ts)> kPosition = packed_detail::storage_position<Ts...>();
+
+    constexpr packed_tuple() : storage_ {} {}
+    constexpr packed_tuple(Ts... values)
+        : storage_ {make_chain<0>(std::forward_as_tuple(std::move(values)...), static_cast<storage_type*>(nullptr))} {}
+
+    template <size_t I>
+    constexpr auto& get() & {
+      return packed_detail::element<kPosition[I]>(storage_);
+    }
+    template <size_t I>
+    constexpr const auto& get() const & {
+      return packed_detail::element<kPosition[I]>(storage_);
+    }
+    template <size_t I>
+    constexpr auto&& get() && {
+      return std::move(packed_detail::element<kPosition[I]>(storage_));
+    }
+
+    // In declaration order, like the comparisons of std::tuple
+    friend constexpr bool operator==(const packed_tuple& a, const packed_tuple& b) {
+      return [&]<size_t... I>(std::index_sequence<I...>) {
+        return ((a.template get<I>() == b.template get<I>()) && ...);
+      }(std::index_sequence_for<Ts...> {});
+    }
+
+    constexpr std::tuple<Ts...> to_tuple() const {
+      return [this]<size_t... I>(std::index_sequence<I...>) {
+        return std::tuple<Ts...> {get<I>()...};
+      }(std::index_sequence_for<Ts...> {});
+    }
+
+  private:
+    // Aggregate initialization of the chain, with the elements picked in storage order from the declared arguments.
+    // The pointer argument only carries the type of the rest of the chain.
+    template <size_t Position, typename Args, typename T, typename... Rest>
+    static constexpr packed_detail::storage<T, Rest...> make_chain(Args&& args, packed_detail::storage<T, Rest...>*) {
+      if constexpr (sizeof...(Rest) == 0) {
+        return {std::get<kOrder[Position]>(std::forward<Args>(args))};
+      } else {
+        using rest = packed_detail::storage<Rest...>;
+        return {std::get<kOrder[Position]>(std::forward<Args>(args)),
+                make_chain<Position + 1>(std::forward<Args>(args), static_cast<rest*>(nullptr))};
+      }
+    }
+
+    storage_type storage_;
+};
+
+// =================================================================
+// 4. Tuple protocol: get, tuple_size, tuple_element, structured bindings
+// =================================================================
+// With these, `auto& [a, b, c] = t` works as for the std::pair and std::tuple of std_pair_and_tuple.cc
+template <size_t I, typename... Ts>
+constexpr auto& get(packed_tuple<Ts...>& t) {
+  return t.template get<I>();
+}
+template <size_t I, typename... Ts>
+constexpr const auto& get(const packed_tuple<Ts...>& t) {
+  return t.template get<I>();
+}
+template <size_t I, typename... Ts>
+constexpr auto&& get(packed_tuple<Ts...>&& t) {
+  return std::move(t).template get<I>();
+}
+
+template <typename... Ts>
+struct std::tuple_size<packed_tuple<Ts...>> : std::integral_constant<size_t, sizeof...(Ts)> {};
+
+template <size_t I, typename... Ts>
+struct std::tuple_element<I, packed_tuple<Ts...>> : std::tuple_element<I, std::tuple<Ts...>> {};
+
+// =================================================================
+// 5. Sizes of common shapes
+// =================================================================
+// Against a struct with the same members in declaration order, on the usual 64-bit ABIs (double and int64_t aligned to
+// 8 bytes). Shapes that are already sorted don't change.
+static_assert(sizeof(packed_tuple<char, double, char>) == 16);               // 24 in declaration order
+static_assert(sizeof(packed_tuple<char, int32_t, char, int32_t>) == 12);     // 16
+static_assert(sizeof(packed_tuple<int16_t, int64_t, int16_t, int32_t>) == 16); // 24
+static_assert(sizeof(packed_tuple<bool, double, int32_t, bool, int16_t>) == 16); // 24
+static_assert(sizeof(packed_tuple<int32_t, int32_t, int32_t>) == 12);        // the tuple<int,int,int> of p3
+static_assert(sizeof(packed_tuple<double, int32_t>) == 16);                  // padding at the end remains
+static_assert(std::is_standard_layout_v<packed_tuple<char, double, int16_t>>);
+static_assert(packed_tuple<char, double, int16_t>::kOrder == std::array<size_t, 3> {1, 2, 0});
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "parallel.h"
+
+/**
+ * 1. parallel_for and parallel_reduce visit every index exactly once
+ * 2. Scaling against a serial loop and std::execution::par
+ *
+ * std::execution::par in libstdc++ runs on TBB, so link with -ltbb.
+ */
+
+// =================================================================
+// 1. parallel_for and parallel_reduce visit every index exactly once
+// =================================================================
+void test_parallel() {
+  // An explicit pool of 4 threads, so the test runs concurrently even on a machine with a single core
+  thread_pool pool {4};
+  assert(pool.size() == 4);
+
+  for (size_t grain : {0, 1, 7, 1000, 1'000'000}) {
+    std::vector<int> visits(1'000'000, 0);
+    parallel_for(0, visits.size(), grain, [&](size_t i) { visits[i]++; }, pool);
+    assert(std::all_of(visits.begin(), visits.end(), [](int v) { return v == 1; }));
+
+    uint64_t sum = parallel_reduce(size_t {0}, visits.size(), grain, uint64_t {0}, [](size_t i) { return uint64_t(i); },
+                                   std::plus<>{}, pool);
+    assert(sum == uint64_t(visits.size()) * (visits.size() - 1) / 2);
+  }
+
+  // The loops of std_vector_examples(), over the elements of the vector
+  std::vector<int> v4 {1, 2, 3, 4, 5};
+  parallel_for(v4, 0, [](int& x) { x *= 2; }, pool);
+  assert((v4 == std::vector<int> {2, 4, 6, 8, 10}));
+
+  // Empty and tiny ranges run inline, and a reduction of nothing is the identity
+  parallel_for(5, 5, 0, [](size_t) { assert(false); }, pool);
+  assert(parallel_reduce(size_t {0}, size_t {0}, 0, -1, [](size_t) { return 0; }, std::plus<>{}, pool) == -1);
+
+  // Any associative and commutative combine works, e.g. max
+  std::vector<double> values(100'000);
+  for (size_t i = 0; i < values.size(); i++) {
+    values[i] = std::sin(double(i));
+  }
+  double maximum = parallel_reduce(values, 100, -std::numeric_limits<double>::infinity(), [](double x) { return x; },
+                                   [](double a, double b) { return std::max(a, b); }, pool);
+  assert(maximum == *std::max_element(values.begin(), values.end()));
+
+  // A parallel_for inside a parallel_for runs the inner loop on the thread that called it
+  std::vector<std::atomic<int>> cells(100 * 1000);
+  parallel_for(0, 100, 1, [&](size_t row) {
+    parallel_for(0, 1000, 10, [&](size_t column) { cells[row * 1000 + column]++; }, pool);
+  }, pool);
+  assert(std::all_of(cells.begin(), cells.end(), [](const std::atomic<int>& c) { return c == 1; }));
+
+  // Two threads using the pool at the same time: one of them gets the pool, the other one runs inline
+  std::vector<int> a(1'000'000, 0);
+  std::vector<int> b(1'000'000, 0);
+  std::thread other {[&] { parallel_for(a, 1000, [](int& x) { x++; }, pool); }};
+  parallel_for(b, 1000, [](int& x) { x++; }, pool);
+  other.join();
+  assert(std::count(a.begin(), a.end(), 1) == 1'000'000 && std::count(b.begin(), b.end(), 1) == 1'000'000);
+
+  // An exception on the calling thread or on a worker reaches the caller once every participant is done
+  for (size_t thrower : {0, 2}) {
+    std::atomic<int> finished {0};
+    try {
+      pool.run(4, [&](size_t i) {
+        if (i == thrower) {
+          throw std::runtime_error("participant " + std::to_string(i));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        finished++;
+      });
+      assert(false);
+    } catch (const std::runtime_error& e) {
+      assert(e.what() == "participant " + std::to_string(thrower) && finished == 3);
+    }
+  }
+  // The same through parallel_for, from whichever participant claims the chunk
+  bool caught {false};
+  try {
+    parallel_for(0, 1'000'000, 1000, [](size_t i) {
+      if (i == 777'777) {
+        throw std::out_of_range("index " + std::to_string(i));
+      }
+    }, pool);
+  } catch (const std::out_of_range& e) {
+    caught = e.what() == std::string("index 777777");
+  }
+  assert(caught);
+  // The pool is still usable afterwards, and the calling thread isn't stuck in "inside a job", which would make
+  // every later call run inline
+  std::vector<std::thread::id> ids(4);
+  pool.run(4, [&](size_t i) { ids[i] = std::this_thread::get_id(); });
+  assert(ids[0] == std::this_thread::get_id());
+  assert(std::all_of(ids.begin() + 1, ids.end(), [](std::thread::id id) { return id != std::this_thread::get_id(); }));
+}
+
+// =================================================================
+// 2. Scaling against a serial loop and std::execution::par
+// =================================================================
+// 1B floats are 4 GB, pass smaller sizes on smaller machines
+void benchmark_parallel(std::vector<size_t> sizes = {10'000'000, 100'000'000, 1'000'000'000}) {
+  std::cout << "threads: " << thread_pool::global().size() << std::endl;
+  for (size_t size : sizes) {
+    std::vector<float> v(size);
+    parallel_for(v, 0, [](float& x) { x = 1.0f; }); // first touch from the threads that will use the memory
+
+    // Memory bound: v[i] *= 2 as in std_vector_examples()
+    double serial = best_seconds([&] {
+      for (float& x : v) {
+        x *= 2.0f;
+      }
+    });
+    double ours = best_seconds([&] { parallel_for(v, 0, [](float& x) { x *= 2.0f; }); });
+    double par = best_seconds([&] {
+      std::for_each(std::execution::par, v.begin(), v.end(), [](float& x) { x *= 2.0f; });
+    });
+    double bytes = 2.0 * double(size * sizeof(float)) * 1e-9;
+    std::cout << size << " x *= 2 (GB/s): serial " << bytes / serial << ", parallel_for " << bytes / ours
+              << ", std::execution::par " << bytes / par << std::endl;
+
+    // Compute bound: a few dozen cycles per element
+    auto heavy = [](float& x) { x = std::sqrt(std::abs(std::sin(x)) + 1.0f); };
+    serial = best_seconds([&] { std::for_each(v.begin(), v.end(), heavy); });
+    ours = best_seconds([&] { parallel_for(v, 0, heavy); });
+    par = best_seconds([&] { std::for_each(std::execution::par, v.begin(), v.end(), heavy); });
+    std::cout << size << " sqrt(|sin(x)| + 1) (ns/element): serial " << serial * 1e9 / double(size)
+              << ", parallel_for " << ours * 1e9 / double(size) << ", std::execution::par "
+              << par * 1e9 / double(size) << std::endl;
+
+    volatile double sink {0.0};
+    serial = best_seconds([&] { sink = std::accumulate(v.begin(), v.end(), 0.0); });
+    ours = best_seconds([&] { sink = parallel_reduce(v, 0, 0.0, [](float x) { return double(x); }, std::plus<>{}); });
+    par = best_seconds([&] { sink = std::reduce(std::execution::par, v.begin(), v.end(), 0.0); });
+    bytes = double(size * sizeof(float)) * 1e-9;
+    std::cout << size << " sum (GB/s): serial " << bytes / serial << ", parallel_reduce " << bytes / ours
+              << ", std::execution::par " << bytes / par << std::endl;
+  }
+}
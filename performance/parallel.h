@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <ranges>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "function_ref.h"
+
+/**
+ * 1. A persistent thread pool
+ * 2. Adaptive chunking
+ * 3. parallel_for
+ * 4. parallel_reduce
+ */
+
+// =================================================================
+// 1. A persistent thread pool
+// =================================================================
+// Starting a std::thread costs tens of microseconds, so a loop that starts its own threads (like parallel_transform
+// did before) only pays off for very large inputs. The pool starts its workers once, and a parallel call only wakes
+// them up. The calling thread always takes part in the work, so a pool of n threads has n - 1 workers.
+class thread_pool {
+  public:
+    explicit thread_pool(size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+      workers_.reserve(threads - 1);
+      for (size_t i = 1; i < threads; i++) {
+        workers_.emplace_back([this, i] { work(i); });
+      }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool() {
+      {
+        std::lock_guard lock {mutex_};
+        stop_ = true;
+      }
+      wake_.notify_all();
+      for (std::thread& worker : workers_) {
+        worker.join();
+      }
+    }
+
+    // The pool used by parallel_for and parallel_reduce, started on first use
+    static thread_pool& global() {
+      static thread_pool pool;
+      return pool;
+    }
+
+    size_t size() const { return workers_.size() + 1; }
+
+    // Calls fn(0), ..., fn(participants - 1) concurrently, fn(0) on the calling thread, and returns when all of them
+    // have returned. A call from inside a job (nested parallelism), or while another thread is using the pool, runs
+    // every fn(i) on the calling thread instead of waiting: fn must not rely on running concurrently.
+    // If any fn(i) throws, run() still waits for all of them (they use fn, which lives on the caller's stack), then
+    // rethrows the first exception on the calling thread. The other participants are not interrupted.
+    void run(size_t participants, function_ref<void(size_t)> fn) {
+      participants = std::min(participants, size());
+      std::unique_lock busy {busy_, std::try_to_lock};
+      if (participants <= 1 || inside_job_ || !busy.owns_lock()) {
+        for (size_t i = 0; i < participants; i++) {
+          fn(i);
+        }
+        return;
+      }
+      {
+        std::lock_guard lock {mutex_};
+        job_ = &fn;
+        participants_ = participants;
+        error_ = nullptr;
+        pending_.store(participants - 1, std::memory_order_relaxed);
+        generation_++;
+      }
+      wake_.notify_all();
+      call(fn, 0);
+      // The workers are usually done by now, so wait on the counter itself rather than on a condition variable
+      for (size_t left = pending_.load(std::memory_order_acquire); left != 0;
+           left = pending_.load(std::memory_order_acquire)) {
+        pending_.wait(left, std::memory_order_acquire);
+      }
+      // Every worker is done with the job, so error_ can be read without the lock
+      if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+      }
+    }
+
+  private:
+    // Marks the thread as running a job, until the job returns or throws
+    struct job_scope {
+      job_scope() { inside_job_ = true; }
+      ~job_scope() { inside_job_ = false; }
+      job_scope(const job_scope&) = delete;
+      job_scope& operator=(const job_scope&) = delete;
+    };
+
+    // Runs fn(index) as part of the current job, an exception is kept in error_ if it is the first one
+    void call(function_ref<void(size_t)>& fn, size_t index) {
+      try {
+        job_scope scope;
+        fn(index);
+      } catch (...) {
+        std::lock_guard lock {mutex_};
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+    }
+
+    void work(size_t index) {
+      size_t seen {0};
+      for (;;) {
+        function_ref<void(size_t)>* job;
+        {
+          std::unique_lock lock {mutex_};
+          wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+          if (stop_) {
+            return;
+          }
+          seen = generation_;
+          if (index >= participants_) {
+            continue;
+          }
+          job = job_;
+        }
+        call(*job, index);
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          pending_.notify_one();
+        }
+      }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex busy_; // held by the thread that is running a job on the pool
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    function_ref<void(size_t)>* job_ {nullptr};
+    size_t participants_ {0};
+    size_t generation_ {0};
+    bool stop_ {false};
+    std::exception_ptr error_; // the first exception thrown by the current job, guarded by mutex_
+    std::atomic<size_t> pending_ {0};
+    static inline thread_local bool inside_job_ {false};
+};
+
+// =================================================================
+// 2. Adaptive chunking
+// =================================================================
+// Chunks are claimed from a shared counter, and every claim takes a fixed fraction of what is left (guided
+// scheduling): the first chunks are large, so there are few claims, and the last ones are small, so a thread that was
+// slowed down doesn't leave the others idle at the end. `grain` is the smallest chunk, so that the cost of a claim
+// stays small compared to the work in the chunk.
+// std::hardware_destructive_interference_size would be the portable spelling, but GCC warns that its value depends on
+// the -mtune flags, which would make the layout of these types differ between translation units.
+constexpr size_t kCacheLineSize {64};
+
+class chunk_scheduler {
+  public:
+    chunk_scheduler(size_t begin, size_t end, size_t grain, size_t participants)
+        : next_(begin), end_(end), grain_(std::max<size_t>(1, grain)), divisor_(2 * participants) {}
+
+    // Returns false when the range is exhausted
+    bool claim(size_t& begin, size_t& end) {
+      size_t current = next_.load(std::memory_order_relaxed);
+      for (;;) {
+        if (current >= end_) {
+          return false;
+        }
+        size_t size = std::max(grain_, (end_ - current) / divisor_);
+        size_t last = std::min(end_, current + size);
+        if (next_.compare_exchange_weak(current, last, std::memory_order_relaxed)) {
+          begin = current;
+          end = last;
+          return true;
+        }
+      }
+    }
+
+  private:
+    // The counter is written by every thread, keep it away from the read-only members
+    alignas(kCacheLineSize) std::atomic<size_t> next_;
+    alignas(kCacheLineSize) size_t end_;
+    size_t grain_;
+    size_t divisor_;
+};
+
+// Without a grain from the caller, aim for a few dozen chunks per thread
+inline size_t default_grain(size_t count, size_t threads) {
+  return std::max<size_t>(1, count / (threads * 32));
+}
+
+// =================================================================
+// 3. parallel_for
+// =================================================================
+// Calls fn(i) for every i in [begin, end). fn is called in a plain loop within each chunk, so after inlining the
+// compiler vectorizes the chunk like a serial loop. Ranges smaller than two grains run inline on the calling thread,
+// without touching the pool.
+//   parallel_for(0, v.size(), 0, [&](size_t i) { v[i] *= 2; });
+template <typename Fn>
+void parallel_for(size_t begin, size_t end, size_t grain, Fn&& fn, thread_pool& pool = thread_pool::global()) {
+  if (end <= begin) {
+    return;
+  }
+  const size_t count = end - begin;
+  if (grain == 0) {
+    grain = default_grain(count, pool.size());
+  }
+  if (pool.size() == 1 || count < 2 * grain) {
+    for (size_t i = begin; i < end; i++) {
+      fn(i);
+    }
+    return;
+  }
+  chunk_scheduler scheduler {begin, end, grain, pool.size()};
+  pool.run(std::min(pool.size(), count / grain), [&](size_t) {
+    size_t chunk_begin;
+    size_t chunk_end;
+    while (scheduler.claim(chunk_begin, chunk_end)) {
+      for (size_t i = chunk_begin; i < chunk_end; i++) {
+        fn(i);
+      }
+    }
+  });
+}
+
+// The same over the elements of a random access range, e.g. a std::vector or a std::span
+//   parallel_for(v4, 0, [](int& x) { x *= 2; });
+template <std::ranges::random_access_range R, typename Fn>
+requires std::ranges::sized_range<R>
+void parallel_for(R&& range, size_t grain, Fn&& fn, thread_pool& pool = thread_pool::global()) {
+  auto first = std::ranges::begin(range);
+  parallel_for(0, size_t(std::ranges::size(range)), grain, [&](size_t i) { fn(first[i]); }, pool);
+}
+
+// =================================================================
+// 4. parallel_reduce
+// =================================================================
+// Returns combine(identity, map(begin), ..., map(end - 1)) in some order, so combine must be associative and
+// commutative. For floating-point sums that means the result may differ in the last bits from run to run.
+// Each participant accumulates in a local variable and writes it once into its own cache line, so the partial results
+// never share a cache line (false sharing would make every update of one thread invalidate the others' caches).
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(size_t begin, size_t end, size_t grain, T identity, Map&& map, Combine&& combine,
+                  thread_pool& pool = thread_pool::global()) {
+  if (end <= begin) {
+    return identity;
+  }
+  const size_t count = end - begin;
+  if (grain == 0) {
+    grain = default_grain(count, pool.size());
+  }
+  if (pool.size() == 1 || count < 2 * grain) {
+    T result = identity;
+    for (size_t i = begin; i < end; i++) {
+      result = combine(result, map(i));
+    }
+    return result;
+  }
+
+  struct alignas(kCacheLineSize) partial {
+    T value;
+  };
+  const size_t participants = std::min(pool.size(), count / grain);
+  std::vector<partial> partials(participants, partial {identity});
+  chunk_scheduler scheduler {begin, end, grain, participants};
+  pool.run(participants, [&](size_t index) {
+    T local = identity;
+    size_t chunk_begin;
+    size_t chunk_end;
+    while (scheduler.claim(chunk_begin, chunk_end)) {
+      for (size_t i = chunk_begin; i < chunk_end; i++) {
+        local = combine(local, map(i));
+      }
+    }
+    partials[index].value = local;
+  });
+  T result = identity;
+  for (const partial& p : partials) {
+    result = combine(result, p.value);
+  }
+  return result;
+}
+
+// The same over the elements of a random access range, map is called with each element
+//   double sum = parallel_reduce(v, 0, 0.0, [](double x) { return x * x; }, std::plus<>{});
+template <std::ranges::random_access_range R, typename T, typename Map, typename Combine>
+requires std::ranges::sized_range<R>
+T parallel_reduce(R&& range, size_t grain, T identity, Map&& map, Combine&& combine,
+                  thread_pool& pool = thread_pool::global()) {
+  auto first = std::ranges::begin(range);
+  return parallel_reduce(0, size_t(std::ranges::size(range)), grain, std::move(identity),
+                         [&](size_t i) -> decltype(auto) { return map(first[i]); }, combine, pool);
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "poly_value.h"
+
+/**
+ * 1. Copy, move and the heap fallback
+ * 2. Creating and iterating 10M mixed objects: poly_value vs std::unique_ptr
+ */
+
+// The same shape as BaseCls/DerivedCls in class_inheritance.h: a base class with virtual methods, a derived class that adds state.
+// The methods return a value instead of printing, so that the benchmark measures the calls.
+class PolyBase {
+  public:
+    // Only the std::unique_ptr<PolyBase> baseline needs this, poly_value destroys objects through their own type
+    virtual ~PolyBase() = default;
+    virtual int implementation() const { return 1; }
+};
+
+class PolyDerived : public PolyBase {
+  public:
+    explicit PolyDerived(int value) : value_(value) {}
+    int implementation() const override { return value_; }
+  private:
+    int value_;
+};
+
+// Too big for the default buffer, so it is stored on the heap
+class PolyLarge : public PolyBase {
+  public:
+    explicit PolyLarge(int value) { values_[0] = value; }
+    int implementation() const override { return values_[0]; }
+  private:
+    int values_[64] {};
+};
+
+// Counts live objects, to check that every object is destroyed exactly once
+class PolyCounted : public PolyBase {
+  public:
+    static inline int alive {0};
+    PolyCounted() { alive++; }
+    PolyCounted(const PolyCounted&) { alive++; }
+    PolyCounted(PolyCounted&&) noexcept { alive++; }
+    ~PolyCounted() { alive--; }
+};
+
+// Owns a resource, so it can only be stored in a move_only_poly_value
+class PolyUnique : public PolyBase {
+  public:
+    explicit PolyUnique(int value) : value_(std::make_unique<int>(value)) {}
+    int implementation() const override { return *value_; }
+  private:
+    std::unique_ptr<int> value_;
+};
+
+// =================================================================
+// 1. Copy, move and the heap fallback
+// =================================================================
+void test_poly_value() {
+  using value = poly_value<PolyBase>;
+  static_assert(value::stored_inline<PolyDerived>);
+  static_assert(!value::stored_inline<PolyLarge>);
+
+  value a {PolyDerived{7}};
+  value b {std::in_place_type<PolyLarge>, 9};
+  assert(a->implementation() == 7);
+  assert(b->implementation() == 9);
+
+  value c {a};
+  value d {std::move(b)};
+  assert(c->implementation() == 7);
+  assert(d->implementation() == 9);
+  assert(!b);
+
+  c = d;  // inline <- heap
+  d = a;  // heap <- inline
+  assert(c->implementation() == 9);
+  assert(d->implementation() == 7);
+
+  {
+    std::vector<value> values;
+    for (int i = 0; i < 100; i++) {
+      values.emplace_back(PolyCounted{});
+    }
+    std::vector<value> copies {values};
+    assert(PolyCounted::alive == 200);
+  }
+  assert(PolyCounted::alive == 0);
+
+  // A type that can't be copied is rejected at compile time, not when the poly_value is copied
+  static_assert(!std::is_constructible_v<value, PolyUnique> && std::is_copy_constructible_v<value>);
+  using unique = move_only_poly_value<PolyBase>;
+  static_assert(std::is_constructible_v<unique, PolyUnique> && std::is_constructible_v<unique, PolyDerived>);
+  static_assert(!std::is_copy_constructible_v<unique> && !std::is_copy_assignable_v<unique>);
+  static_assert(std::is_nothrow_move_constructible_v<unique> && std::is_nothrow_move_assignable_v<unique>);
+  unique e {PolyUnique{3}};
+  unique f {std::in_place_type<PolyLarge>, 4};
+  e = std::move(f);
+  assert(e->implementation() == 4 && !f);
+  std::vector<unique> owners;
+  owners.emplace_back(PolyUnique{5});
+  owners.emplace_back(std::move(e));
+  assert(owners[0]->implementation() == 5 && owners[1]->implementation() == 4);
+}
+
+// =================================================================
+// 2. Creating and iterating 10M mixed objects: poly_value vs std::unique_ptr
+// =================================================================
+// Both containers get the same random sequence of PolyBase and PolyDerived objects. The buffer is sized for
+// PolyDerived (a vptr and an int), which keeps each element at 32 bytes.
+// Note that a fresh heap hands out the unique_ptr objects almost sequentially, which flatters the iteration of the
+// baseline; in a long-running process the objects are scattered and every element access is likely a cache miss.
+void benchmark_poly_value(size_t count = 10'000'000) {
+  std::mt19937 rng {42};
+  std::vector<bool> derived(count);
+  for (size_t i = 0; i < count; i++) {
+    derived[i] = rng() % 2 == 0;
+  }
+  auto seconds_since = [](auto start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::unique_ptr<PolyBase>> pointers;
+  pointers.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (derived[i]) {
+      pointers.push_back(std::make_unique<PolyDerived>(int(i)));
+    } else {
+      pointers.push_back(std::make_unique<PolyBase>());
+    }
+  }
+  double pointers_create = seconds_since(start);
+
+  start = std::chrono::steady_clock::now();
+  std::vector<poly_value<PolyBase, 16>> values;
+  values.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (derived[i]) {
+      values.emplace_back(std::in_place_type<PolyDerived>, int(i));
+    } else {
+      values.emplace_back(std::in_place_type<PolyBase>);
+    }
+  }
+  double values_create = seconds_since(start);
+
+  // Iterated a few times, the best round is reported
+  auto iterate = [&](const auto& container, long long& sum) {
+    double best {1e9};
+    for (int round = 0; round < 3; round++) {
+      auto begin = std::chrono::steady_clock::now();
+      sum = 0;
+      for (const auto& element : container) {
+        sum += element->implementation();
+      }
+      best = std::min(best, seconds_since(begin));
+    }
+    return best;
+  };
+  long long pointers_sum {0};
+  long long values_sum {0};
+  double pointers_iterate = iterate(pointers, pointers_sum);
+  double values_iterate = iterate(values, values_sum);
+  assert(pointers_sum == values_sum);
+
+  std::cout << count << " objects, sizeof(poly_value<PolyBase, 16>) = " << sizeof(poly_value<PolyBase, 16>) << std::endl
+            << "vector<unique_ptr<PolyBase>>: create " << pointers_create << " s, iterate " << pointers_iterate << " s"
+            << std::endl
+            << "vector<poly_value<PolyBase, 16>>: create " << values_create << " s, iterate " << values_iterate << " s"
+            << std::endl;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 1. Why `BaseCls* b = &d` turns into a heap allocation per object
+ * 2. A hand-built vtable for the lifetime operations
+ * 3. poly_value<Interface, BufferSize, Copyable>: inline storage with a heap fallback
+ */
+
+// =================================================================
+// 1. Why `BaseCls* b = &d` turns into a heap allocation per object
+// =================================================================
+// Polymorphism needs a pointer or a reference (see class_inheritance.h), and objects of different derived classes have
+// different sizes, so a container of them ends up as std::vector<std::unique_ptr<BaseCls>>: one heap allocation per
+// object, and every element access is a pointer chase to wherever the allocator put that object.
+// poly_value stores the derived object inside itself when it fits into a fixed buffer, so a std::vector<poly_value<...>>
+// is one contiguous allocation, and it still behaves like a value: it can be copied and moved.
+
+// =================================================================
+// 2. A hand-built vtable for the lifetime operations
+// =================================================================
+// Only the lifetime operations go through the hand-built table, not the methods of Interface: a table of methods would
+// need a list of Interface's virtual functions, which C++ can't enumerate, and it would be one more indirection than
+// the object's own vptr, which already lives in the buffer right next to the rest of the poly_value. So a method call
+// goes through the cached Interface* and the C++ vtable, exactly like a call through a BaseCls*.
+// What the C++ vtable can't do for us is copying, moving and destroying the object without knowing its type (BaseCls
+// doesn't even have a virtual destructor), so poly_value keeps a pointer to a small table of functions for that, one
+// table per stored type, built at compile time.
+template <typename Interface>
+struct poly_vtable {
+  void (*copy)(const void* src, void* dst);
+  void (*move)(void* src, void* dst) noexcept; // move-constructs dst from src, then destroys src
+  void (*destroy)(void* storage) noexcept;
+  Interface* (*get)(void* storage) noexcept;
+};
+
+// =================================================================
+// 3. poly_value<Interface, BufferSize, Copyable>: inline storage with a heap fallback
+// =================================================================
+// A type is stored inline if it fits into the buffer and can be moved without throwing (a move that throws halfway
+// would leave us with no valid object), otherwise the buffer holds a pointer to a heap-allocated object.
+// Whether the stored object can be copied is only known when it is stored, so it is part of the type: a copyable
+// poly_value only accepts copy-constructible types, and move_only_poly_value accepts anything but can't be copied.
+template <typename Interface, size_t BufferSize = 4 * sizeof(void*), bool Copyable = true>
+class poly_value {
+  static_assert(BufferSize >= sizeof(void*), "the buffer must be able to hold the heap pointer");
+
+  public:
+    template <typename T>
+    static constexpr bool stored_inline = sizeof(T) <= BufferSize && alignof(T) <= alignof(std::max_align_t) &&
+                                          std::is_nothrow_move_constructible_v<T>;
+
+    template <typename T, typename... Args>
+    requires std::is_base_of_v<Interface, T> && (!Copyable || std::is_copy_constructible_v<T>)
+    explicit poly_value(std::in_place_type_t<T>, Args&&... args) {
+      if constexpr (stored_inline<T>) {
+        ::new (static_cast<void*>(storage_)) T(std::forward<Args>(args)...);
+      } else {
+        *reinterpret_cast<T**>(storage_) = new T(std::forward<Args>(args)...);
+      }
+      vtable_ = &vtable_for<T>;
+      ptr_ = vtable_->get(storage_);
+    }
+
+    template <typename T>
+    requires std::is_base_of_v<Interface, std::remove_cvref_t<T>> &&
+             (!Copyable || std::is_copy_constructible_v<std::remove_cvref_t<T>>)
+    poly_value(T&& value) : poly_value(std::in_place_type<std::remove_cvref_t<T>>, std::forward<T>(value)) {}
+
+    poly_value(const poly_value& other) requires Copyable : vtable_(other.vtable_) {
+      if (vtable_ != nullptr) {
+        vtable_->copy(other.storage_, storage_);
+        ptr_ = vtable_->get(storage_);
+      }
+    }
+
+    // A moved-from poly_value is empty. Moving a heap-stored object only moves the pointer.
+    poly_value(poly_value&& other) noexcept : vtable_(std::exchange(other.vtable_, nullptr)) {
+      if (vtable_ != nullptr) {
+        vtable_->move(other.storage_, storage_);
+        ptr_ = vtable_->get(storage_);
+        other.ptr_ = nullptr;
+      }
+    }
+
+    poly_value& operator=(const poly_value& other) requires Copyable {
+      if (this != &other) {
+        poly_value copy {other};
+        *this = std::move(copy);
+      }
+      return *this;
+    }
+
+    poly_value& operator=(poly_value&& other) noexcept {
+      if (this != &other) {
+        reset();
+        vtable_ = std::exchange(other.vtable_, nullptr);
+        if (vtable_ != nullptr) {
+          vtable_->move(other.storage_, storage_);
+          ptr_ = vtable_->get(storage_);
+          other.ptr_ = nullptr;
+        }
+      }
+      return *this;
+    }
+
+    ~poly_value() {
+      reset();
+    }
+
+    Interface* operator->() { return ptr_; }
+    const Interface* operator->() const { return ptr_; }
+    Interface& operator*() { return *ptr_; }
+    const Interface& operator*() const { return *ptr_; }
+    explicit operator bool() const { return ptr_ != nullptr; }
+
+  private:
+    void reset() {
+      if (vtable_ != nullptr) {
+        vtable_->destroy(storage_);
+        vtable_ = nullptr;
+        ptr_ = nullptr;
+      }
+    }
+
+    template <typename T>
+    static T* object(void* storage) {
+      if constexpr (stored_inline<T>) {
+        return std::launder(reinterpret_cast<T*>(storage));
+      } else {
+        return *reinterpret_cast<T**>(storage);
+      }
+    }
+
+    template <typename T>
+    static constexpr poly_vtable<Interface> vtable_for {
+      // copy, only for a copyable poly_value, which only stores copy-constructible types
+      [] {
+        if constexpr (Copyable) {
+          return +[](const void* src, void* dst) {
+            const T& from = *object<T>(const_cast<void*>(src));
+            if constexpr (stored_inline<T>) {
+              ::new (dst) T(from);
+            } else {
+              *static_cast<T**>(dst) = new T(from);
+            }
+          };
+        } else {
+          return static_cast<void (*)(const void*, void*)>(nullptr);
+        }
+      }(),
+      // move
+      [](void* src, void* dst) noexcept {
+        if constexpr (stored_inline<T>) {
+          T* from = object<T>(src);
+          ::new (dst) T(std::move(*from));
+          from->~T();
+        } else {
+          *static_cast<T**>(dst) = std::exchange(*static_cast<T**>(src), nullptr);
+        }
+      },
+      // destroy
+      [](void* storage) noexcept {
+        if constexpr (stored_inline<T>) {
+          object<T>(storage)->~T();
+        } else {
+          delete object<T>(storage);
+        }
+      },
+      // get
+      [](void* storage) noexcept -> Interface* {
+        return object<T>(storage);
+      },
+    };
+
+    alignas(std::max_align_t) unsigned char storage_[BufferSize];
+    const poly_vtable<Interface>* vtable_ {nullptr};
+    // Cached result of vtable_->get(storage_), so a call through operator-> costs no more than a call through a Base*
+    Interface* ptr_ {nullptr};
+};
+
+template <typename Interface, size_t BufferSize = 4 * sizeof(void*)>
+using move_only_poly_value = poly_value<Interface, BufferSize, false>;
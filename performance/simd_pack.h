@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * 1. A thin wrapper around a SIMD register of doubles
+ * 2. Compile-time unrolled loops over a fixed length
+ */
+
+namespace simd {
+
+// =================================================================
+// 1. A thin wrapper around a SIMD register of doubles
+// =================================================================
+// The widest instruction set enabled at compile time (-mavx2, -mavx512f or -march=native) is picked here,
+// so the kernels below are written once against `double_pack` and compiled to the best available instructions.
+// If neither AVX2 nor AVX-512 is enabled, `double_pack` falls back to a single scalar double.
+#if defined(__AVX512F__)
+struct double_pack {
+  static constexpr size_t width = 8;
+  __m512d v;
+
+  static double_pack zero() { return {_mm512_setzero_pd()}; }
+  static double_pack set1(double x) { return {_mm512_set1_pd(x)}; }
+  static double_pack load(const double* p) { return {_mm512_loadu_pd(p)}; }
+  void store(double* p) const { _mm512_storeu_pd(p, v); }
+
+  friend double_pack operator+(double_pack a, double_pack b) { return {_mm512_add_pd(a.v, b.v)}; }
+  friend double_pack operator-(double_pack a, double_pack b) { return {_mm512_sub_pd(a.v, b.v)}; }
+  friend double_pack operator*(double_pack a, double_pack b) { return {_mm512_mul_pd(a.v, b.v)}; }
+  friend double_pack operator/(double_pack a, double_pack b) { return {_mm512_div_pd(a.v, b.v)}; }
+  // a * b + c
+  static double_pack fma(double_pack a, double_pack b, double_pack c) { return {_mm512_fmadd_pd(a.v, b.v, c.v)}; }
+  // The masked forms with every lane selected: GCC 12's _mm512_min_pd and _mm512_max_pd pass an undefined register
+  // as the merge source and warn (-Wuninitialized) like the reductions below. Both compile to a plain vminpd/vmaxpd.
+  static double_pack min(double_pack a, double_pack b) { return {_mm512_mask_min_pd(a.v, 0xFF, a.v, b.v)}; }
+  static double_pack max(double_pack a, double_pack b) { return {_mm512_mask_max_pd(a.v, 0xFF, a.v, b.v)}; }
+
+  // Reduced through memory: GCC 12's _mm512_reduce_*_pd read an undefined register too
+  double hsum() const {
+    alignas(64) double lanes[width];
+    store(lanes);
+    return ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+  }
+  double hmin() const {
+    alignas(64) double lanes[width];
+    store(lanes);
+    return std::min({lanes[0], lanes[1], lanes[2], lanes[3], lanes[4], lanes[5], lanes[6], lanes[7]});
+  }
+  double hmax() const {
+    alignas(64) double lanes[width];
+    store(lanes);
+    return std::max({lanes[0], lanes[1], lanes[2], lanes[3], lanes[4], lanes[5], lanes[6], lanes[7]});
+  }
+};
+#elif defined(__AVX2__)
+struct double_pack {
+  static constexpr size_t width = 4;
+  __m256d v;
+
+  static double_pack zero() { return {_mm256_setzero_pd()}; }
+  static double_pack set1(double x) { return {_mm256_set1_pd(x)}; }
+  static double_pack load(const double* p) { return {_mm256_loadu_pd(p)}; }
+  void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+  friend double_pack operator+(double_pack a, double_pack b) { return {_mm256_add_pd(a.v, b.v)}; }
+  friend double_pack operator-(double_pack a, double_pack b) { return {_mm256_sub_pd(a.v, b.v)}; }
+  friend double_pack operator*(double_pack a, double_pack b) { return {_mm256_mul_pd(a.v, b.v)}; }
+  friend double_pack operator/(double_pack a, double_pack b) { return {_mm256_div_pd(a.v, b.v)}; }
+  // a * b + c, AVX2 machines don't necessarily have FMA, so we only use it when it is enabled
+  static double_pack fma(double_pack a, double_pack b, double_pack c) {
+#if defined(__FMA__)
+    return {_mm256_fmadd_pd(a.v, b.v, c.v)};
+#else
+    return a * b + c;
+#endif
+  }
+  static double_pack min(double_pack a, double_pack b) { return {_mm256_min_pd(a.v, b.v)}; }
+  static double_pack max(double_pack a, double_pack b) { return {_mm256_max_pd(a.v, b.v)}; }
+
+  // Fold the upper 128 bits onto the lower 128 bits, then fold the two remaining lanes.
+  double hsum() const {
+    __m128d x = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x)));
+  }
+  double hmin() const {
+    __m128d x = _mm_min_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_min_sd(x, _mm_unpackhi_pd(x, x)));
+  }
+  double hmax() const {
+    __m128d x = _mm_max_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_max_sd(x, _mm_unpackhi_pd(x, x)));
+  }
+};
+#else
+struct double_pack {
+  static constexpr size_t width = 1;
+  double v;
+
+  static double_pack zero() { return {0.0}; }
+  static double_pack set1(double x) { return {x}; }
+  static double_pack load(const double* p) { return {*p}; }
+  void store(double* p) const { *p = v; }
+
+  friend double_pack operator+(double_pack a, double_pack b) { return {a.v + b.v}; }
+  friend double_pack operator-(double_pack a, double_pack b) { return {a.v - b.v}; }
+  friend double_pack operator*(double_pack a, double_pack b) { return {a.v * b.v}; }
+  friend double_pack operator/(double_pack a, double_pack b) { return {a.v / b.v}; }
+  static double_pack fma(double_pack a, double_pack b, double_pack c) { return {a.v * b.v + c.v}; }
+  // Same operand order as the min/max instructions: the second operand is returned if either one is NaN
+  static double_pack min(double_pack a, double_pack b) { return {a.v < b.v ? a.v : b.v}; }
+  static double_pack max(double_pack a, double_pack b) { return {a.v > b.v ? a.v : b.v}; }
+
+  double hsum() const { return v; }
+  double hmin() const { return v; }
+  double hmax() const { return v; }
+};
+#endif
+
+// =================================================================
+// 2. Compile-time unrolled loops over a fixed length
+// =================================================================
+// `unrolled_for<N, Width>(fn)` calls `fn(offset, lane)` for every full pack of `Width` elements in [0, N).
+// The body is unrolled `Unroll` times, and `lane` (always < Unroll) lets the caller keep one independent
+// accumulator per unrolled copy, which hides the latency of the add/fma instructions.
+// The packs that don't fill a whole unrolled block are unrolled completely at compile time, so for small N there is no loop at all.
+template <size_t N, size_t Width, size_t Unroll = 4, typename Fn>
+inline void unrolled_for(Fn&& fn) {
+  constexpr size_t block = Width * Unroll;
+  constexpr size_t blocks_end = N / block * block;
+  constexpr size_t rest = (N - blocks_end) / Width;
+  for (size_t i = 0; i < blocks_end; i += block) {
+    [&]<size_t... lane>(std::index_sequence<lane...>) {
+      (fn(i + lane * Width, lane), ...);
+    }(std::make_index_sequence<Unroll>{});
+  }
+  [&]<size_t... lane>(std::index_sequence<lane...>) {
+    (fn(blocks_end + lane * Width, lane), ...);
+  }(std::make_index_sequence<rest>{});
+}
+
+// `unrolled_tail<N, Width>(fn)` calls `fn(index)` for the N % Width trailing elements that don't fill a whole pack.
+template <size_t N, size_t Width, typename Fn>
+inline void unrolled_tail(Fn&& fn) {
+  constexpr size_t tail_begin = N / Width * Width;
+  [&]<size_t... i>(std::index_sequence<i...>) {
+    (fn(tail_begin + i), ...);
+  }(std::make_index_sequence<N - tail_begin>{});
+}
+
+} // namespace simd
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "column_store.h"
+#include "common.h"
+#include "soa_vector.h"
+
+/**
+ * 1. Rows, columns, iterators and growth
+ * 2. Per-field sum and filter against std::vector<std::tuple<...>>
+ */
+
+// =================================================================
+// 1. Rows, columns, iterators and growth
+// =================================================================
+void test_soa_vector() {
+  soa_vector<int, double, std::string> v;
+  assert(v.empty() && v.begin() == v.end() && v.column<0>().empty());
+  for (int i = 0; i < 100; i++) {
+    v.emplace_back(i, i * 0.5, std::to_string(i));
+  }
+  assert(v.size() == 100 && v.capacity() >= 100);
+
+  // Every column is aligned, for any element type
+  assert(reinterpret_cast<uintptr_t>(v.column<0>().data()) % 64 == 0);
+  assert(reinterpret_cast<uintptr_t>(v.column<1>().data()) % 64 == 0);
+  assert(reinterpret_cast<uintptr_t>(v.column<2>().data()) % 64 == 0);
+  assert(v.column<1>()[10] == 5.0 && v.column<2>()[99] == "99");
+
+  // Structured bindings to a row are references into the columns, as `auto& [x, y] = p1` in std_pair_and_tuple.cc
+  auto [number, half, name] = v[3];
+  number = 30;
+  name += "!";
+  assert(std::get<0>(v[3]) == 30 && v.column<2>()[3] == "3!" && half == 1.5);
+  std::get<1>(v[3]) = 2.0;
+  assert(half == 2.0);
+
+  // The zip iterator, with standard algorithms
+  int visited {0};
+  for (auto [i, d, s] : v) {
+    assert(s == (visited == 3 ? "3!" : std::to_string(i)));
+    visited++;
+  }
+  assert(visited == 100);
+  // 51 even numbers, since 3 became 30
+  assert(std::count_if(v.begin(), v.end(), [](const auto& row) { return std::get<0>(row) % 2 == 0; }) == 51);
+  soa_vector<int, double, std::string>::const_iterator it = v.begin();
+  it += 10;
+  assert(std::get<1>(*it) == 5.0 && it - v.begin() == 10 && it[5] == v[15] && v.end() - it == 90);
+  assert(it > v.begin() && --it == v.begin() + 9);
+
+  // Copies are deep, and the copy constructor reserves exactly the size, so the next push_back grows the buffers.
+  // Pushing a row of the same vector then works, because the row is copied before the old buffers are released.
+  soa_vector<int, double, std::string> copy = v;
+  assert(copy.size() == copy.capacity() && copy[3] == v[3] && copy.column<2>().data() != v.column<2>().data());
+  copy.push_back(copy[3]);
+  assert(copy.size() == 101 && std::get<2>(copy[100]) == "3!" && copy.capacity() == 200);
+  copy.push_back({7, 7.5, std::string(100, 'x')});
+  copy.pop_back();
+  copy.pop_back();
+  copy.resize(120);
+  assert(copy.size() == 120 && copy[110] == std::tuple(0, 0.0, std::string()));
+  copy.resize(5);
+  assert(copy.size() == 5 && std::get<2>(copy[4]) == "4");
+
+  soa_vector<int, double, std::string> moved = std::move(copy);
+  assert(moved.size() == 5 && copy.empty() && copy.capacity() == 0);
+  copy = moved;
+  moved.clear();
+  assert(copy.size() == 5 && moved.empty() && moved.capacity() >= 5);
+
+  // Over-aligned elements get their own alignment
+  struct alignas(128) wide {
+    float x[32];
+  };
+  soa_vector<char, wide> aligned;
+  aligned.resize(3);
+  assert(reinterpret_cast<uintptr_t>(aligned.column<1>().data()) % 128 == 0);
+}
+
+// =================================================================
+// 2. Per-field sum and filter against std::vector<std::tuple<...>>
+// =================================================================
+// The same loop for both layouts, only the way a field is read differs: four independent accumulators, so the
+// additions of a double field don't wait for each other
+template <typename T, typename Field>
+T sum_field(size_t n, Field field) {
+  T acc[4] {};
+  size_t i {0};
+  for (; i + 4 <= n; i += 4) {
+    for (size_t lane = 0; lane < 4; lane++) {
+      acc[lane] += field(i + lane);
+    }
+  }
+  for (; i < n; i++) {
+    acc[0] += field(i);
+  }
+  return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+// Orders: (quantity, price, customer), 24 bytes per tuple with padding, 16 bytes per row as columns
+void benchmark_soa_vector(size_t n = 50'000'000) {
+  using order = std::tuple<int, double, int>;
+  auto make_order = [](size_t i) {
+    const uint64_t h = (i + 1) * 0x9E3779B97F4A7C15ull;
+    return order {int((h >> 40) % 100), double((h >> 20) % 10'000) * 0.25, int(h % 1'000'000)};
+  };
+  std::vector<order> tuples(n);
+  soa_vector<int, double, int> columns;
+  columns.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    tuples[i] = make_order(i);
+    columns.push_back(tuples[i]);
+  }
+  std::cout << "sizeof(std::tuple<int, double, int>) " << sizeof(order) << ", " << n / 1'000'000 << "M rows"
+            << std::endl;
+
+  volatile double sink {0.0};
+  columnar::selection selected;
+  auto compare = [&](const char* query, auto&& on_tuples, auto&& on_columns) {
+    const double t = best_seconds(on_tuples);
+    const double c = best_seconds(on_columns);
+    std::cout << query << ": vector<tuple> " << t * 1e3 << " ms, soa_vector " << c * 1e3 << " ms, " << t / c << "x"
+              << std::endl;
+  };
+
+  const std::span<const int> quantities = columns.column<0>();
+  const std::span<const double> prices = columns.column<1>();
+  compare("sum(quantity)", [&] { sink = double(sum_field<int64_t>(n, [&](size_t i) {
+    return std::get<0>(tuples[i]);
+  })); }, [&] { sink = double(sum_field<int64_t>(n, [&](size_t i) { return quantities[i]; })); });
+  compare("sum(price)", [&] { sink = sum_field<double>(n, [&](size_t i) {
+    return std::get<1>(tuples[i]);
+  }); }, [&] { sink = sum_field<double>(n, [&](size_t i) { return prices[i]; }); });
+
+  // Branch-free filter into a selection vector (see column_store.h), the same code for both layouts
+  auto large = [](int quantity) { return quantity >= 90; };
+  compare("filter(quantity >= 90)", [&] {
+    uint32_t* rows = selected.prepare(n);
+    size_t count {0};
+    for (size_t i = 0; i < n; i++) {
+      rows[count] = uint32_t(i);
+      count += large(std::get<0>(tuples[i])) ? 1 : 0;
+    }
+    selected.finish(count);
+    sink = double(count);
+  }, [&] {
+    columnar::filter(quantities, large, selected);
+    sink = double(selected.size());
+  });
+  compare("filter(quantity >= 90) + sum(price)", [&] {
+    double total {0.0};
+    for (const auto& [quantity, price, customer] : tuples) {
+      total += large(quantity) ? price : 0.0;
+    }
+    sink = total;
+  }, [&] {
+    columnar::filter(quantities, large, selected);
+    sink = columnar::sum(prices, selected);
+  });
+}
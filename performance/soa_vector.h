@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 1. Array of tuples or tuple of arrays
+ * 2. Aligned column buffers
+ * 3. Rows as tuples of references
+ * 4. The zip iterator
+ * 5. Growth
+ */
+
+// =================================================================
+// 1. Array of tuples or tuple of arrays
+// =================================================================
+// A std::vector<std::tuple<int, double, int>> (see std_pair_and_tuple.cc) stores the tuples one after the other,
+// with padding between the fields: 24 bytes per row, of which 16 are data. Summing one field still reads every byte,
+// and the loop can't be vectorized because the values of one field are 24 bytes apart.
+// soa_vector<int, double, int> stores the same rows as three arrays, one per tuple element ("struct of arrays"):
+// summing one field reads only that array, and each array starts on a cache line, so a SIMD kernel gets aligned,
+// contiguous data through column<I>(). Code that works on whole rows still can, through tuples of references.
+// columnar::employee_store in column_store.h is the hand-written version of this for one record type.
+
+template <typename... Ts>
+requires (sizeof...(Ts) > 0 && (std::is_nothrow_move_constructible_v<Ts> && ...))
+class soa_vector {
+  public:
+    // =================================================================
+    // 2. Aligned column buffers
+    // =================================================================
+    // Every column starts on a cache line, which is also the alignment of the widest SIMD loads (AVX-512)
+    static constexpr size_t kAlignment = 64;
+
+    template <size_t I>
+    using element_type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    soa_vector() = default;
+    soa_vector(const soa_vector& other) {
+      reserve(other.size());
+      for (size_t i = 0; i < other.size(); i++) {
+        push_back(other[i]);
+      }
+    }
+    soa_vector(soa_vector&& other) noexcept
+        : columns_(std::exchange(other.columns_, {})), size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {}
+    soa_vector& operator=(soa_vector other) noexcept {
+      swap(other);
+      return *this;
+    }
+    ~soa_vector() {
+      clear();
+      deallocate(columns_);
+    }
+
+    void swap(soa_vector& other) noexcept {
+      std::swap(columns_, other.columns_);
+      std::swap(size_, other.size_);
+      std::swap(capacity_, other.capacity_);
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    // One contiguous, aligned array per tuple element, e.g. for the SIMD kernels of minmax.h
+    template <size_t I>
+    std::span<element_type<I>> column() {
+      return {std::get<I>(columns_), size_};
+    }
+    template <size_t I>
+    std::span<const element_type<I>> column() const {
+      return {std::get<I>(columns_), size_};
+    }
+
+    // =================================================================
+    // 3. Rows as tuples of references
+    // =================================================================
+    // v[i] returns a std::tuple<Ts&...> by value, so structured bindings take it by value or by forwarding reference:
+    // `auto [x, y] = v[i]` copies the tuple, whose elements are references into the columns, so x and y refer to the
+    // elements and `x = 10` writes into v. `auto&& [x, y] = v[i]` is the same, and `auto& [x, y] = v[i]` doesn't
+    // compile, because a temporary can't be bound to an lvalue reference.
+    using value_type = std::tuple<Ts...>;
+    using reference = std::tuple<Ts&...>;
+    using const_reference = std::tuple<const Ts&...>;
+
+    reference operator[](size_t i) {
+      assert(i < size_);
+      return std::apply([i](Ts*... column) { return reference {column[i]...}; }, columns_);
+    }
+    const_reference operator[](size_t i) const {
+      assert(i < size_);
+      return std::apply([i](Ts*... column) { return const_reference {column[i]...}; }, columns_);
+    }
+
+    // =================================================================
+    // 4. The zip iterator
+    // =================================================================
+    // Walks all the columns together, and dereferences to the same tuples of references as operator[]. Because that is
+    // a proxy and not a real reference, it is random access for the C++20 iterator concepts but only an input iterator
+    // for the classic algorithms, like std::views::zip of C++23: range-for, std::for_each, std::count_if or
+    // std::accumulate work, std::sort doesn't (sort a permutation of the indices instead).
+    template <bool Const>
+    class basic_iterator {
+      public:
+        using iterator_concept = std::random_access_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::tuple<Ts...>;
+        using reference = std::conditional_t<Const, std::tuple<const Ts&...>, std::tuple<Ts&...>>;
+        using difference_type = std::ptrdiff_t;
+
+        basic_iterator() = default;
+        basic_iterator(const std::tuple<Ts*...>& columns, difference_type index) : columns_(columns), index_(index) {}
+        // iterator -> const_iterator
+        template <bool OtherConst>
+        requires (Const && !OtherConst)
+        basic_iterator(const basic_iterator<OtherConst>& other) : columns_(other.columns_), index_(other.index_) {}
+
+        reference operator*() const {
+          return std::apply([this](Ts*... column) { return reference {column[index_]...}; }, columns_);
+        }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        basic_iterator& operator++() { ++index_; return *this; }
+        basic_iterator operator++(int) { basic_iterator old = *this; ++index_; return old; }
+        basic_iterator& operator--() { --index_; return *this; }
+        basic_iterator operator--(int) { basic_iterator old = *this; --index_; return old; }
+        basic_iterator& operator+=(difference_type n) { index_ += n; return *this; }
+        basic_iterator& operator-=(difference_type n) { index_ -= n; return *this; }
+        friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+        friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+        friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const basic_iterator& a, const basic_iterator& b) {
+          return a.index_ - b.index_;
+        }
+        // Only iterators into the same soa_vector are compared, so the index is enough
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) { return a.index_ == b.index_; }
+        friend auto operator<=>(const basic_iterator& a, const basic_iterator& b) { return a.index_ <=> b.index_; }
+
+      private:
+        friend class basic_iterator<!Const>;
+        std::tuple<Ts*...> columns_ {};
+        difference_type index_ {0};
+    };
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    iterator begin() { return {columns_, 0}; }
+    iterator end() { return {columns_, std::ptrdiff_t(size_)}; }
+    const_iterator begin() const { return {columns_, 0}; }
+    const_iterator end() const { return {columns_, std::ptrdiff_t(size_)}; }
+
+    // =================================================================
+    // 5. Growth
+    // =================================================================
+    // Like std::vector: the capacity doubles, and the elements are moved into the new buffers (which is why the
+    // element types must be nothrow move constructible, a throwing move would leave the columns half moved).
+    void reserve(size_t capacity) {
+      if (capacity <= capacity_) {
+        return;
+      }
+      std::tuple<Ts*...> grown = allocate(capacity);
+      move_columns(columns_, grown, size_, std::index_sequence_for<Ts...> {});
+      deallocate(columns_);
+      columns_ = grown;
+      capacity_ = capacity;
+    }
+
+    template <typename... Args>
+    requires (sizeof...(Args) == sizeof...(Ts))
+    reference emplace_back(Args&&... values) {
+      if (size_ < capacity_) {
+        construct_row<0>(columns_, size_, std::forward_as_tuple(std::forward<Args>(values)...));
+        return (*this)[size_++];
+      }
+      // The new row is constructed in the new buffers before the old rows are moved, because the values may refer to
+      // elements of this soa_vector, like in v.push_back(v[0])
+      const size_t capacity = std::max<size_t>(2 * capacity_, 16);
+      std::tuple<Ts*...> grown = allocate(capacity);
+      try {
+        construct_row<0>(grown, size_, std::forward_as_tuple(std::forward<Args>(values)...));
+      } catch (...) {
+        deallocate(grown);
+        throw;
+      }
+      move_columns(columns_, grown, size_, std::index_sequence_for<Ts...> {});
+      deallocate(columns_);
+      columns_ = grown;
+      capacity_ = capacity;
+      return (*this)[size_++];
+    }
+    // Any tuple of matching size: a value_type, or a row of another soa_vector (or of this one), which is copied
+    template <typename Row>
+    requires (std::tuple_size_v<std::remove_cvref_t<Row>> == sizeof...(Ts))
+    void push_back(Row&& row) {
+      std::apply([this](auto&&... values) { emplace_back(std::forward<decltype(values)>(values)...); },
+                 std::forward<Row>(row));
+    }
+    // For braced lists, v.push_back({1, 2.0, "three"})
+    void push_back(value_type&& row) {
+      push_back<value_type>(std::move(row));
+    }
+
+    void pop_back() {
+      assert(size_ > 0);
+      size_--;
+      std::apply([this](Ts*... column) { (std::destroy_at(column + size_), ...); }, columns_);
+    }
+
+    // New rows are value-initialized (zero for arithmetic types)
+    void resize(size_t size) {
+      while (size_ > size) {
+        pop_back();
+      }
+      reserve(size);
+      while (size_ < size) {
+        emplace_back(Ts {}...);
+      }
+    }
+
+    void clear() {
+      std::apply([this](Ts*... column) { (std::destroy(column, column + size_), ...); }, columns_);
+      size_ = 0;
+    }
+
+  private:
+    template <typename T>
+    static T* allocate_column(size_t capacity) {
+      return static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t {std::max(kAlignment, alignof(T))}));
+    }
+    template <typename T>
+    static void deallocate_column(T* column) {
+      if (column != nullptr) {
+        ::operator delete(column, std::align_val_t {std::max(kAlignment, alignof(T))});
+      }
+    }
+
+    // All or nothing: if one column can't be allocated, the ones already allocated are freed
+    static std::tuple<Ts*...> allocate(size_t capacity) {
+      std::tuple<Ts*...> columns {};
+      try {
+        std::apply([capacity](Ts*&... column) { ((column = allocate_column<Ts>(capacity)), ...); }, columns);
+      } catch (...) {
+        deallocate(columns);
+        throw;
+      }
+      return columns;
+    }
+    static void deallocate(const std::tuple<Ts*...>& columns) {
+      std::apply([](Ts*... column) { (deallocate_column(column), ...); }, columns);
+    }
+
+    template <size_t... I>
+    static void move_columns(const std::tuple<Ts*...>& from, const std::tuple<Ts*...>& to, size_t size,
+                             std::index_sequence<I...>) {
+      ((std::uninitialized_move(std::get<I>(from), std::get<I>(from) + size, std::get<I>(to)),
+        std::destroy(std::get<I>(from), std::get<I>(from) + size)), ...);
+    }
+
+    // Constructs the I-th and following elements of a row. If a constructor throws, the elements that were already
+    // constructed are destroyed again, so a row is either complete or not there at all.
+    template <size_t I, typename Args>
+    static void construct_row(const std::tuple<Ts*...>& columns, size_t row, Args&& values) {
+      if constexpr (I < sizeof...(Ts)) {
+        element_type<I>* element = std::get<I>(columns) + row;
+        std::construct_at(element, std::get<I>(std::forward<Args>(values)));
+        try {
+          construct_row<I + 1>(columns, row, std::forward<Args>(values));
+        } catch (...) {
+          std::destroy_at(element);
+          throw;
+        }
+      }
+    }
+
+    std::tuple<Ts*...> columns_ {};
+    size_t size_ {0};
+    size_t capacity_ {0};
+};
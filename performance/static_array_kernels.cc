@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <utility>
+
+#include "../language_itself/class_template.h"
+
+/**
+ * 1. Correctness of the StaticArray<double, N> kernels against plain scalar loops
+ * 2. GFLOP/s benchmark of the kernels for N from 4 to 4096
+ *
+ * Build with -O2 -march=native (or -mavx2 -mfma / -mavx512f) to get the SIMD paths.
+ */
+
+template <size_t N>
+void fill_random(StaticArray<double, N>& arr, std::mt19937_64& rng) {
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  for (size_t i = 0; i < N; i++) {
+    arr[i] = dist(rng);
+  }
+}
+
+// =================================================================
+// 1. Correctness of the StaticArray<double, N> kernels against plain scalar loops
+// =================================================================
+// The SIMD kernels sum in a different order than a scalar loop, so the sums are compared with a relative tolerance.
+bool nearly_equal(double a, double b) {
+  return std::abs(a - b) <= 1e-12 * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+}
+
+template <size_t N>
+void check_static_array_kernels() {
+  std::mt19937_64 rng {N};
+  auto a = std::make_unique<StaticArray<double, N>>();
+  auto b = std::make_unique<StaticArray<double, N>>();
+  fill_random(*a, rng);
+  fill_random(*b, rng);
+
+  double dot {0.0};
+  double sum {0.0};
+  double min {(*a)[0]};
+  double max {(*a)[0]};
+  for (size_t i = 0; i < N; i++) {
+    dot += (*a)[i] * (*b)[i];
+    sum += (*a)[i];
+    min = std::min(min, (*a)[i]);
+    max = std::max(max, (*a)[i]);
+  }
+  assert(nearly_equal(a->dot(*b), dot));
+  assert(nearly_equal(a->sum(), sum));
+  assert(a->min() == min);
+  assert(a->max() == max);
+  assert(nearly_equal(b->norm(), std::sqrt(b->dot(*b))));
+
+  auto c = std::make_unique<StaticArray<double, N>>(*a);
+  c->axpy(0.5, *b);
+  for (size_t i = 0; i < N; i++) {
+    assert(nearly_equal((*c)[i], (*a)[i] + 0.5 * (*b)[i]));
+  }
+  *c = *a;
+  *c += *b;
+  *c *= *b;
+  *c -= *a;
+  *c *= 2.0;
+  for (size_t i = 0; i < N; i++) {
+    assert(nearly_equal((*c)[i], (((*a)[i] + (*b)[i]) * (*b)[i] - (*a)[i]) * 2.0));
+  }
+}
+
+void test_static_array_kernels() {
+  // Lengths that hit the fully-unrolled path, the looped path and every possible scalar tail.
+  check_static_array_kernels<1>();
+  check_static_array_kernels<3>();
+  check_static_array_kernels<4>();
+  check_static_array_kernels<7>();
+  check_static_array_kernels<8>();
+  check_static_array_kernels<13>();
+  check_static_array_kernels<33>();
+  check_static_array_kernels<100>();
+  check_static_array_kernels<1021>();
+  check_static_array_kernels<4096>();
+}
+
+// =================================================================
+// 2. GFLOP/s benchmark of the kernels for N from 4 to 4096
+// =================================================================
+// Each kernel is repeated until roughly the same number of flops is done for every N, so small arrays measure
+// call overhead and unrolling, while large arrays measure L1/L2 bandwidth.
+template <size_t N, typename Fn>
+double measure_gflops(double flops_per_call, Fn&& fn) {
+  constexpr size_t kTotalElements {size_t{1} << 28};
+  constexpr size_t kRepeats {kTotalElements / N};
+  auto start = std::chrono::steady_clock::now();
+  for (size_t r = 0; r < kRepeats; r++) {
+    fn();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return flops_per_call * kRepeats / elapsed.count() / 1e9;
+}
+
+template <size_t N>
+void benchmark_static_array_kernels_for() {
+  std::mt19937_64 rng {N};
+  auto a = std::make_unique<StaticArray<double, N>>();
+  auto b = std::make_unique<StaticArray<double, N>>();
+  fill_random(*a, rng);
+  fill_random(*b, rng);
+
+  // `sink` and the asm barrier keep the compiler from hoisting the loop-invariant kernel out of the repeat loop.
+  volatile double sink {0.0};
+  double kernel_dot = measure_gflops<N>(2.0 * N, [&] {
+    asm volatile("" : : "r"(a.get()) : "memory");
+    sink = a->dot(*b);
+  });
+  double scalar_dot = measure_gflops<N>(2.0 * N, [&] {
+    asm volatile("" : : "r"(a.get()) : "memory");
+    double result {0.0};
+    for (size_t i = 0; i < N; i++) {
+      result += (*a)[i] * (*b)[i];
+    }
+    sink = result;
+  });
+  double kernel_axpy = measure_gflops<N>(2.0 * N, [&] {
+    a->axpy(1e-9, *b);
+    asm volatile("" : : "r"(a.get()) : "memory");
+  });
+  double kernel_sum = measure_gflops<N>(1.0 * N, [&] {
+    asm volatile("" : : "r"(a.get()) : "memory");
+    sink = a->sum();
+  });
+  std::cout << "N=" << N
+            << " dot=" << kernel_dot << " (scalar " << scalar_dot << ")"
+            << " axpy=" << kernel_axpy
+            << " sum=" << kernel_sum << " GFLOP/s" << std::endl;
+}
+
+void benchmark_static_array_kernels() {
+  std::cout << "SIMD width: " << simd::double_pack::width << " doubles" << std::endl;
+  [&]<size_t... shift>(std::index_sequence<shift...>) {
+    (benchmark_static_array_kernels_for<(size_t{4} << shift)>(), ...);
+  }(std::make_index_sequence<11>{});  // 4, 8, ..., 4096
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stream_transform.h"
+
+/**
+ * 1. The parallel engine produces the same bytes as a single pass, for any split
+ * 2. GB/s from 1 to N threads against the copying functors
+ */
+
+// The shape of Encryptor in function_lambda.cc: the message is taken by value and a new string is returned.
+// It XORs with the same keystream, so the comparison is about copies and threads, not about the transform.
+class CopyingEncryptor {
+  public:
+    explicit CopyingEncryptor(uint64_t key) : keystream_(key) {}
+    std::string operator()(std::string str) {
+      std::string result {str};
+      keystream_({reinterpret_cast<std::byte*>(result.data()), result.size()}, 0);
+      return result;
+    }
+  private:
+    XorKeystream keystream_;
+};
+
+// =================================================================
+// 1. The parallel engine produces the same bytes as a single pass, for any split
+// =================================================================
+void test_stream_transform() {
+  const XorKeystream keystream {0x0123456789ABCDEFull};
+  std::vector<std::byte> original(3'000'001);
+  for (size_t i = 0; i < original.size(); i++) {
+    original[i] = std::byte(i * 131 + 7);
+  }
+
+  std::vector<std::byte> reference {original};
+  keystream(reference, 0);
+  assert(reference != original);
+
+  // Odd chunk sizes and offsets exercise the byte-wise head and tail of every chunk
+  for (size_t chunk_size : {64, 1000, 4096, 256 * 1024}) {
+    std::vector<std::byte> data {original};
+    parallel_transform(std::span<std::byte>(data), keystream, 0, {.threads = 4, .chunk_size = chunk_size, .min_parallel_size = 0});
+    assert(data == reference);
+    // Applying it again restores the input
+    parallel_transform(std::span<std::byte>(data), keystream, 0, {.threads = 3, .chunk_size = chunk_size, .min_parallel_size = 0});
+    assert(data == original);
+  }
+
+  // A message that starts in the middle of the stream
+  std::vector<std::byte> tail(original.begin() + 12345, original.end());
+  keystream(tail, 12345);
+  assert(std::equal(tail.begin(), tail.end(), reference.begin() + 12345));
+}
+
+// =================================================================
+// 2. GB/s from 1 to N threads against the copying functors
+// =================================================================
+void benchmark_stream_transform(size_t bytes = size_t{1} << 30, size_t max_threads = std::thread::hardware_concurrency()) {
+  const XorKeystream keystream {42};
+  std::vector<std::byte> data(bytes, std::byte{1});
+  auto gbps = [&](auto&& fn) {
+    double best {1e18};
+    for (int round = 0; round < 3; round++) {
+      auto start = std::chrono::steady_clock::now();
+      fn();
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return double(bytes) / best / 1e9;
+  };
+
+  // The functor processes 64 KiB messages, copying each one in and out
+  constexpr size_t kMessage {64 * 1024};
+  std::string message(kMessage, 'x');
+  CopyingEncryptor encryptor {42};
+  double functor = gbps([&] {
+    size_t checksum {0};
+    for (size_t done = 0; done < bytes; done += kMessage) {
+      std::memcpy(message.data(), data.data() + done, std::min(kMessage, bytes - done));
+      checksum += size_t(encryptor(message)[0]);
+    }
+    assert(checksum != 0);
+  });
+  std::cout << "CopyingEncryptor (string by value): " << functor << " GB/s" << std::endl;
+
+  for (size_t threads = 1; threads <= std::max<size_t>(1, max_threads); threads *= 2) {
+    double engine = gbps([&] {
+      parallel_transform(std::span<std::byte>(data), keystream, 0, {.threads = threads});
+    });
+    std::cout << "parallel_transform, " << threads << " threads: " << engine << " GB/s" << std::endl;
+  }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <thread>
+
+#include "parallel.h"
+
+/**
+ * 1. Counter-mode transforms
+ * 2. A keyed XOR keystream as the reference transform
+ * 3. Splitting a buffer into cache-sized chunks over several threads
+ */
+
+// =================================================================
+// 1. Counter-mode transforms
+// =================================================================
+// Encryptor and Decryptor in function_lambda.cc take a std::string by value and return a new one, so every message is
+// copied at least twice and processed by one thread. A transform whose output byte only depends on the input byte and
+// its position in the stream (a stateless or counter-mode transform) can instead be applied in place, to any part of the
+// buffer independently, which is exactly what we need to split the work over threads.
+// A transform is anything callable as `transform(chunk, stream_offset)`, where `chunk` is a span of bytes that is
+// modified in place, and `stream_offset` is the position of its first byte in the whole stream.
+template <typename T>
+concept StreamTransform = requires(const T& transform, std::span<std::byte> chunk, uint64_t offset) {
+  transform(chunk, offset);
+};
+
+// =================================================================
+// 2. A keyed XOR keystream as the reference transform
+// =================================================================
+// The keystream is generated in 32-bit words: word i of the stream is a hash of (key, i). Since every word only depends
+// on its index, eight consecutive words are computed at once in a SIMD register. XOR-ing twice with the same keystream
+// restores the input, so the same transform encrypts and decrypts.
+// This is a reference for the engine, not a cipher: it is not cryptographically secure.
+class XorKeystream {
+  public:
+    explicit XorKeystream(uint64_t key) : key_lo_(uint32_t(key)), key_hi_(uint32_t(key >> 32) | 1) {}
+
+    void operator()(std::span<std::byte> chunk, uint64_t offset) const {
+      std::byte* data = chunk.data();
+      size_t size = chunk.size();
+      size_t i = 0;
+      // Bytes before the first word boundary of the stream
+      for (; i < size && (offset + i) % 4 != 0; i++) {
+        data[i] ^= keystream_byte(offset + i);
+      }
+      // Whole words, memcpy is the portable way to load and store unaligned data, and compiles to plain moves
+      uint32_t word_index = uint32_t((offset + i) / 4);
+      size_t words = (size - i) / 4;
+      size_t w = 0;
+      for (; w + kVectorWords <= words; w += kVectorWords) {
+        xor_vector(data + i + 4 * w, word_index + uint32_t(w));
+      }
+      for (; w < words; w++) {
+        xor_word(data + i + 4 * w, word_index + uint32_t(w));
+      }
+      i += 4 * words;
+      // The remaining bytes
+      for (; i < size; i++) {
+        data[i] ^= keystream_byte(offset + i);
+      }
+    }
+
+  private:
+    // GCC/Clang vector extensions: the same code compiles to one AVX2 register, or two SSE2 registers without AVX2.
+    // Unlike relying on the auto-vectorizer, this is vectorized at -O2 too.
+    static constexpr size_t kVectorWords {8};
+    typedef uint32_t words_vector __attribute__((vector_size(4 * kVectorWords)));
+
+    void xor_vector(std::byte* p, uint32_t index) const {
+      words_vector x {0, 1, 2, 3, 4, 5, 6, 7};
+      x = ((x + index) ^ key_lo_) * key_hi_;
+      x ^= x >> 16;
+      x *= 0x85EBCA6Bu;
+      x ^= x >> 13;
+      x *= 0xC2B2AE35u;
+      x ^= x >> 16;
+      if constexpr (std::endian::native == std::endian::big) {
+        for (size_t k = 0; k < kVectorWords; k++) {
+          x[k] = __builtin_bswap32(x[k]);
+        }
+      }
+      words_vector value;
+      std::memcpy(&value, p, sizeof(value));
+      value ^= x;
+      std::memcpy(p, &value, sizeof(value));
+    }
+
+    void xor_word(std::byte* p, uint32_t index) const {
+      uint32_t value;
+      std::memcpy(&value, p, 4);
+      uint32_t key = keystream_word(index);
+      if constexpr (std::endian::native == std::endian::big) {
+        key = __builtin_bswap32(key);
+      }
+      value ^= key;
+      std::memcpy(p, &value, 4);
+    }
+
+    // The finalizer of MurmurHash3, keyed, only 32-bit multiplies so that it maps to SIMD (see xor_vector)
+    uint32_t keystream_word(uint32_t index) const {
+      uint32_t x = (index ^ key_lo_) * key_hi_;
+      x ^= x >> 16;
+      x *= 0x85EBCA6Bu;
+      x ^= x >> 13;
+      x *= 0xC2B2AE35u;
+      x ^= x >> 16;
+      return x;
+    }
+
+    // Byte k of a keystream word is byte k of its little-endian representation, whatever the byte order of the machine
+    std::byte keystream_byte(uint64_t position) const {
+      return std::byte(keystream_word(uint32_t(position / 4)) >> (8 * (position % 4)));
+    }
+
+    uint32_t key_lo_;
+    uint32_t key_hi_;
+};
+
+// =================================================================
+// 3. Splitting a buffer into cache-sized chunks over several threads
+// =================================================================
+// Each thread repeatedly takes the next chunk from a shared atomic counter (dynamic scheduling), so a thread that is
+// slowed down by another process simply takes fewer chunks. The default chunk size keeps the chunk in L2 while it is
+// processed, and is a multiple of 64 bytes, so two threads never write to the same cache line.
+// The threads come from the shared thread_pool (see parallel.h). Small buffers are processed on the calling thread,
+// since waking up the workers costs more than transforming them.
+struct TransformOptions {
+  size_t threads {std::max(1u, std::thread::hardware_concurrency())};
+  size_t chunk_size {256 * 1024};
+  size_t min_parallel_size {1024 * 1024};
+};
+
+template <StreamTransform Transform>
+void parallel_transform(std::span<std::byte> data, const Transform& transform, uint64_t stream_offset = 0,
+                        TransformOptions options = {}) {
+  const size_t chunk_size = std::max<size_t>(64, options.chunk_size / 64 * 64);
+  const size_t chunks = (data.size() + chunk_size - 1) / chunk_size;
+  const size_t threads = std::min(options.threads, chunks);
+  if (threads <= 1 || data.size() < options.min_parallel_size) {
+    transform(data, stream_offset);
+    return;
+  }
+
+  std::atomic<size_t> next_chunk {0};
+  // The calling thread works too, as participant 0
+  thread_pool::global().run(threads, [&](size_t) {
+    for (size_t chunk = next_chunk.fetch_add(1); chunk < chunks; chunk = next_chunk.fetch_add(1)) {
+      size_t begin = chunk * chunk_size;
+      size_t size = std::min(chunk_size, data.size() - begin);
+      transform(data.subspan(begin, size), stream_offset + begin);
+    }
+  });
+}
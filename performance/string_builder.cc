@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "string_builder.h"
+
+/**
+ * 1. The builder and the rope produce the same text as std::string
+ * 2. Building 1M-piece strings, and editing a large text
+ */
+
+// =================================================================
+// 1. The builder and the rope produce the same text as std::string
+// =================================================================
+void test_string_builder() {
+  // concat, the one-allocation replacement of fn19()
+  std::string a {"Hello"};
+  std::string_view b {", "};
+  assert(concat(a, b, "world", std::string {"!"}) == "Hello, world!");
+  assert(concat().empty());
+
+  string_builder builder {64};
+  assert(builder.capacity() >= 64 && builder.size() == 0);
+  builder << "id=" << 42 << ',' << " total=" << -7L << ' ' << 18446744073709551615ull;
+  assert(builder.view() == "id=42, total=-7 18446744073709551615");
+  // Floating point numbers in their shortest round-trip form, bools as words
+  builder.clear();
+  builder << 3.14 << ' ' << 0.1f << ' ' << -2.5e-300 << ' ' << true << ' ' << false << ' ' << int8_t {-5};
+  assert(builder.view() == "3.14 0.1 -2.5e-300 true false -5");
+  static_assert(string_builder_appendable<double> && string_builder_appendable<std::string>);
+  static_assert(!string_builder_appendable<const int*> && !string_builder_appendable<std::byte>);
+  static_assert(!string_builder_appendable<std::vector<int>>);
+  std::vector<std::string> pieces {"a", "bc", "def"};
+  builder.clear();
+  builder.append_all(pieces).append(std::string_view {"!"});
+  assert(std::move(builder).str() == "abcdef!");
+
+  // The size hint is only a hint, the builder grows past it
+  string_builder small {4};
+  for (int i = 0; i < 1000; i++) {
+    small << "piece ";
+  }
+  assert(small.size() == 6000);
+
+  // The rope against a std::string, with random appends, inserts, erases and substrings
+  std::mt19937_64 random {1};
+  std::string expected;
+  rope text;
+  for (int step = 0; step < 3000; step++) {
+    std::string piece(random() % (step % 100 == 0 ? 5000 : 40), char('a' + step % 26));
+    switch (random() % 4) {
+      case 0:
+      case 1:
+        text.append(piece);
+        expected.append(piece);
+        break;
+      case 2: {
+        size_t position = random() % (expected.size() + 1);
+        text.insert(position, piece);
+        expected.insert(position, piece);
+        break;
+      }
+      case 3: {
+        size_t position = random() % (expected.size() + 1);
+        size_t count = random() % 3000;
+        text.erase(position, count);
+        expected.erase(position, count);
+        break;
+      }
+    }
+    assert(text.size() == expected.size());
+    if (step % 100 == 0) {
+      assert(text.str() == expected);
+      if (!expected.empty()) {
+        size_t i = random() % expected.size();
+        assert(text[i] == expected[i]);
+        assert(text.substr(i, 2500).str() == expected.substr(i, 2500));
+      }
+    }
+  }
+  assert(text.str() == expected);
+
+  // Balanced after thousands of edits: 1.44 log2 of the number of leaves, plus a little
+  size_t leaves = expected.size() / (rope::kLeafSize / 2) + 1;
+  assert(text.depth() <= 2 * int(std::bit_width(leaves)) + 2);
+
+  // Copies and substrings share the text, edits of one don't change the other
+  rope copy = text;
+  copy.insert(0, "prefix");
+  assert(text.str() == expected && copy.str() == "prefix" + expected);
+  rope joined {"abc"};
+  joined.append(rope {"def"});
+  joined.append(joined);
+  assert(joined.str() == "abcdefabcdef" && joined.substr(2, 3).str() == "cde");
+  assert(rope {}.str().empty() && rope {"x"}.substr(1).empty());
+}
+
+// =================================================================
+// 2. Building 1M-piece strings, and editing a large text
+// =================================================================
+// The O(n^2) versions take minutes for 1M pieces, so they only run up to quadratic_limit pieces
+void benchmark_string_builder(std::vector<size_t> piece_counts = {10'000, 100'000, 1'000'000},
+                              size_t quadratic_limit = 100'000) {
+  std::mt19937_64 random {1};
+  std::vector<std::string> words;
+  for (int i = 0; i < 1000; i++) {
+    words.push_back(std::string(1 + random() % 15, char('a' + i % 26)));
+  }
+
+  volatile size_t sink {0};
+  for (size_t count : piece_counts) {
+    size_t total {0};
+    for (size_t i = 0; i < count; i++) {
+      total += words[i % words.size()].size();
+    }
+    std::cout << count << " pieces, " << total << " bytes (ms):";
+
+    if (count <= quadratic_limit) {
+      // fn19: a new string for every concatenation
+      double plus = best_seconds([&] {
+        std::string s;
+        for (size_t i = 0; i < count; i++) {
+          s = s + words[i % words.size()];
+        }
+        sink = s.size();
+      }, 1);
+      // add<char*>: strcat scans the whole destination every time
+      double strcat = best_seconds([&] {
+        std::vector<char> buffer(total + 1, '\0');
+        for (size_t i = 0; i < count; i++) {
+          std::strcat(buffer.data(), words[i % words.size()].c_str());
+        }
+        sink = std::strlen(buffer.data());
+      }, 1);
+      std::cout << " s = s + piece " << plus * 1e3 << ", strcat " << strcat * 1e3 << ",";
+    }
+    double append = best_seconds([&] {
+      std::string s;
+      for (size_t i = 0; i < count; i++) {
+        s += words[i % words.size()];
+      }
+      sink = s.size();
+    });
+    double builder = best_seconds([&] {
+      string_builder b {total};
+      for (size_t i = 0; i < count; i++) {
+        b << words[i % words.size()];
+      }
+      sink = std::move(b).str().size();
+    });
+    double with_rope = best_seconds([&] {
+      rope r;
+      for (size_t i = 0; i < count; i++) {
+        r += words[i % words.size()];
+      }
+      sink = r.str().size();
+    });
+    std::cout << " += " << append * 1e3 << ", string_builder " << builder * 1e3 << ", rope " << with_rope * 1e3
+              << std::endl;
+  }
+
+  // Edits in the middle of a 64 MB text: std::string moves the rest of the text every time
+  std::string big(size_t {64} << 20, 'x');
+  const int edits = 1000;
+  std::vector<size_t> positions;
+  for (int i = 0; i < edits; i++) {
+    positions.push_back(random() % big.size());
+  }
+  double string_edits = best_seconds([&] {
+    std::string s = big;
+    for (size_t position : positions) {
+      s.insert(position, "inserted");
+      s.erase(position / 2, 8);
+    }
+    sink = s.size();
+  });
+  double rope_edits = best_seconds([&] {
+    rope r {big};
+    for (size_t position : positions) {
+      r.insert(position, "inserted");
+      r.erase(position / 2, 8);
+    }
+    sink = r.size();
+  });
+  std::cout << edits << " insert + erase in 64 MB (ms, including the initial copy): std::string " << string_edits * 1e3
+            << ", rope " << rope_edits * 1e3 << std::endl;
+}
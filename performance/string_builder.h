@@ -0,0 +1,389 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * 1. Why repeated concatenation is quadratic
+ * 2. concat: one allocation for a fixed number of pieces
+ * 3. string_builder: append with a size hint
+ * 4. rope: a balanced tree of chunks for large texts with many edits
+ */
+
+// =================================================================
+// 1. Why repeated concatenation is quadratic
+// =================================================================
+// - std::strcat(a, b), as in the char* specialization of add() in function_template.cc, first scans a for its
+//   terminating '\0'. Appending n pieces to the same buffer scans 1 + 2 + ... + n pieces: O(n^2).
+// - s = s + piece, the pattern of fn19() in function.cpp and Encryptor in function_lambda.cc when it's called in a loop,
+//   allocates a new string and copies all of s every time: O(n^2) again, plus an allocation per piece.
+// - s += piece is amortized O(1) per byte, because std::string grows its capacity geometrically, but it still
+//   reallocates and copies log(n) times, and the memory peak is up to twice the final size.
+// If the final size is known or can be estimated, reserving it once removes the reallocations. For large texts that
+// are edited in the middle, even a single copy per edit is too much, which is what the rope is for.
+
+// =================================================================
+// 2. concat: one allocation for a fixed number of pieces
+// =================================================================
+// `a + b + c + d` creates two temporaries. concat(a, b, c, d) adds up the sizes first and copies every piece once.
+template <typename... Pieces>
+requires (std::convertible_to<const Pieces&, std::string_view> && ...)
+std::string concat(const Pieces&... pieces) {
+  std::string result;
+  result.reserve((std::string_view {pieces}.size() + ... + 0));
+  (result.append(std::string_view {pieces}), ...);
+  return result;
+}
+
+// =================================================================
+// 3. string_builder: append with a size hint
+// =================================================================
+// A std::string that only grows at the end. The size hint in the constructor is an estimate, not a limit: if the text
+// gets bigger, the buffer grows geometrically like a std::string, so appending stays amortized O(1) either way.
+// Numbers are formatted with std::to_chars, directly into the buffer, without the temporary std::string of
+// std::to_string or the locale of a std::ostringstream. Floating point numbers get the shortest text that reads back
+// as the same value, and bools are written as true and false.
+// operator<< only takes what append() formats exactly, anything else (a pointer, an enum, a class) doesn't compile
+// rather than being converted to a char or a bool on the way.
+template <typename T>
+concept string_builder_appendable = std::convertible_to<const T&, std::string_view> || std::integral<T> ||
+                                    std::floating_point<T>;
+
+class string_builder {
+  public:
+    explicit string_builder(size_t size_hint = 0) {
+      buffer_.reserve(size_hint);
+    }
+
+    string_builder& append(std::string_view piece) {
+      buffer_.append(piece);
+      return *this;
+    }
+
+    string_builder& append(char c) {
+      buffer_.push_back(c);
+      return *this;
+    }
+
+    template <typename T>
+    requires (std::integral<T> && !std::same_as<T, char> && !std::same_as<T, bool>)
+    string_builder& append(T value) {
+      char digits[24];
+      auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+      assert(error == std::errc {});
+      buffer_.append(digits, end);
+      return *this;
+    }
+
+    template <std::floating_point T>
+    string_builder& append(T value) {
+      char digits[64];
+      auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+      assert(error == std::errc {});
+      buffer_.append(digits, end);
+      return *this;
+    }
+
+    // A template, so that pointers don't convert to bool to get here
+    template <std::same_as<bool> T>
+    string_builder& append(T value) {
+      buffer_.append(value ? "true" : "false");
+      return *this;
+    }
+
+    // Every piece of a range at once: the total size is computed first, so the buffer grows at most once
+    template <typename Range>
+    string_builder& append_all(const Range& pieces) {
+      size_t total = buffer_.size();
+      for (const auto& piece : pieces) {
+        total += std::string_view {piece}.size();
+      }
+      reserve(total);
+      for (const auto& piece : pieces) {
+        buffer_.append(std::string_view {piece});
+      }
+      return *this;
+    }
+
+    template <string_builder_appendable T>
+    string_builder& operator<<(const T& value) {
+      if constexpr (std::convertible_to<const T&, std::string_view>) {
+        return append(std::string_view {value});
+      } else {
+        return append(value);
+      }
+    }
+
+    // Grows to at least `capacity`, but never less than geometrically, so that a series of small reserves doesn't
+    // turn appending back into O(n^2)
+    void reserve(size_t capacity) {
+      if (capacity > buffer_.capacity()) {
+        buffer_.reserve(std::max(capacity, 2 * buffer_.capacity()));
+      }
+    }
+
+    size_t size() const { return buffer_.size(); }
+    size_t capacity() const { return buffer_.capacity(); }
+    std::string_view view() const { return buffer_; }
+    void clear() { buffer_.clear(); }
+
+    // The result is moved out of a temporary builder, std::move(builder).str(), and copied otherwise
+    std::string str() && { return std::move(buffer_); }
+    std::string str() const& { return buffer_; }
+
+  private:
+    std::string buffer_;
+};
+
+// =================================================================
+// 4. rope: a balanced tree of chunks for large texts with many edits
+// =================================================================
+// The text is stored in leaves of at most kLeafSize bytes, which are the leaves of a height-balanced (AVL) binary tree.
+// Every internal node knows the size of its subtree, so finding position i, splitting at i and joining two ropes take
+// O(log n), and insert and erase are a split and a join or two, instead of moving the rest of the text.
+// Nodes are immutable and shared through shared_ptr, so copying a rope or taking a substr() shares all of the text;
+// an edit only creates the O(log n) nodes on the path to the change.
+// Appending goes to a small string at the end first, which becomes a new leaf when it is full, so appending many short
+// pieces is amortized O(1) and touches the tree once per kLeafSize bytes. str() materializes the whole text with one
+// allocation and one copy of every byte.
+class rope {
+  public:
+    static constexpr size_t kLeafSize {1024};
+    static constexpr size_t npos {std::string_view::npos};
+
+    rope() = default;
+    explicit rope(std::string_view text) { append(text); }
+
+    size_t size() const { return tree_size() + tail_.size(); }
+    bool empty() const { return size() == 0; }
+
+    rope& append(std::string_view text) {
+      tail_.append(text);
+      if (tail_.size() >= kLeafSize) {
+        flush();
+      }
+      return *this;
+    }
+    rope& operator+=(std::string_view text) { return append(text); }
+
+    // Another rope is joined in O(log n) without copying its text
+    rope& append(const rope& other) {
+      flush();
+      root_ = join(root_, other.root_);
+      tail_ = other.tail_;
+      return *this;
+    }
+
+    char operator[](size_t i) const {
+      assert(i < size());
+      if (i >= tree_size()) {
+        return tail_[i - tree_size()];
+      }
+      const node* n = root_.get();
+      while (!n->is_leaf()) {
+        if (i < n->left->size) {
+          n = n->left.get();
+        } else {
+          i -= n->left->size;
+          n = n->right.get();
+        }
+      }
+      return n->text[i];
+    }
+
+    void insert(size_t position, std::string_view text) {
+      assert(position <= size());
+      flush();
+      auto [left, right] = split(root_, position);
+      root_ = join(join(left, build(text)), right);
+    }
+
+    void erase(size_t position, size_t count = npos) {
+      assert(position <= size());
+      flush();
+      count = std::min(count, size() - position);
+      auto [left, rest] = split(root_, position);
+      root_ = join(left, split(rest, count).second);
+    }
+
+    // Shares the nodes of this rope, only the O(log n) nodes along the two cuts are new
+    rope substr(size_t position, size_t count = npos) const {
+      assert(position <= size());
+      count = std::min(count, size() - position);
+      const size_t end = position + count;
+      const size_t tree = tree_size();
+      rope result;
+      if (position < tree) {
+        result.root_ = split(split(root_, std::min(end, tree)).first, position).second;
+      }
+      if (end > tree) {
+        const size_t from = std::max(position, tree) - tree;
+        result.tail_ = tail_.substr(from, end - tree - from);
+      }
+      return result;
+    }
+
+    // Calls fn(std::string_view) for every chunk of text, in order
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const {
+      visit(root_.get(), fn);
+      if (!tail_.empty()) {
+        fn(std::string_view {tail_});
+      }
+    }
+
+    std::string str() const {
+      std::string result;
+      result.reserve(size());
+      for_each_chunk([&](std::string_view chunk) { result.append(chunk); });
+      return result;
+    }
+
+    // The height of the tree, O(log(size / kLeafSize)) after any sequence of edits
+    int depth() const { return height(root_); }
+
+  private:
+    struct node;
+    using node_ptr = std::shared_ptr<const node>;
+
+    // A leaf has text and no children, an internal node has two children and no text
+    struct node {
+      size_t size;
+      int height;
+      node_ptr left;
+      node_ptr right;
+      std::string text;
+
+      bool is_leaf() const { return !left; }
+    };
+
+    static size_t size_of(const node_ptr& n) { return n ? n->size : 0; }
+    static int height(const node_ptr& n) { return n ? n->height : -1; }
+
+    static node_ptr leaf(std::string_view text) {
+      if (text.empty()) {
+        return nullptr;
+      }
+      return std::make_shared<const node>(node {text.size(), 0, nullptr, nullptr, std::string {text}});
+    }
+
+    static node_ptr make(node_ptr left, node_ptr right) {
+      size_t size = left->size + right->size;
+      int h = std::max(left->height, right->height) + 1;
+      return std::make_shared<const node>(node {size, h, std::move(left), std::move(right), {}});
+    }
+
+    // Like make(), but the heights of left and right may differ by 2, which one or two rotations fix
+    static node_ptr balance(const node_ptr& left, const node_ptr& right) {
+      if (height(left) > height(right) + 1) {
+        if (height(left->left) >= height(left->right)) {
+          return make(left->left, make(left->right, right));
+        }
+        return make(make(left->left, left->right->left), make(left->right->right, right));
+      }
+      if (height(right) > height(left) + 1) {
+        if (height(right->right) >= height(right->left)) {
+          return make(make(left, right->left), right->right);
+        }
+        return make(make(left, right->left->left), make(right->left->right, right->right));
+      }
+      return make(left, right);
+    }
+
+    // AVL join: descend along the spine of the taller tree to a subtree of about the height of the shorter one. Two
+    // small leaves are merged into one, so erasing and inserting don't fragment the text into tiny leaves.
+    static node_ptr join(const node_ptr& left, const node_ptr& right) {
+      if (!left) {
+        return right;
+      }
+      if (!right) {
+        return left;
+      }
+      if (left->is_leaf() && right->is_leaf() && left->size + right->size <= kLeafSize) {
+        return leaf(left->text + right->text);
+      }
+      if (left->height > right->height + 1) {
+        return balance(left->left, join(left->right, right));
+      }
+      if (right->height > left->height + 1) {
+        return balance(join(left, right->left), right->right);
+      }
+      return make(left, right);
+    }
+
+    // {the first `position` bytes, the rest}
+    static std::pair<node_ptr, node_ptr> split(const node_ptr& n, size_t position) {
+      if (!n) {
+        return {nullptr, nullptr};
+      }
+      if (position == 0) {
+        return {nullptr, n};
+      }
+      if (position >= n->size) {
+        return {n, nullptr};
+      }
+      if (n->is_leaf()) {
+        std::string_view text {n->text};
+        return {leaf(text.substr(0, position)), leaf(text.substr(position))};
+      }
+      if (position < n->left->size) {
+        auto [a, b] = split(n->left, position);
+        return {a, join(b, n->right)};
+      }
+      auto [a, b] = split(n->right, position - n->left->size);
+      return {join(n->left, a), b};
+    }
+
+    // A balanced tree of full leaves, built bottom-up in O(n)
+    static node_ptr build(std::string_view text) {
+      std::vector<node_ptr> level;
+      for (size_t i = 0; i < text.size(); i += kLeafSize) {
+        level.push_back(leaf(text.substr(i, kLeafSize)));
+      }
+      while (level.size() > 1) {
+        std::vector<node_ptr> next;
+        for (size_t i = 0; i + 1 < level.size(); i += 2) {
+          next.push_back(make(level[i], level[i + 1]));
+        }
+        if (level.size() % 2 == 1) {
+          next.back() = join(next.back(), level.back());
+        }
+        level = std::move(next);
+      }
+      return level.empty() ? nullptr : level[0];
+    }
+
+    template <typename Fn>
+    static void visit(const node* n, Fn& fn) {
+      // Recursion depth is the height of the tree, about 1.44 log2(leaves)
+      if (!n) {
+        return;
+      }
+      if (n->is_leaf()) {
+        fn(std::string_view {n->text});
+        return;
+      }
+      visit(n->left.get(), fn);
+      visit(n->right.get(), fn);
+    }
+
+    size_t tree_size() const { return size_of(root_); }
+
+    void flush() {
+      if (!tail_.empty()) {
+        root_ = join(root_, build(tail_));
+        tail_.clear();
+      }
+    }
+
+    node_ptr root_;
+    std::string tail_;
+};
@@ -0,0 +1,94 @@
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "common.h"
+#include "struct_layout.h"
+
+/**
+ * 1. Reports, budgets and hot/cold splits
+ */
+
+// =================================================================
+// 1. Reports, budgets and hot/cold splits
+// =================================================================
+// The structs of struct.cpp are in common.h
+// A record with hot members (read by every scan) and cold ones, in an order that wastes space
+struct order_record {
+  char status;
+  double price;
+  int16_t quantity;
+  std::array<char, 24> comment;
+  int64_t customer;
+  bool paid;
+  int32_t warehouse;
+};
+
+void test_struct_layout() {
+  using namespace struct_cpp;
+  static_assert(layout::field_count<MyStruct2> == 2 && layout::field_count<MyStruct5> == 3);
+  static_assert(layout::field_count<Company> == 2 && layout::field_count<MyStruct8> == 1);
+  static_assert(layout::field_count<MyStruct6<int>> == 3 && layout::field_count<order_record> == 7);
+
+  // Employee: age at 0, 4 bytes of padding, salary at 8
+  constexpr auto employee = layout::layout_of<Employee>();
+  static_assert(employee.size == 16 && employee.data == 12 && employee.padding == 4);
+  static_assert(employee.fields[1].offset == 8 && employee.fields[1].padding_before == 4);
+  static_assert(employee.tail_padding == 0 && employee.largest_hole == 4);
+  // Reordered as {salary, age}, it is still 16 bytes: the 4 bytes move to the end, but can't go away
+  static_assert(employee.best_order == std::array<size_t, 2> {1, 0} && employee.best_size == 16);
+  static_assert(layout::avoidable_padding<Employee> == 0 && layout::padding<Employee> <= 4);
+
+  // Company nests an Employee, which is one member of size 16 and alignment 8: the padding inside the Employee counts
+  // as data here, it is reported for Employee itself
+  constexpr auto company = layout::layout_of<Company>();
+  static_assert(company.size == 24 && company.fields[1].size == 16 && company.fields[1].alignment == 8);
+  static_assert(layout::padding<Company> == 4 && layout::avoidable_padding<Company> == 0);
+
+  // MyStruct5 {int, double, int}: 24 bytes, 16 if the ints are next to each other
+  static_assert(layout::padding<MyStruct5> == 8 && layout::avoidable_padding<MyStruct5> == 8);
+  static_assert(layout::layout_of<MyStruct5>().best_order == std::array<size_t, 3> {1, 0, 2});
+  static_assert(layout::layout_of<MyStruct6<char, double>>().best_size == 16);
+  static_assert(layout::layout_of<MyStruct6<char, char>>().size == 8);
+  static_assert(layout::padding<MyStruct7> == 4 && layout::padding<MyStruct8> == 0);
+  static_assert(layout::largest_hole<MyStruct8> == 0);
+
+  // The computed offsets are the real ones
+  assert(layout::offsets_match(MyStruct2 {1, 2.0}));
+  assert(layout::offsets_match(MyStruct5 {}));
+  assert(layout::offsets_match(Company {}));
+  assert(layout::offsets_match(MyStruct6<char, int16_t> {}));
+  assert(layout::offsets_match(order_record {}));
+
+  constexpr auto order = layout::layout_of<order_record>();
+  static_assert(order.size == 64 && order.data == 48 && order.best_size == 48);
+  static_assert(layout::avoidable_padding<order_record> == 16 && order.largest_hole == 7);
+  // Price and quantity are hot: a scan over them reads 16 bytes per record instead of 64
+  constexpr layout::split_report split = layout::hot_cold_split<order_record>({1, 2});
+  static_assert(split.hot_size == 16 && split.cold_size == 40 && split.original_size == 64);
+  static_assert(split.hot_scan_saving() == 4.0);
+
+  std::ostringstream out;
+  layout::print_layout<MyStruct5>(out, "MyStruct5");
+  assert(out.str() == "MyStruct5: 24 bytes, alignment 8, 16 bytes of data, 8 of padding\n"
+                      "  [0, 4) member 0, size 4, alignment 4\n"
+                      "  [4, 8) 4 bytes of padding\n"
+                      "  [8, 16) member 1, size 8, alignment 8\n"
+                      "  [16, 20) member 2, size 4, alignment 4\n"
+                      "  [20, 24) 4 bytes of tail padding\n"
+                      "  reordered as {1, 0, 2}: 16 bytes, 8 bytes less\n");
+}
+
+// The reports of the structs of struct.cpp and of order_record
+void print_struct_layouts() {
+  using namespace struct_cpp;
+  layout::print_layout<MyStruct2>(std::cout, "MyStruct2");
+  layout::print_layout<MyStruct5>(std::cout, "MyStruct5");
+  layout::print_layout<Employee>(std::cout, "Employee");
+  layout::print_layout<Company>(std::cout, "Company");
+  layout::print_layout<MyStruct6<char, double>>(std::cout, "MyStruct6<char, double>");
+  layout::print_layout<order_record>(std::cout, "order_record");
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+#include "packed_tuple.h"
+
+/**
+ * 1. Where padding comes from
+ * 2. Counting the fields of an aggregate
+ * 3. The types of the fields, through structured bindings
+ * 4. The layout report
+ * 5. Budgets for static_assert
+ * 6. Hot/cold splits
+ * 7. Printing a report
+ */
+
+// =================================================================
+// 1. Where padding comes from
+// =================================================================
+// The members of a struct are laid out in declaration order, each at the next offset that is a multiple of its
+// alignment, and the size is rounded up to a multiple of the largest alignment (see packed_tuple.h). So the Employee
+// of struct.cpp, {int age; double salary;}, has 4 bytes of padding after age, and is 16 bytes for 12 bytes of data.
+// C++20 has no reflection, but for an aggregate the types of the members are enough to compute the whole layout by
+// that rule: the number of members is found by trying brace initializations, and their types by a structured binding.
+// The report lists the offset and size of every member, the holes between them, and the order by decreasing alignment
+// with its size, all at compile time.
+// Not supported: base classes, bit-fields, C array members (brace elision makes them count as one member per element),
+// reference members, [[no_unique_address]] and alignas on members. The computed size is checked against sizeof(T),
+// which catches most of these cases at compile time.
+
+namespace layout {
+
+// =================================================================
+// 2. Counting the fields of an aggregate
+// =================================================================
+namespace detail {
+
+// Converts to anything, so T{any_field{}, any_field{}} compiles if T has at least 2 members
+struct any_field {
+  template <typename U>
+  constexpr operator U() const noexcept;
+};
+
+template <typename T, size_t... I>
+constexpr bool brace_constructible(std::index_sequence<I...>) {
+  return requires { T {(void(I), any_field {})...}; };
+}
+
+// The largest number of initializers that T accepts
+template <typename T, size_t N = 0>
+constexpr size_t count_fields() {
+  if constexpr (N < 16 && brace_constructible<T>(std::make_index_sequence<N + 1> {})) {
+    return count_fields<T, N + 1>();
+  } else {
+    return N;
+  }
+}
+
+} // namespace detail
+
+template <typename T>
+concept Reflectable = std::is_aggregate_v<T> && !std::is_array_v<T> && std::is_standard_layout_v<T>;
+
+template <Reflectable T>
+inline constexpr size_t field_count = detail::count_fields<T>();
+
+// =================================================================
+// 3. The types of the fields, through structured bindings
+// =================================================================
+namespace detail {
+
+template <typename... Ts>
+struct type_list {};
+
+// Calls fn with a reference to every member of object, in declaration order
+template <typename T, typename Fn, size_t N = field_count<std::remove_const_t<T>>>
+constexpr decltype(auto) visit_fields(T& object, Fn&& fn) {
+  static_assert(N >= 1 && N <= 16, "aggregates with 1 to 16 members are supported");
+  if constexpr (N == 1) {
+    auto& [a] = object;
+    return fn(a);
+  } else if constexpr (N == 2) {
+    auto& [a, b] = object;
+    return fn(a, b);
+  } else if constexpr (N == 3) {
+    auto& [a, b, c] = object;
+    return fn(a, b, c);
+  } else if constexpr (N == 4) {
+    auto& [a, b, c, d] = object;
+    return fn(a, b, c, d);
+  } else if constexpr (N == 5) {
+    auto& [a, b, c, d, e] = object;
+    return fn(a, b, c, d, e);
+  } else if constexpr (N == 6) {
+    auto& [a, b, c, d, e, f] = object;
+    return fn(a, b, c, d, e, f);
+  } else if constexpr (N == 7) {
+    auto& [a, b, c, d, e, f, g] = object;
+    return fn(a, b, c, d, e, f, g);
+  } else if constexpr (N == 8) {
+    auto& [a, b, c, d, e, f, g, h] = object;
+    return fn(a, b, c, d, e, f, g, h);
+  } else if constexpr (N == 9) {
+    auto& [a, b, c, d, e, f, g, h, i] = object;
+    return fn(a, b, c, d, e, f, g, h, i);
+  } else if constexpr (N == 10) {
+    auto& [a, b, c, d, e, f, g, h, i, j] = object;
+    return fn(a, b, c, d, e, f, g, h, i, j);
+  } else if constexpr (N == 11) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k] = object;
+    return fn(a, b, c, d, e, f, g, h, i, j, k);
+  } else if constexpr (N == 12) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l] = object;
+    return fn(a, b, c, d, e, f, g, h, i, j, k, l);
+  } else if constexpr (N == 13) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l, m] = object;
+    return fn(a, b, c, d, e, f, g, h, i, j, k, l, m);
+  } else if constexpr (N == 14) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n] = object;
+    return fn(a, b, c, d, e, f, g, h, i, j, k, l, m, n);
+  } else if constexpr (N == 15) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n, o] = object;
+    return fn(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o);
+  } else if constexpr (N == 16) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p] = object;
+    return fn(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p);
+  }
+}
+
+struct collect_types {
+  template <typename... Fs>
+  type_list<std::remove_cv_t<Fs>...> operator()(Fs&...) const {
+    return {};
+  }
+};
+
+// Only the return type is used, so the binding never touches an object
+template <typename T>
+using field_type_list = decltype(visit_fields(std::declval<T&>(), collect_types {}));
+
+} // namespace detail
+
+// =================================================================
+// 4. The layout report
+// =================================================================
+struct field_info {
+  size_t offset;
+  size_t size;
+  size_t alignment;
+  size_t padding_before;   // the hole between the previous member (or the start) and this one
+};
+
+template <size_t N>
+struct report {
+  std::array<field_info, N> fields;
+  size_t size;             // sizeof(T)
+  size_t alignment;
+  size_t data;             // the sum of the sizes of the members
+  size_t padding;          // size - data: the holes plus the padding at the end
+  size_t tail_padding;
+  size_t largest_hole;     // the largest single gap, including the padding at the end
+  std::array<size_t, N> best_order;   // the members by decreasing alignment, as declared indices
+  size_t best_size;        // sizeof of a struct with the members in best_order
+
+  // Bytes that reordering the members would save per object
+  constexpr size_t avoidable_padding() const { return size - best_size; }
+};
+
+namespace detail {
+
+constexpr size_t round_up(size_t n, size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+// Laid out in the given order, returns the size of the struct
+template <size_t N>
+constexpr size_t place(const std::array<size_t, N>& sizes, const std::array<size_t, N>& alignments,
+                       const std::array<size_t, N>& order, std::array<size_t, N>* offsets = nullptr) {
+  size_t end {0};
+  size_t alignment {1};
+  for (size_t i : order) {
+    const size_t offset = round_up(end, alignments[i]);
+    if (offsets != nullptr) {
+      (*offsets)[i] = offset;
+    }
+    end = offset + sizes[i];
+    alignment = std::max(alignment, alignments[i]);
+  }
+  return round_up(end, alignment);
+}
+
+template <typename... Ts>
+constexpr report<sizeof...(Ts)> make_report(type_list<Ts...>) {
+  constexpr size_t N = sizeof...(Ts);
+  const std::array<size_t, N> sizes {sizeof(Ts)...};
+  const std::array<size_t, N> alignments {alignof(Ts)...};
+  std::array<size_t, N> declared {};
+  for (size_t i = 0; i < N; i++) {
+    declared[i] = i;
+  }
+  std::array<size_t, N> offsets {};
+
+  report<N> r {};
+  r.size = place(sizes, alignments, declared, &offsets);
+  r.alignment = std::max({alignof(Ts)...});
+  size_t end {0};
+  for (size_t i = 0; i < N; i++) {
+    r.fields[i] = {offsets[i], sizes[i], alignments[i], offsets[i] - end};
+    r.largest_hole = std::max(r.largest_hole, offsets[i] - end);
+    r.data += sizes[i];
+    end = offsets[i] + sizes[i];
+  }
+  r.tail_padding = r.size - end;
+  r.largest_hole = std::max(r.largest_hole, r.tail_padding);
+  r.padding = r.size - r.data;
+  // The same stable sort as the storage of packed_tuple
+  r.best_order = packed_detail::storage_order<Ts...>();
+  r.best_size = place(sizes, alignments, r.best_order);
+  return r;
+}
+
+} // namespace detail
+
+template <Reflectable T>
+constexpr auto layout_of() {
+  constexpr auto r = detail::make_report(detail::field_type_list<T> {});
+  static_assert(r.size == sizeof(T) && r.alignment == alignof(T),
+                "the layout of T doesn't follow the declaration order rule, see the list of unsupported members");
+  return r;
+}
+
+// Whether the computed offsets match those of a real object, for the tests (offsetof isn't available through
+// structured bindings, so this has to look at addresses at run time)
+template <Reflectable T>
+bool offsets_match(const T& object) {
+  constexpr auto r = layout_of<T>();
+  const auto* base = reinterpret_cast<const unsigned char*>(&object);
+  return detail::visit_fields(object, [&](const auto&... fields) {
+    size_t i {0};
+    return ((reinterpret_cast<const unsigned char*>(&fields) - base == ptrdiff_t(r.fields[i++].offset)) && ...);
+  });
+}
+
+// =================================================================
+// 5. Budgets for static_assert
+// =================================================================
+// static_assert(layout::padding<MyRecord> <= 4) fails to compile as soon as a change adds more padding, and
+// static_assert(layout::avoidable_padding<MyRecord> == 0) as soon as the members are not in the best order
+template <Reflectable T>
+inline constexpr size_t padding = layout_of<T>().padding;
+
+template <Reflectable T>
+inline constexpr size_t avoidable_padding = layout_of<T>().avoidable_padding();
+
+template <Reflectable T>
+inline constexpr size_t largest_hole = layout_of<T>().largest_hole;
+
+// =================================================================
+// 6. Hot/cold splits
+// =================================================================
+// A loop that reads only some members of many objects (the hot ones) still brings whole objects into the cache.
+// Moving the other members to a separate array (a parallel array, or a pointer to a cold part) shrinks what the loop
+// reads to the hot struct, laid out in the best order.
+struct split_report {
+  size_t hot_size;         // sizeof of a struct of the hot members, in the best order
+  size_t cold_size;
+  size_t original_size;
+
+  // The factor by which a scan over the hot members reads less memory
+  constexpr double hot_scan_saving() const { return double(original_size) / double(hot_size); }
+};
+
+template <Reflectable T>
+constexpr split_report hot_cold_split(std::initializer_list<size_t> hot) {
+  constexpr auto r = layout_of<T>();
+  constexpr size_t N = r.fields.size();
+  std::array<bool, N> is_hot {};
+  for (size_t i : hot) {
+    is_hot[i] = true;
+  }
+  auto best_size = [&](bool want_hot) {
+    size_t end {0};
+    size_t alignment {1};
+    for (size_t i : r.best_order) {
+      if (is_hot[i] == want_hot) {
+        end = detail::round_up(end, r.fields[i].alignment) + r.fields[i].size;
+        alignment = std::max(alignment, r.fields[i].alignment);
+      }
+    }
+    return detail::round_up(end, alignment);
+  };
+  return {best_size(true), best_size(false), r.size};
+}
+
+// =================================================================
+// 7. Printing a report
+// =================================================================
+// Member names aren't available without reflection, so the members are numbered in declaration order
+template <Reflectable T>
+void print_layout(std::ostream& out, const char* name) {
+  constexpr auto r = layout_of<T>();
+  out << name << ": " << r.size << " bytes, alignment " << r.alignment << ", " << r.data << " bytes of data, "
+      << r.padding << " of padding\n";
+  for (size_t i = 0; i < r.fields.size(); i++) {
+    if (r.fields[i].padding_before > 0) {
+      out << "  [" << r.fields[i].offset - r.fields[i].padding_before << ", " << r.fields[i].offset << ") "
+          << r.fields[i].padding_before << " bytes of padding\n";
+    }
+    out << "  [" << r.fields[i].offset << ", " << r.fields[i].offset + r.fields[i].size << ") member " << i
+        << ", size " << r.fields[i].size << ", alignment " << r.fields[i].alignment << "\n";
+  }
+  if (r.tail_padding > 0) {
+    out << "  [" << r.size - r.tail_padding << ", " << r.size << ") " << r.tail_padding << " bytes of tail padding\n";
+  }
+  if (r.avoidable_padding() > 0) {
+    out << "  reordered as {";
+    for (size_t i = 0; i < r.best_order.size(); i++) {
+      out << (i > 0 ? ", " : "") << r.best_order[i];
+    }
+    out << "}: " << r.best_size << " bytes, " << r.avoidable_padding() << " bytes less\n";
+  } else {
+    out << "  already in the best order\n";
+  }
+}
+
+} // namespace layout
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "tiled.h"
+
+/**
+ * 1. Tiled and recursive traversals visit every element once, in any shape
+ * 2. Transposing 8K x 8K doubles and permuting 3D axes against naive loops
+ */
+
+// =================================================================
+// 1. Tiled and recursive traversals visit every element once, in any shape
+// =================================================================
+void test_tiled() {
+  const tiling::cache_sizes& cache = tiling::cache();
+  assert(cache.l1 > 0 && cache.l2 >= cache.l1 && cache.line > 0);
+  assert(tiling::l1_tile<double>() >= 1 && tiling::l2_tile<double>() >= tiling::l1_tile<double>());
+  assert(tiling::square_tile<double>(32 * 1024) == 32 && tiling::square_tile<char>(64) == 4);
+
+  std::vector<int> visits(37 * 53, 0);
+  tiling::for_each_tiled(37, 53, 8, [&](size_t r, size_t c) { visits[r * 53 + c]++; });
+  assert(std::all_of(visits.begin(), visits.end(), [](int v) { return v == 1; }));
+  std::vector<int> visits3(7 * 9 * 11, 0);
+  tiling::for_each_tile({7, 9, 11}, 4, [&](std::array<size_t, 3> begin, std::array<size_t, 3> end) {
+    for (size_t i = begin[0]; i < end[0]; i++) {
+      for (size_t j = begin[1]; j < end[1]; j++) {
+        for (size_t k = begin[2]; k < end[2]; k++) {
+          visits3[(i * 9 + j) * 11 + k]++;
+        }
+      }
+    }
+  });
+  assert(std::all_of(visits3.begin(), visits3.end(), [](int v) { return v == 1; }));
+
+  // Square, tall, wide and odd shapes, with tiny tiles so that the recursion goes deep, and the default tile
+  for (auto [rows, columns] : {std::pair<size_t, size_t> {1, 1}, {1, 100}, {100, 1}, {64, 64}, {67, 129}, {300, 7}}) {
+    for (size_t tile : {1, 3, 8, 0}) {
+      std::vector<int> src(rows * columns);
+      for (size_t i = 0; i < src.size(); i++) {
+        src[i] = int(i);
+      }
+      std::vector<int> dst(rows * columns, -1);
+      tiling::transpose(src.data(), dst.data(), rows, columns, tile);
+      for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < columns; j++) {
+          assert(dst[j * rows + i] == src[i * columns + j]);
+        }
+      }
+      if (rows == columns) {
+        tiling::transpose_in_place(src.data(), rows, tile);
+        assert(src == dst);
+      }
+    }
+  }
+  int small[2][3] {{1, 2, 3}, {4, 5, 6}};
+  int small_t[3][2];
+  tiling::transpose(small, small_t);
+  assert(small_t[2][0] == 3 && small_t[0][1] == 4);
+
+  // All 6 orders of the axes, on the shape of the arrays of fn10() and on a bigger, odd one
+  int a[4][3][5];
+  for (size_t i = 0; i < 60; i++) {
+    (&a[0][0][0])[i] = int(i);
+  }
+  std::vector<std::array<size_t, 3>> orders {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  for (const auto& order : orders) {
+    for (std::array<size_t, 3> extents : {std::array<size_t, 3> {4, 3, 5}, std::array<size_t, 3> {17, 40, 9}}) {
+      std::vector<int> src(extents[0] * extents[1] * extents[2]);
+      for (size_t i = 0; i < src.size(); i++) {
+        src[i] = int(i);
+      }
+      std::vector<int> dst(src.size(), -1);
+      tiling::permute_axes(src.data(), dst.data(), extents, order, 2);
+      std::array<size_t, 3> e {extents[order[0]], extents[order[1]], extents[order[2]]};
+      for (size_t i = 0; i < extents[0]; i++) {
+        for (size_t j = 0; j < extents[1]; j++) {
+          for (size_t k = 0; k < extents[2]; k++) {
+            std::array<size_t, 3> index {i, j, k};
+            size_t d = (index[order[0]] * e[1] + index[order[1]]) * e[2] + index[order[2]];
+            assert(dst[d] == src[(i * extents[1] + j) * extents[2] + k]);
+          }
+        }
+      }
+    }
+    int b[60];
+    tiling::permute_axes(a, b, order);
+    assert(std::count(b, b + 60, 0) == 1 && b[59] == 59);
+  }
+}
+
+// =================================================================
+// 2. Transposing 8K x 8K doubles and permuting 3D axes against naive loops
+// =================================================================
+// 8K x 8K doubles are 512 MB per matrix, two of them are needed
+void benchmark_tiled(size_t n = 8192, size_t cube = 256) {
+  const tiling::cache_sizes& cache = tiling::cache();
+  std::cout << "L1 " << cache.l1 / 1024 << " KB, L2 " << cache.l2 / 1024 << " KB, line " << cache.line
+            << " B, tiles for double: L1 " << tiling::l1_tile<double>() << ", L2 " << tiling::l2_tile<double>()
+            << std::endl;
+
+  std::unique_ptr<double[]> src(new double[n * n]);
+  std::unique_ptr<double[]> dst(new double[n * n]);
+  for (size_t i = 0; i < n * n; i++) {
+    src[i] = double(i);
+    dst[i] = 0.0;
+  }
+  // Read once and written once
+  const double bytes = 2.0 * double(n * n * sizeof(double)) * 1e-9;
+  auto report = [&](const char* name, double seconds) {
+    std::cout << "transpose " << n << "x" << n << " " << name << ": " << seconds * 1e3 << " ms, " << bytes / seconds
+              << " GB/s" << std::endl;
+  };
+
+  report("naive, row-wise reads", best_seconds([&] {
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = 0; j < n; j++) {
+        dst[j * n + i] = src[i * n + j];
+      }
+    }
+  }));
+  report("naive, row-wise writes", best_seconds([&] {
+    for (size_t j = 0; j < n; j++) {
+      for (size_t i = 0; i < n; i++) {
+        dst[j * n + i] = src[i * n + j];
+      }
+    }
+  }));
+  for (size_t tile : {size_t {8}, size_t {16}, tiling::l1_tile<double>(), size_t {64}, tiling::l2_tile<double>()}) {
+    report(("for_each_tile, tile " + std::to_string(tile)).c_str(), best_seconds([&] {
+      tiling::for_each_tiled(n, n, tile, [&](size_t i, size_t j) { dst[j * n + i] = src[i * n + j]; });
+    }));
+  }
+  report("cache-oblivious", best_seconds([&] { tiling::transpose(src.get(), dst.get(), n, n); }));
+  report("cache-oblivious in place", best_seconds([&] { tiling::transpose_in_place(dst.get(), n); }));
+  src.reset();
+  dst.reset();
+
+  std::vector<double> a(cube * cube * cube);
+  std::vector<double> b(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    a[i] = double(i);
+  }
+  const double cube_bytes = 2.0 * double(a.size() * sizeof(double)) * 1e-9;
+  for (const std::array<size_t, 3>& order : {std::array<size_t, 3> {0, 2, 1}, std::array<size_t, 3> {1, 2, 0},
+                                             std::array<size_t, 3> {2, 0, 1}, std::array<size_t, 3> {2, 1, 0}}) {
+    double naive = best_seconds([&] {
+      const std::array<size_t, 3> e {cube, cube, cube};
+      for (size_t i = 0; i < cube; i++) {
+        for (size_t j = 0; j < cube; j++) {
+          for (size_t k = 0; k < cube; k++) {
+            std::array<size_t, 3> index {i, j, k};
+            b[(index[order[0]] * e[1] + index[order[1]]) * e[2] + index[order[2]]] = a[(i * cube + j) * cube + k];
+          }
+        }
+      }
+    });
+    double blocked = best_seconds([&] { tiling::permute_axes(a.data(), b.data(), {cube, cube, cube}, order); });
+    std::cout << "permute " << cube << "^3 to {" << order[0] << ", " << order[1] << ", " << order[2]
+              << "} (GB/s): naive " << cube_bytes / naive << ", cache-oblivious " << cube_bytes / blocked << std::endl;
+  }
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include <unistd.h>
+
+/**
+ * 1. Why column-wise access is slow
+ * 2. Cache sizes and the tile size knob
+ * 3. Tiled iteration
+ * 4. Cache-oblivious transpose
+ * 5. Permuting the axes of a 3D array
+ */
+
+// =================================================================
+// 1. Why column-wise access is slow
+// =================================================================
+// A multi-dimensional array like the int a[][3][5] of fn8() in function.cpp is stored row by row. Walking it in
+// declaration order reads consecutive addresses, and every 64-byte cache line that is loaded is used completely.
+// Walking it column by column jumps a whole row ahead on every access: for a matrix of 8K doubles per row, each access
+// touches a new cache line (and a new 4 KB page, and a new TLB entry), of which a single double is used before the
+// line is evicted again. A transpose has to do both: if it reads row-wise, it writes column-wise.
+// Tiling fixes this by working on small square blocks: a block of the source and the matching block of the destination
+// both fit into the L1 cache, so every cache line that is loaded is used completely before it is evicted.
+// A cache-oblivious algorithm splits the problem in halves recursively, so at some depth the blocks fit into L1, at a
+// higher depth into L2, and so on, without knowing the sizes; the tile size only decides when to stop recursing.
+
+namespace tiling {
+
+// =================================================================
+// 2. Cache sizes and the tile size knob
+// =================================================================
+struct cache_sizes {
+  size_t l1;   // L1 data cache, per core
+  size_t l2;
+  size_t line;
+};
+
+// glibc reports the sizes of the CPU it runs on through sysconf(), other systems may return 0 or -1, in which case
+// typical sizes of current x86 and ARM cores are used
+inline cache_sizes detect_cache_sizes() {
+  cache_sizes sizes {32 * 1024, 1024 * 1024, 64};
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL1_DCACHE_LINESIZE)
+  if (long l1 = ::sysconf(_SC_LEVEL1_DCACHE_SIZE); l1 > 0) {
+    sizes.l1 = size_t(l1);
+  }
+  if (long l2 = ::sysconf(_SC_LEVEL2_CACHE_SIZE); l2 > 0) {
+    sizes.l2 = size_t(l2);
+  }
+  if (long line = ::sysconf(_SC_LEVEL1_DCACHE_LINESIZE); line > 0) {
+    sizes.line = size_t(line);
+  }
+#endif
+  return sizes;
+}
+
+// Detected once, on first use, like cpu_dispatch::supported_isa()
+inline const cache_sizes& cache() {
+  static const cache_sizes sizes {detect_cache_sizes()};
+  return sizes;
+}
+
+// The side of a square tile of T such that `tiles` tiles use at most half of `cache_bytes` (the other half is left for
+// everything else, and for the associativity conflicts of power-of-two strides). The side is a whole number of cache
+// lines when possible, so tiles of a row-major array start and end on line boundaries.
+template <typename T>
+size_t square_tile(size_t cache_bytes, size_t tiles = 2) {
+  const size_t elements = cache_bytes / 2 / tiles / sizeof(T);
+  const size_t side = std::max<size_t>(1, size_t(std::sqrt(double(elements))));
+  const size_t line = std::max<size_t>(1, cache().line / sizeof(T));
+  return side >= line ? side / line * line : side;
+}
+
+// The knob: every function below takes a tile size, and 0 means this default, a source and a destination tile in L1.
+// Pass l2_tile<T>() (or any other value) to tune for a specific machine or access pattern.
+template <typename T>
+size_t l1_tile() {
+  static const size_t tile {square_tile<T>(cache().l1)};
+  return tile;
+}
+
+template <typename T>
+size_t l2_tile() {
+  static const size_t tile {square_tile<T>(cache().l2)};
+  return tile;
+}
+
+// =================================================================
+// 3. Tiled iteration
+// =================================================================
+// for_each_tile calls fn(row_begin, row_end, column_begin, column_end) for every tile of a rows x columns index space,
+// tile by tile in row-major order; for_each_tiled calls fn(row, column) for every index, grouped by tiles.
+template <typename Fn>
+void for_each_tile(size_t rows, size_t columns, size_t tile, Fn&& fn) {
+  assert(tile > 0);
+  for (size_t r = 0; r < rows; r += tile) {
+    for (size_t c = 0; c < columns; c += tile) {
+      fn(r, std::min(r + tile, rows), c, std::min(c + tile, columns));
+    }
+  }
+}
+
+template <typename Fn>
+void for_each_tiled(size_t rows, size_t columns, size_t tile, Fn&& fn) {
+  for_each_tile(rows, columns, tile, [&](size_t r0, size_t r1, size_t c0, size_t c1) {
+    for (size_t r = r0; r < r1; r++) {
+      for (size_t c = c0; c < c1; c++) {
+        fn(r, c);
+      }
+    }
+  });
+}
+
+// The same for three dimensions: fn(begin, end) with the corners of every tile x tile x tile block
+template <typename Fn>
+void for_each_tile(std::array<size_t, 3> extents, size_t tile, Fn&& fn) {
+  assert(tile > 0);
+  for (size_t i = 0; i < extents[0]; i += tile) {
+    for (size_t j = 0; j < extents[1]; j += tile) {
+      for (size_t k = 0; k < extents[2]; k += tile) {
+        fn(std::array<size_t, 3> {i, j, k},
+           std::array<size_t, 3> {std::min(i + tile, extents[0]), std::min(j + tile, extents[1]),
+                                  std::min(k + tile, extents[2])});
+      }
+    }
+  }
+}
+
+// =================================================================
+// 4. Cache-oblivious transpose
+// =================================================================
+namespace detail {
+
+// Splits the larger side at a multiple of the tile, so that the leaves are whole tiles except at the edges
+inline size_t split_point(size_t n, size_t tile) {
+  return std::max(tile, n / 2 / tile * tile);
+}
+
+// dst[j][i] = src[i][j] for a rows x columns block
+template <typename T>
+void transpose_block(const T* src, size_t src_stride, T* dst, size_t dst_stride, size_t rows, size_t columns,
+                     size_t tile) {
+  if (rows <= tile && columns <= tile) {
+    for (size_t i = 0; i < rows; i++) {
+      for (size_t j = 0; j < columns; j++) {
+        dst[j * dst_stride + i] = src[i * src_stride + j];
+      }
+    }
+  } else if (rows >= columns) {
+    const size_t half = split_point(rows, tile);
+    transpose_block(src, src_stride, dst, dst_stride, half, columns, tile);
+    transpose_block(src + half * src_stride, src_stride, dst + half, dst_stride, rows - half, columns, tile);
+  } else {
+    const size_t half = split_point(columns, tile);
+    transpose_block(src, src_stride, dst, dst_stride, rows, half, tile);
+    transpose_block(src + half, src_stride, dst + half * dst_stride, dst_stride, rows, columns - half, tile);
+  }
+}
+
+// Swaps a[i][j] with b[j][i] for a rows x columns block a and a columns x rows block b of the same matrix
+template <typename T>
+void swap_transposed(T* a, T* b, size_t stride, size_t rows, size_t columns, size_t tile) {
+  if (rows <= tile && columns <= tile) {
+    for (size_t i = 0; i < rows; i++) {
+      for (size_t j = 0; j < columns; j++) {
+        std::swap(a[i * stride + j], b[j * stride + i]);
+      }
+    }
+  } else if (rows >= columns) {
+    const size_t half = split_point(rows, tile);
+    swap_transposed(a, b, stride, half, columns, tile);
+    swap_transposed(a + half * stride, b + half, stride, rows - half, columns, tile);
+  } else {
+    const size_t half = split_point(columns, tile);
+    swap_transposed(a, b, stride, rows, half, tile);
+    swap_transposed(a + half, b + half * stride, stride, rows, columns - half, tile);
+  }
+}
+
+// Transposes the n x n block on the diagonal: the two diagonal quarters recursively, the off-diagonal ones by swapping
+template <typename T>
+void transpose_diagonal(T* a, size_t stride, size_t n, size_t tile) {
+  if (n <= tile) {
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = i + 1; j < n; j++) {
+        std::swap(a[i * stride + j], a[j * stride + i]);
+      }
+    }
+    return;
+  }
+  const size_t half = split_point(n, tile);
+  transpose_diagonal(a, stride, half, tile);
+  transpose_diagonal(a + half * stride + half, stride, n - half, tile);
+  swap_transposed(a + half, a + half * stride, stride, half, n - half, tile);
+}
+
+} // namespace detail
+
+// dst (columns x rows) = transpose of src (rows x columns), both row-major and contiguous. They must not overlap.
+template <typename T>
+void transpose(const T* src, T* dst, size_t rows, size_t columns, size_t tile = 0) {
+  detail::transpose_block(src, columns, dst, rows, rows, columns, tile != 0 ? tile : l1_tile<T>());
+}
+
+// A square n x n matrix, without a second buffer
+template <typename T>
+void transpose_in_place(T* a, size_t n, size_t tile = 0) {
+  detail::transpose_diagonal(a, n, n, tile != 0 ? tile : l1_tile<T>());
+}
+
+// C arrays, with the sizes checked by the types
+template <typename T, size_t Rows, size_t Columns>
+void transpose(const T (&src)[Rows][Columns], T (&dst)[Columns][Rows], size_t tile = 0) {
+  transpose(&src[0][0], &dst[0][0], Rows, Columns, tile);
+}
+
+// =================================================================
+// 5. Permuting the axes of a 3D array
+// =================================================================
+// dst has the axes of src in the given order: with order {2, 0, 1}, dst[k][i][j] = src[i][j][k], and the extents of dst
+// are {extents[2], extents[0], extents[1]}. The index space is split recursively along its longest axis until a block
+// has about tile * tile elements, so a block of src and the block of dst it maps to fit into L1 together.
+namespace detail {
+
+template <typename T>
+void permute_block(const T* src, T* dst, std::array<size_t, 3> extents, const std::array<size_t, 3>& src_strides,
+                   const std::array<size_t, 3>& dst_strides, size_t block_elements) {
+  if (extents[0] * extents[1] * extents[2] <= block_elements) {
+    for (size_t i = 0; i < extents[0]; i++) {
+      for (size_t j = 0; j < extents[1]; j++) {
+        const T* s = src + i * src_strides[0] + j * src_strides[1];
+        T* d = dst + i * dst_strides[0] + j * dst_strides[1];
+        for (size_t k = 0; k < extents[2]; k++) {
+          d[k * dst_strides[2]] = s[k];
+        }
+      }
+    }
+    return;
+  }
+  const size_t axis = size_t(std::max_element(extents.begin(), extents.end()) - extents.begin());
+  const size_t half = extents[axis] / 2;
+  std::array<size_t, 3> first = extents;
+  std::array<size_t, 3> second = extents;
+  first[axis] = half;
+  second[axis] = extents[axis] - half;
+  permute_block(src, dst, first, src_strides, dst_strides, block_elements);
+  permute_block(src + half * src_strides[axis], dst + half * dst_strides[axis], second, src_strides, dst_strides,
+                block_elements);
+}
+
+} // namespace detail
+
+template <typename T>
+void permute_axes(const T* src, T* dst, std::array<size_t, 3> extents, std::array<size_t, 3> order, size_t tile = 0) {
+  assert(std::is_permutation(order.begin(), order.end(), std::array<size_t, 3> {0, 1, 2}.begin()));
+  const std::array<size_t, 3> dst_extents {extents[order[0]], extents[order[1]], extents[order[2]]};
+  const std::array<size_t, 3> dst_axis_strides {dst_extents[1] * dst_extents[2], dst_extents[2], 1};
+  const std::array<size_t, 3> src_strides {extents[1] * extents[2], extents[2], 1};
+  // The stride in dst of each axis of src, so the recursion only works in the index space of src
+  std::array<size_t, 3> dst_strides {};
+  for (size_t axis = 0; axis < 3; axis++) {
+    dst_strides[order[axis]] = dst_axis_strides[axis];
+  }
+  tile = tile != 0 ? tile : l1_tile<T>();
+  detail::permute_block(src, dst, extents, src_strides, dst_strides, tile * tile);
+}
+
+template <typename T, size_t I, size_t J, size_t K>
+void permute_axes(const T (&src)[I][J][K], T* dst, std::array<size_t, 3> order, size_t tile = 0) {
+  permute_axes(&src[0][0][0], dst, {I, J, K}, order, tile);
+}
+
+} // namespace tiling
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "perf_counters.h"
+#include "type_sorted_collection.h"
+
+/**
+ * 1. Insertion, removal and stable handles
+ * 2. Cycles and branch misses per element against a mixed pointer vector
+ */
+
+// Mirrors BaseCls/DerivedCls in class_inheritance.h, with methods that return a value instead of printing
+class Entity {
+  public:
+    virtual ~Entity() = default;
+    virtual int implementation() const = 0;
+};
+
+class Player : public Entity {
+  public:
+    explicit Player(int score) : score_(score) {}
+    int implementation() const override { return score_ * 2; }
+  private:
+    int score_;
+};
+
+class Monster : public Entity {
+  public:
+    explicit Monster(int hp) : hp_(hp) {}
+    int implementation() const override { return hp_ - 1; }
+  private:
+    int hp_;
+};
+
+class Item : public Entity {
+  public:
+    explicit Item(int weight) : weight_(weight) {}
+    int implementation() const override { return weight_ ^ 3; }
+  private:
+    int weight_;
+};
+
+using EntityCollection = type_sorted_collection<Entity, Player, Monster, Item>;
+
+// =================================================================
+// 1. Insertion, removal and stable handles
+// =================================================================
+void test_type_sorted_collection() {
+  EntityCollection entities;
+  std::vector<EntityCollection::handle> handles;
+  for (int i = 0; i < 30; i++) {
+    switch (i % 3) {
+      case 0: handles.push_back(entities.emplace<Player>(i)); break;
+      case 1: handles.push_back(entities.emplace<Monster>(i)); break;
+      default: handles.push_back(entities.emplace<Item>(i)); break;
+    }
+  }
+  assert(entities.size() == 30);
+  assert(entities.get<Monster>(handles[4]).implementation() == 3);
+
+  // Removing elements moves others around, but their handles stay valid
+  entities.erase(handles[0]);
+  entities.erase(handles[4]);
+  assert(!entities.contains(handles[0]));
+  assert(entities.size() == 28);
+  assert(entities.get(handles[3]).implementation() == 6);
+  assert(entities.get(handles[7]).implementation() == 6);
+  assert(entities.get(handles[27]).implementation() == 54);
+
+  // A freed slot is reused with a new generation, so the old handle stays invalid
+  EntityCollection::handle reused = entities.emplace<Player>(100);
+  assert(reused.slot == handles[0].slot);
+  assert(!entities.contains(handles[0]));
+  assert(entities.get(reused).implementation() == 200);
+  // A handle with a type index past the last bucket is not contained in the collection
+  assert(!entities.contains({reused.type + 3, reused.slot, reused.generation}));
+
+  int sum {0};
+  entities.for_each([&]<typename T>(T& entity) { sum += entity.T::implementation(); });
+  int expected {0};
+  for (size_t i = 1; i < handles.size(); i++) {
+    if (i != 4) {
+      expected += entities.get(handles[i]).implementation();
+    }
+  }
+  assert(sum == expected + 200);
+}
+
+// =================================================================
+// 2. Cycles and branch misses per element against a mixed pointer vector
+// =================================================================
+template <typename Fn>
+void measure(const char* name, size_t count, Fn&& fn) {
+  PerfCounters counters;
+  long long sum {0};
+  auto start = std::chrono::steady_clock::now();
+  counters.start();
+  sum = fn();
+  PerfCounters::Sample sample = counters.stop();
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::cout << name << ": " << ns / double(count) << " ns/element";
+  if (counters.available()) {
+    std::cout << ", " << double(sample.cycles) / double(count) << " cycles/element, "
+              << double(sample.branch_misses) / double(count) << " branch misses/element, "
+              << double(sample.instructions) / double(sample.cycles) << " IPC";
+  } else {
+    std::cout << " (perf counters unavailable)";
+  }
+  std::cout << " [sum " << sum << "]" << std::endl;
+}
+
+void benchmark_type_sorted_collection(size_t count = 10'000'000) {
+  std::mt19937 rng {42};
+  std::vector<std::unique_ptr<Entity>> owners;
+  std::vector<Entity*> pointers;
+  EntityCollection entities;
+  owners.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    int value = int(rng() % 1000);
+    switch (rng() % 3) {
+      case 0: owners.push_back(std::make_unique<Player>(value)); entities.emplace<Player>(value); break;
+      case 1: owners.push_back(std::make_unique<Monster>(value)); entities.emplace<Monster>(value); break;
+      default: owners.push_back(std::make_unique<Item>(value)); entities.emplace<Item>(value); break;
+    }
+    pointers.push_back(owners.back().get());
+  }
+
+  measure("vector<Entity*>", count, [&] {
+    long long sum {0};
+    for (const Entity* entity : pointers) sum += entity->implementation();
+    return sum;
+  });
+  measure("type_sorted_collection", count, [&] {
+    long long sum {0};
+    entities.for_each([&]<typename T>(T& entity) { sum += entity.T::implementation(); });
+    return sum;
+  });
+}
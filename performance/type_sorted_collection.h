@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * 1. Why a mixed std::vector<BaseCls*> is slow to iterate
+ * 2. Stable handles
+ * 3. Devirtualized batch calls
+ * 4. One contiguous bucket per dynamic type
+ */
+
+// =================================================================
+// 1. Why a mixed std::vector<BaseCls*> is slow to iterate
+// =================================================================
+// Calling `ptr->implementation()` for every element of a mixed std::vector<BaseCls*> (see class_inheritance.h) is an
+// indirect call whose target changes from element to element in a random pattern, so the indirect branch predictor
+// misses a lot, and the instruction cache has to hold the code of every derived class at the same time. On top of
+// that, every element is a pointer chase to a separately allocated object.
+// If the objects are grouped by their dynamic type instead, every group is a plain loop over an array of one concrete
+// type: the call target never changes, the compiler can even inline it, and the data is read sequentially.
+
+template <typename Base, typename... Types>
+requires (std::is_base_of_v<Base, Types> && ...)
+class type_sorted_collection {
+  public:
+    // =================================================================
+    // 2. Stable handles
+    // =================================================================
+    // Removing an element moves the last element of its bucket into the hole, so the position of an element changes.
+    // A handle refers to a slot instead, and each slot knows the current position of its element. The generation
+    // counter is bumped whenever a slot is freed, so a handle to a removed element can be detected.
+    struct handle {
+      uint32_t type;
+      uint32_t slot;
+      uint32_t generation;
+    };
+
+    template <typename T, typename... Args>
+    handle emplace(Args&&... args) {
+      constexpr size_t type = type_index<T>();
+      auto& b = std::get<type>(buckets_);
+      uint32_t slot;
+      if (!b.free_slots.empty()) {
+        slot = b.free_slots.back();
+        b.free_slots.pop_back();
+      } else {
+        slot = uint32_t(b.slot_position.size());
+        b.slot_position.push_back(0);
+        b.slot_generation.push_back(0);
+      }
+      b.slot_position[slot] = uint32_t(b.items.size());
+      b.items.emplace_back(std::forward<Args>(args)...);
+      b.item_slot.push_back(slot);
+      return {uint32_t(type), slot, b.slot_generation[slot]};
+    }
+
+    void erase(handle h) {
+      assert(h.type < sizeof...(Types) && "the handle doesn't come from this collection");
+      visit_bucket(h.type, [&](auto& b) {
+        assert(contains(b, h));
+        uint32_t position = b.slot_position[h.slot];
+        uint32_t last = uint32_t(b.items.size() - 1);
+        if (position != last) {
+          b.items[position] = std::move(b.items[last]);
+          b.item_slot[position] = b.item_slot[last];
+          b.slot_position[b.item_slot[position]] = position;
+        }
+        b.items.pop_back();
+        b.item_slot.pop_back();
+        b.slot_generation[h.slot]++;
+        b.free_slots.push_back(h.slot);
+      });
+    }
+
+    bool contains(handle h) const {
+      bool found {false};
+      visit_bucket(h.type, [&](const auto& b) { found = contains(b, h); });
+      return found;
+    }
+
+    // A type index that matches no bucket would leave result null, so it is checked before anything else
+    Base& get(handle h) {
+      assert(h.type < sizeof...(Types) && "the handle doesn't come from this collection");
+      Base* result {nullptr};
+      visit_bucket(h.type, [&](auto& b) {
+        assert(contains(b, h));
+        result = &b.items[b.slot_position[h.slot]];
+      });
+      return *result;
+    }
+
+    // Typed access when the caller knows the type, e.g. right after emplace<T>()
+    template <typename T>
+    T& get(handle h) {
+      auto& b = std::get<type_index<T>()>(buckets_);
+      assert(h.type == type_index<T>() && contains(b, h));
+      return b.items[b.slot_position[h.slot]];
+    }
+
+    size_t size() const {
+      return std::apply([](const auto&... b) { return (b.items.size() + ...); }, buckets_);
+    }
+
+    // =================================================================
+    // 3. Devirtualized batch calls
+    // =================================================================
+    // fn is called with each element as its concrete type, one bucket after the other. Calling a virtual function on
+    // a concrete type is still a virtual call unless the type is final, so either mark the types final or qualify the
+    // call, which is a direct call by definition:
+    //   collection.for_each([]<typename T>(T& obj) { obj.T::implementation(); });
+    // The order of the elements within a bucket is not the insertion order.
+    template <typename Fn>
+    void for_each(Fn&& fn) {
+      std::apply([&](auto&... b) {
+        (for_each_in(b.items, fn), ...);
+      }, buckets_);
+    }
+
+    // Direct access to the array of one type, for kernels that want to process it themselves
+    template <typename T>
+    std::vector<T>& bucket() {
+      return std::get<type_index<T>()>(buckets_).items;
+    }
+
+  private:
+    // =================================================================
+    // 4. One contiguous bucket per dynamic type
+    // =================================================================
+    template <typename T>
+    struct type_bucket {
+      std::vector<T> items;
+      std::vector<uint32_t> item_slot;        // position -> slot
+      std::vector<uint32_t> slot_position;    // slot -> position
+      std::vector<uint32_t> slot_generation;  // slot -> generation
+      std::vector<uint32_t> free_slots;
+    };
+
+    template <typename T>
+    static constexpr size_t type_index() {
+      static_assert((std::is_same_v<T, Types> || ...), "T is not one of the collection's types");
+      size_t index {0};
+      ((std::is_same_v<T, Types> ? false : (index++, true)) && ...);
+      return index;
+    }
+
+    template <typename Bucket>
+    static bool contains(const Bucket& b, handle h) {
+      return h.slot < b.slot_generation.size() && b.slot_generation[h.slot] == h.generation;
+    }
+
+    template <typename T, typename Fn>
+    static void for_each_in(std::vector<T>& items, Fn& fn) {
+      for (T& item : items) {
+        fn(item);
+      }
+    }
+
+    // Runtime type index -> bucket, only used by the per-element operations, never in the batch loop
+    template <typename Fn>
+    void visit_bucket(uint32_t type, Fn&& fn) {
+      [&]<size_t... I>(std::index_sequence<I...>) {
+        ((type == I ? (fn(std::get<I>(buckets_)), true) : false) || ...);
+      }(std::index_sequence_for<Types...>{});
+    }
+    template <typename Fn>
+    void visit_bucket(uint32_t type, Fn&& fn) const {
+      [&]<size_t... I>(std::index_sequence<I...>) {
+        ((type == I ? (fn(std::get<I>(buckets_)), true) : false) || ...);
+      }(std::index_sequence_for<Types...>{});
+    }
+
+    std::tuple<type_bucket<Types>...> buckets_;
+};
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "wire.h"
+
+/**
+ * 1. Round trips, reading in place, and rejected messages
+ * 2. Encode and decode GB/s against iostreams
+ */
+
+// =================================================================
+// 1. Round trips, reading in place, and rejected messages
+// =================================================================
+enum class side : uint8_t { buy, sell };
+
+struct trade {
+  int64_t id;
+  double price;
+  int32_t quantity;
+  side direction;
+  std::string symbol;
+  std::vector<double> fills;
+  struct_cpp::Employee trader;
+};
+
+// The same members as trade, in another version: one more member
+struct trade_v2 {
+  int64_t id;
+  double price;
+  int32_t quantity;
+  side direction;
+  std::string symbol;
+  std::vector<double> fills;
+  struct_cpp::Employee trader;
+  uint32_t venue;
+};
+
+void test_wire() {
+  using namespace struct_cpp;
+  static_assert(wire::Message<Employee> && wire::Message<MyStruct6<int, double>> && wire::Message<MyStruct7>);
+  static_assert(wire::Message<trade> && !wire::Message<std::string>);
+  // Employee: int at 0, double at 8; trade: the Employee is inline at the end of the fixed part
+  static_assert(wire::schema<Employee>::kOffsets == std::array<size_t, 2> {0, 8});
+  static_assert(wire::schema<Employee>::kFixedSize == 16 && wire::schema<trade>::kFixedSize == 56);
+  static_assert(wire::schema<trade>::kOffsets[4] == 24 && wire::schema<trade>::kOffsets[6] == 40);
+  // The id depends on the kinds of the members, not on the names
+  static_assert(wire::schema_id<Employee> == wire::schema_id<MyStruct7>);
+  static_assert(wire::schema_id<Employee> != wire::schema_id<MyStruct6<int, double>>);
+  // char has a kind of its own, whether it is signed or not on the target
+  static_assert(wire::field_traits<char>::kKind == 'c');
+  static_assert(wire::schema_id<MyStruct6<char>> != wire::schema_id<MyStruct6<signed char>>);
+  static_assert(wire::schema_id<MyStruct6<char>> != wire::schema_id<MyStruct6<unsigned char>>);
+  static_assert(wire::schema_id<MyStruct6<int, double>> != wire::schema_id<MyStruct6<int, float>>);
+  static_assert(wire::schema_id<trade> != wire::schema_id<trade_v2>);
+
+  std::vector<std::byte> buffer;
+  const Employee ceo {50, 100000.0};
+  assert(wire::encode(ceo, buffer) == 32 && buffer.size() == 32);
+  // Little-endian on every machine
+  assert(buffer[16] == std::byte {50} && buffer[17] == std::byte {0});
+  Employee copy = wire::decode<Employee>(buffer);
+  assert(copy.age == 50 && copy.salary == 100000.0);
+
+  const trade t {42, 101.25, -7, side::sell, "ACME \"quoted\" name", {1.5, 2.5, 3.5}, {35, 5e4}};
+  const size_t first = buffer.size();
+  const size_t size = wire::encode(t, buffer);
+  assert(size == wire::encoded_size(t) && size % 8 == 0 && buffer.size() == first + size);
+  wire::encode(MyStruct6<int, double> {1, 2.0, 3}, buffer);
+
+  // Members are read straight out of the buffer
+  const auto v = wire::view<trade>::open(std::span(buffer).subspan(first));
+  assert(v.size() == size);
+  assert(v.get<0>() == 42 && v.get<1>() == 101.25 && v.get<2>() == -7 && v.get<3>() == side::sell);
+  std::string_view symbol = v.get<4>();
+  assert(symbol == t.symbol && symbol.data() > reinterpret_cast<const char*>(buffer.data() + first));
+  auto fills = v.get<5>();
+  assert(fills.size() == 3 && fills[2] == 3.5 && fills.to_vector() == t.fills);
+  assert(fills.native()[1] == 2.5);
+  assert(v.get<6>().get<0>() == 35 && v.get<6>().get<1>() == 5e4);
+
+  trade decoded = v.decode();
+  assert(decoded.id == t.id && decoded.symbol == t.symbol && decoded.fills == t.fills);
+  assert(decoded.trader.age == 35 && decoded.direction == side::sell);
+
+  // Messages follow each other
+  auto six = wire::view<MyStruct6<int, double>>::open(std::span(buffer).subspan(first + v.size()));
+  assert(six.get<0>() == 1 && six.get<1>() == 2.0 && six.get<2>() == 3);
+
+  // Empty strings and vectors
+  std::vector<std::byte> empty;
+  wire::encode(trade {}, empty);
+  assert(wire::decode<trade>(empty).symbol.empty() && wire::view<trade>::open(empty).get<5>().empty());
+
+  // Bad messages are rejected: another schema version, a truncated buffer, an offset out of bounds
+  auto rejected = [](std::span<const std::byte> bytes) {
+    try {
+      wire::view<trade>::open(bytes);
+    } catch (const wire::format_error&) {
+      return true;
+    }
+    return false;
+  };
+  std::vector<std::byte> message(buffer.begin() + first, buffer.begin() + first + size);
+  assert(!rejected(message));
+  assert(rejected(std::span(message).first(message.size() - 8)));
+  assert(rejected(std::span(buffer).first(32)));
+  std::vector<std::byte> v2;
+  wire::encode(trade_v2 {}, v2);
+  assert(rejected(v2));
+  std::vector<std::byte> corrupt = message;
+  wire::store(corrupt.data() + wire::kHeaderSize + wire::schema<trade>::kOffsets[4] + 4, uint32_t {1'000'000});
+  assert(rejected(corrupt));
+}
+
+// =================================================================
+// 2. Encode and decode GB/s against iostreams
+// =================================================================
+// Member by member, as text and with std::quoted for the string
+std::ostream& operator<<(std::ostream& out, const trade& t) {
+  out << t.id << ' ' << t.price << ' ' << t.quantity << ' ' << int(t.direction) << ' ' << std::quoted(t.symbol) << ' '
+      << t.fills.size();
+  for (double fill : t.fills) {
+    out << ' ' << fill;
+  }
+  return out << ' ' << t.trader.age << ' ' << t.trader.salary << '\n';
+}
+
+std::istream& operator>>(std::istream& in, trade& t) {
+  int direction;
+  size_t fills;
+  in >> t.id >> t.price >> t.quantity >> direction >> std::quoted(t.symbol) >> fills;
+  t.direction = side(direction);
+  t.fills.resize(fills);
+  for (double& fill : t.fills) {
+    in >> fill;
+  }
+  return in >> t.trader.age >> t.trader.salary;
+}
+
+// Member by member, in binary through write() and read()
+void write_binary(std::ostream& out, const trade& t) {
+  auto put = [&](const auto& value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+  put(t.id);
+  put(t.price);
+  put(t.quantity);
+  put(t.direction);
+  put(uint32_t(t.symbol.size()));
+  out.write(t.symbol.data(), std::streamsize(t.symbol.size()));
+  put(uint32_t(t.fills.size()));
+  out.write(reinterpret_cast<const char*>(t.fills.data()), std::streamsize(t.fills.size() * sizeof(double)));
+  put(t.trader.age);
+  put(t.trader.salary);
+}
+
+void read_binary(std::istream& in, trade& t) {
+  auto get = [&](auto& value) { in.read(reinterpret_cast<char*>(&value), sizeof(value)); };
+  uint32_t length;
+  get(t.id);
+  get(t.price);
+  get(t.quantity);
+  get(t.direction);
+  get(length);
+  t.symbol.resize(length);
+  in.read(t.symbol.data(), length);
+  get(length);
+  t.fills.resize(length);
+  in.read(reinterpret_cast<char*>(t.fills.data()), std::streamsize(length * sizeof(double)));
+  get(t.trader.age);
+  get(t.trader.salary);
+}
+
+void benchmark_wire(size_t n = 1'000'000) {
+  std::vector<trade> trades(n);
+  for (size_t i = 0; i < n; i++) {
+    trade& t = trades[i];
+    t = {int64_t(i), 100.0 + double(i % 1000) * 0.01, int32_t(i % 500), side(i % 2), "SYM" + std::to_string(i % 10'000),
+         std::vector<double>(i % 8, 1.25), {int(20 + i % 45), 40'000.0 + double(i % 100'000)}};
+  }
+  std::vector<trade> out(n);
+  volatile double sink {0.0};
+
+  std::vector<std::byte> buffer;
+  buffer.reserve(n * 128);
+  const double encode = best_seconds([&] {
+    buffer.clear();
+    for (const trade& t : trades) {
+      wire::encode(t, buffer);
+    }
+  });
+  const double decode = best_seconds([&] {
+    size_t offset {0};
+    for (trade& t : out) {
+      auto v = wire::view<trade>::open(std::span(buffer).subspan(offset));
+      t = v.decode();
+      offset += v.size();
+    }
+  });
+  // Reading one member of every message, without decoding the rest
+  const double in_place = best_seconds([&] {
+    size_t offset {0};
+    double total {0.0};
+    for (size_t i = 0; i < n; i++) {
+      auto v = wire::view<trade>::open(std::span(buffer).subspan(offset));
+      total += v.get<1>();
+      offset += v.size();
+    }
+    sink = total;
+  });
+  // The encodings have different sizes, so the time per trade is compared too
+  auto report = [&](const char* name, size_t bytes, double encode_seconds, double decode_seconds) {
+    const double gb = double(bytes) * 1e-9;
+    std::cout << name << ": " << bytes / n << " bytes per trade, encode " << gb / encode_seconds << " GB/s, "
+              << encode_seconds / double(n) * 1e9 << " ns per trade, decode " << gb / decode_seconds << " GB/s, "
+              << decode_seconds / double(n) * 1e9 << " ns per trade" << std::endl;
+    if (encode_seconds != encode) {
+      std::cout << "  wire is " << encode_seconds / encode << "x faster to encode, " << decode_seconds / decode
+                << "x faster to decode" << std::endl;
+    }
+  };
+  report("wire", buffer.size(), encode, decode);
+  std::cout << "wire, one member read in place: " << double(buffer.size()) * 1e-9 / in_place << " GB/s ("
+            << in_place / double(n) * 1e9 << " ns per trade)" << std::endl;
+
+  auto stream = [&](const char* name, auto&& write, auto&& read) {
+    std::string bytes;
+    const double encode_seconds = best_seconds([&] {
+      std::ostringstream os;
+      for (const trade& t : trades) {
+        write(os, t);
+      }
+      bytes = std::move(os).str();
+    });
+    const double decode_seconds = best_seconds([&] {
+      std::istringstream is {bytes};
+      for (trade& t : out) {
+        read(is, t);
+      }
+    });
+    assert(out[n - 1].symbol == trades[n - 1].symbol && out[n - 1].fills == trades[n - 1].fills);
+    report(name, bytes.size(), encode_seconds, decode_seconds);
+  };
+  stream("iostream text", [](std::ostream& os, const trade& t) { os << t; },
+         [](std::istream& is, trade& t) { is >> t; });
+  stream("iostream binary", write_binary, read_binary);
+}
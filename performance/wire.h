@@ -0,0 +1,447 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "struct_layout.h"
+
+/**
+ * 1. Parsing or reading in place
+ * 2. The format
+ * 3. Little-endian loads and stores
+ * 4. Field kinds and the schema of a message type
+ * 5. Encoding
+ * 6. Reading in place: view<T>
+ * 7. Decoding into a T
+ */
+
+// =================================================================
+// 1. Parsing or reading in place
+// =================================================================
+// Writing the members of a struct one by one to an iostream (`out << e.age << ' ' << e.salary`) and reading them back
+// with >> formats and parses every number, and decoding always builds the whole object, even to read one member.
+// Here the members are found with the reflection of struct_layout.h and written in binary, each at a fixed offset, so
+// a reader can load a member straight from the received buffer (or from a file mapped with MappedArray, see
+// mapped_array.h) without looking at the rest: reading a message is O(1) in its size, and a string is a
+// std::string_view into the buffer. The format is the same on every machine, so the buffer can be sent as is.
+
+namespace wire {
+
+// =================================================================
+// 2. The format
+// =================================================================
+// A message is a 16-byte header, a fixed part and a variable part:
+// - header: uint32 magic, uint32 size of the message in bytes, uint64 schema id of the type
+// - fixed part: the members in declaration order, each at the next multiple of its alignment. Numbers are stored
+//   little-endian, bools as one byte. A nested aggregate is stored inline, like in a struct. A std::string or a
+//   std::vector of numbers is stored as {uint32 offset, uint32 count}, with the offset from the start of the message.
+// - variable part: the bytes of the strings and vectors, each vector aligned to its element size.
+// The size is rounded up to 8 bytes, so messages can be appended to each other and each one starts aligned.
+// The schema id hashes the number of members and the kind and size of each one, recursively: a reader built with a
+// different version of the struct (a member added, removed or of another type) rejects the message instead of
+// reading garbage. Renaming a member, or swapping two members of the same kind, doesn't change it.
+
+inline constexpr uint32_t kMagic {0x45524957}; // "WIRE" in little-endian
+inline constexpr size_t kHeaderSize {16};
+inline constexpr size_t kMaxMessageSize {UINT32_MAX};
+
+class format_error : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+// =================================================================
+// 3. Little-endian loads and stores
+// =================================================================
+// memcpy is the portable way to read and write unaligned data, and compiles to plain moves
+template <typename U>
+requires std::is_unsigned_v<U>
+U byteswap_if_big_endian(U value) {
+  if constexpr (std::endian::native == std::endian::big && sizeof(U) == 2) {
+    return __builtin_bswap16(value);
+  } else if constexpr (std::endian::native == std::endian::big && sizeof(U) == 4) {
+    return __builtin_bswap32(value);
+  } else if constexpr (std::endian::native == std::endian::big && sizeof(U) == 8) {
+    return __builtin_bswap64(value);
+  } else {
+    return value;
+  }
+}
+
+template <typename T>
+concept Scalar = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+namespace detail {
+
+template <size_t Size>
+using unsigned_of_size = std::conditional_t<Size == 1, uint8_t, std::conditional_t<Size == 2, uint16_t,
+                                            std::conditional_t<Size == 4, uint32_t, uint64_t>>>;
+
+} // namespace detail
+
+template <Scalar T>
+void store(std::byte* p, T value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    *p = std::byte {value ? uint8_t {1} : uint8_t {0}};
+  } else {
+    using U = detail::unsigned_of_size<sizeof(T)>;
+    const U bits = byteswap_if_big_endian(std::bit_cast<U>(value));
+    std::memcpy(p, &bits, sizeof(U));
+  }
+}
+
+template <Scalar T>
+T load(const std::byte* p) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return *p != std::byte {0};
+  } else {
+    using U = detail::unsigned_of_size<sizeof(T)>;
+    U bits;
+    std::memcpy(&bits, p, sizeof(U));
+    return std::bit_cast<T>(byteswap_if_big_endian(bits));
+  }
+}
+
+// =================================================================
+// 4. Field kinds and the schema of a message type
+// =================================================================
+template <typename T>
+struct is_scalar_vector : std::false_type {};
+template <Scalar E>
+struct is_scalar_vector<std::vector<E>> : std::true_type {};
+
+template <typename T>
+struct schema;
+
+// An aggregate whose members are all numbers, enums, std::string, std::vector of numbers or messages themselves
+template <typename T>
+concept Message = layout::Reflectable<T> && schema<T>::kValid;
+
+template <typename F>
+struct field_traits {
+  static constexpr bool kValid = false;
+};
+
+template <Scalar F>
+requires (sizeof(F) == 1 || sizeof(F) == 2 || sizeof(F) == 4 || sizeof(F) == 8)
+struct field_traits<F> {
+  static constexpr bool kValid = true;
+  static constexpr size_t kSize = sizeof(F);
+  static constexpr size_t kAlignment = sizeof(F);
+  // char is signed on x86 and unsigned on ARM, so it has its own kind: the schema id must not depend on the target
+  static constexpr uint64_t kKind = std::is_same_v<F, bool> ? 'b' : std::is_same_v<F, char> ? 'c'
+                                    : std::is_enum_v<F> ? 'e' : std::is_floating_point_v<F> ? 'f'
+                                    : std::is_signed_v<F> ? 'i' : 'u';
+};
+
+template <>
+struct field_traits<std::string> {
+  static constexpr bool kValid = true;
+  static constexpr size_t kSize = 8;
+  static constexpr size_t kAlignment = 4;
+  static constexpr uint64_t kKind = 's';
+};
+
+template <Scalar E>
+struct field_traits<std::vector<E>> {
+  static constexpr bool kValid = field_traits<E>::kValid;
+  static constexpr size_t kSize = 8;
+  static constexpr size_t kAlignment = 4;
+  static constexpr uint64_t kKind = 'v' << 8 | field_traits<E>::kKind << 16 | field_traits<E>::kSize << 24;
+};
+
+template <typename F>
+requires (std::is_class_v<F> && layout::Reflectable<F>)
+struct field_traits<F> {
+  static constexpr bool kValid = schema<F>::kValid;
+  static constexpr size_t kSize = schema<F>::kFixedSize;
+  static constexpr size_t kAlignment = schema<F>::kAlignment;
+  static constexpr uint64_t kKind = schema<F>::kId;
+};
+
+namespace detail {
+
+constexpr uint64_t fnv1a(uint64_t hash, uint64_t value) {
+  for (int byte = 0; byte < 8; byte++) {
+    hash = (hash ^ ((value >> (8 * byte)) & 0xFF)) * 0x100000001B3ull;
+  }
+  return hash;
+}
+
+template <typename... Fs>
+struct fields_schema {
+  static constexpr bool kValid = (field_traits<Fs>::kValid && ...);
+  static constexpr size_t kCount = sizeof...(Fs);
+  static constexpr size_t kAlignment = std::max({size_t {1}, field_traits<Fs>::kAlignment...});
+  static constexpr std::array<size_t, kCount> kOffsets = [] {
+    std::array<size_t, kCount> offsets {};
+    const std::array<size_t, kCount> sizes {field_traits<Fs>::kSize...};
+    const std::array<size_t, kCount> alignments {field_traits<Fs>::kAlignment...};
+    size_t end {0};
+    for (size_t i = 0; i < kCount; i++) {
+      offsets[i] = layout::detail::round_up(end, alignments[i]);
+      end = offsets[i] + sizes[i];
+    }
+    return offsets;
+  }();
+  static constexpr size_t kFixedSize = [] {
+    const std::array<size_t, kCount> sizes {field_traits<Fs>::kSize...};
+    return layout::detail::round_up(kCount == 0 ? 0 : kOffsets[kCount - 1] + sizes[kCount - 1], kAlignment);
+  }();
+  static constexpr uint64_t kId = [] {
+    uint64_t hash = fnv1a(0xCBF29CE484222325ull, kCount);
+    ((hash = fnv1a(fnv1a(hash, field_traits<Fs>::kKind), field_traits<Fs>::kSize)), ...);
+    return hash;
+  }();
+  using types = std::tuple<Fs...>;
+};
+
+template <typename List>
+struct schema_of_list;
+template <typename... Fs>
+struct schema_of_list<layout::detail::type_list<Fs...>> {
+  using type = fields_schema<Fs...>;
+};
+
+} // namespace detail
+
+template <typename T>
+struct schema : detail::schema_of_list<layout::detail::field_type_list<T>>::type {};
+
+template <Message T>
+inline constexpr uint64_t schema_id = schema<T>::kId;
+
+// =================================================================
+// 5. Encoding
+// =================================================================
+namespace detail {
+
+template <bool Write, typename F>
+void put_field(const F& field, std::byte* message, size_t at, size_t& tail);
+
+// Writes the members of value into the fixed part at `fixed` and their variable-length data at `tail`, both offsets
+// into the message, or with Write = false only advances `tail`, to compute the size of the message with the same code.
+// The sizing pass has no message, and offsets keep it from doing arithmetic on a null pointer.
+template <bool Write, typename T>
+void put(const T& value, std::byte* message, size_t fixed, size_t& tail) {
+  layout::detail::visit_fields(value, [&](const auto&... fields) {
+    size_t i {0};
+    (put_field<Write>(fields, message, fixed + schema<T>::kOffsets[i++], tail), ...);
+  });
+}
+
+template <bool Write, typename F>
+void put_field(const F& field, std::byte* message, size_t at, size_t& tail) {
+  if constexpr (Scalar<F>) {
+    if constexpr (Write) {
+      store(message + at, field);
+    }
+  } else if constexpr (std::is_same_v<F, std::string> || is_scalar_vector<F>::value) {
+    using E = typename F::value_type;
+    tail = layout::detail::round_up(tail, field_traits<E>::kSize);
+    if constexpr (Write) {
+      store(message + at, uint32_t(tail));
+      store(message + at + 4, uint32_t(field.size()));
+      if constexpr (std::is_same_v<F, std::string> || (std::endian::native == std::endian::little &&
+                                                        !std::is_same_v<E, bool>)) {
+        if (!field.empty()) {   // an empty vector may have a null data()
+          std::memcpy(message + tail, field.data(), field.size() * sizeof(E));
+        }
+      } else {
+        for (size_t k = 0; k < field.size(); k++) {
+          store(message + tail + k * sizeof(E), E(field[k]));
+        }
+      }
+    }
+    tail += field.size() * field_traits<E>::kSize;
+  } else {
+    put<Write>(field, message, at, tail);
+  }
+}
+
+} // namespace detail
+
+// The size of the encoded message, a multiple of 8
+template <Message T>
+size_t encoded_size(const T& value) {
+  size_t tail {kHeaderSize + schema<T>::kFixedSize};
+  detail::put<false>(value, nullptr, kHeaderSize, tail);
+  return layout::detail::round_up(tail, 8);
+}
+
+// Appends one message to out, and returns its size
+template <Message T>
+size_t encode(const T& value, std::vector<std::byte>& out) {
+  const size_t size = encoded_size(value);
+  if (size > kMaxMessageSize) {
+    throw format_error("message larger than 4 GB");
+  }
+  const size_t start = out.size();
+  out.resize(start + size);
+  std::byte* message = out.data() + start;
+  // The padding between the members and at the end is zeroed by resize, so equal values give equal bytes
+  store(message, kMagic);
+  store(message + 4, uint32_t(size));
+  store(message + 8, schema_id<T>);
+  size_t tail {kHeaderSize + schema<T>::kFixedSize};
+  detail::put<true>(value, message, kHeaderSize, tail);
+  return size;
+}
+
+// =================================================================
+// 6. Reading in place: view<T>
+// =================================================================
+// The elements of a vector member, loaded from the buffer on access
+template <Scalar E>
+class array_view {
+  public:
+    array_view(const std::byte* data, size_t size) : data_(data), size_(size) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    E operator[](size_t i) const {
+      assert(i < size_);
+      return load<E>(data_ + i * sizeof(E));
+    }
+
+    // The elements as a span, without copying, where the bytes in the buffer are the native representation: on a
+    // little-endian machine, if the buffer is aligned to 8 bytes (the elements are aligned within the message)
+    std::span<const E> native() const requires (std::endian::native == std::endian::little) {
+      assert(reinterpret_cast<uintptr_t>(data_) % alignof(E) == 0);
+      return {reinterpret_cast<const E*>(data_), size_};
+    }
+
+    std::vector<E> to_vector() const {
+      std::vector<E> out(size_);
+      for (size_t i = 0; i < size_; i++) {
+        out[i] = (*this)[i];
+      }
+      return out;
+    }
+
+  private:
+    const std::byte* data_;
+    size_t size_;
+};
+
+template <Message T>
+class view {
+  public:
+    using types = typename schema<T>::types;
+
+    // Checks the header, and that every string and vector lies inside the message. This is the only work done on the
+    // whole message, O(number of members); afterwards the members are read without checks.
+    static view open(std::span<const std::byte> bytes) {
+      if (bytes.size() < kHeaderSize + schema<T>::kFixedSize || load<uint32_t>(bytes.data()) != kMagic) {
+        throw format_error("not a message");
+      }
+      const size_t size = load<uint32_t>(bytes.data() + 4);
+      if (size > bytes.size() || size < kHeaderSize + schema<T>::kFixedSize) {
+        throw format_error("truncated message");
+      }
+      if (load<uint64_t>(bytes.data() + 8) != schema_id<T>) {
+        throw format_error("schema mismatch");
+      }
+      view v {bytes.data(), bytes.data() + kHeaderSize, size};
+      v.validate();
+      return v;
+    }
+
+    // The size of the message in bytes; the next message of a stream starts right after it
+    size_t size() const { return size_; }
+
+    // Member I: a number by value, a std::string_view, an array_view or the view of a nested message
+    template <size_t I>
+    auto get() const {
+      using F = std::tuple_element_t<I, types>;
+      const std::byte* at = fixed_ + schema<T>::kOffsets[I];
+      if constexpr (Scalar<F>) {
+        return load<F>(at);
+      } else if constexpr (std::is_same_v<F, std::string>) {
+        return std::string_view {reinterpret_cast<const char*>(message_ + load<uint32_t>(at)), load<uint32_t>(at + 4)};
+      } else if constexpr (is_scalar_vector<F>::value) {
+        return array_view<typename F::value_type> {message_ + load<uint32_t>(at), load<uint32_t>(at + 4)};
+      } else {
+        return view<F> {message_, at, size_};
+      }
+    }
+
+    T decode() const;
+
+  private:
+    template <Message U>
+    friend class view;
+
+    view(const std::byte* message, const std::byte* fixed, size_t size)
+        : message_(message), fixed_(fixed), size_(size) {}
+
+    void validate() const {
+      [this]<size_t... I>(std::index_sequence<I...>) {
+        (validate_field<I>(), ...);
+      }(std::make_index_sequence<schema<T>::kCount> {});
+    }
+    template <size_t I>
+    void validate_field() const {
+      using F = std::tuple_element_t<I, types>;
+      if constexpr (std::is_same_v<F, std::string> || is_scalar_vector<F>::value) {
+        const std::byte* at = fixed_ + schema<T>::kOffsets[I];
+        const uint64_t offset = load<uint32_t>(at);
+        const uint64_t end = offset + uint64_t(load<uint32_t>(at + 4)) * sizeof(typename F::value_type);
+        if (offset < kHeaderSize || end > size_) {
+          throw format_error("member out of bounds");
+        }
+      } else if constexpr (!Scalar<F>) {
+        get<I>().validate();
+      }
+    }
+
+    const std::byte* message_;   // for the offsets of strings and vectors
+    const std::byte* fixed_;     // the members of this (possibly nested) aggregate
+    size_t size_;
+};
+
+// =================================================================
+// 7. Decoding into a T
+// =================================================================
+// Copies every member out of the buffer, for code that needs a T (or owns its data)
+template <Message T>
+T view<T>::decode() const {
+  T out {};
+  layout::detail::visit_fields(out, [this](auto&... fields) {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+      ((fields = [&] {
+        using F = std::tuple_element_t<I, types>;
+        if constexpr (Scalar<F>) {
+          return get<I>();
+        } else if constexpr (std::is_same_v<F, std::string>) {
+          return std::string(get<I>());
+        } else if constexpr (is_scalar_vector<F>::value) {
+          return get<I>().to_vector();
+        } else {
+          return get<I>().decode();
+        }
+      }()), ...);
+    }(std::make_index_sequence<sizeof...(fields)> {});
+  });
+  return out;
+}
+
+template <Message T>
+T decode(std::span<const std::byte> bytes) {
+  return view<T>::open(bytes).decode();
+}
+
+} // namespace wire